@@ -0,0 +1,449 @@
+#include "analyzer.h"
+
+// Name of the symbol at the head of a list, if it is one.
+static const std::string* HeadName(Object* form) {
+    auto cell = dynamic_cast<Cell*>(form);
+    auto head = cell ? dynamic_cast<Symbol*>(cell->GetFirst().get()) : nullptr;
+    return head ? &head->GetName() : nullptr;
+}
+
+template <class F>
+static void ForEachInBody(Object* body, F f) {
+    for (auto curr = dynamic_cast<Cell*>(body); curr;
+         curr = dynamic_cast<Cell*>(curr->GetSecond().get())) {
+        f(curr->GetFirst().get());
+    }
+}
+
+void Analyzer::Analyze(const std::shared_ptr<Object>& expr) {
+    CollectAssignments(expr.get());
+    Walk(expr.get());
+}
+
+void Analyzer::Walk(Object* expr) {
+    Task::CheckStack();
+    if (auto lambda = dynamic_cast<LambdaForm*>(expr)) {
+        WalkLambda(*lambda->GetInfo());
+    } else if (auto let = dynamic_cast<LetForm*>(expr)) {
+        WalkLet(*let->GetInfo());
+    } else if (auto call = dynamic_cast<Cell*>(expr)) {
+        forms_.push_back(call);
+        WalkCall(call);
+        forms_.pop_back();
+    }
+}
+
+void Analyzer::WalkCall(Cell* call) {
+    std::vector<Object*> items;
+    if (!ListToVector(call, &items) || !items.front()) {
+        return;
+    }
+
+    auto head = dynamic_cast<Symbol*>(items.front());
+    auto builtin = head ? head->GetBuiltin().get() : nullptr;
+    if (builtin && !dynamic_cast<Procedure*>(builtin)) {
+        const auto& name = head->GetName();
+        // Binding forms left unconverted are not tracked, so nothing inside them is assumed.
+        if (name == "quote" || name == "lambda" || name == "let" || name == "let*" ||
+            name == "letrec" || name == "do") {
+            return;
+        }
+        // Only the first test of a cond surely runs.
+        if (name == "cond") {
+            bool first = true;
+            for (size_t i = 1; i < items.size(); ++i) {
+                ForEachInBody(items[i], [&](Object* item) {
+                    WalkMaybe(item, !first);
+                    first = false;
+                });
+            }
+            return;
+        }
+        bool branches = name == "if" || name == "and" || name == "or";
+        for (size_t i = name == "define" || name == "set!" ? 2 : 1; i < items.size(); ++i) {
+            WalkMaybe(items[i], name == "guard" || (branches && i > 1));
+        }
+        return;
+    }
+
+    bool handled = builtin && head->GetName() == "with-exception-handler";
+    for (auto item : items) {
+        WalkMaybe(item, handled);
+    }
+    if (builtin) {
+        CheckBuiltinCall(call, *head, items);
+        return;
+    }
+
+    std::optional<size_t> arity;
+    std::string name = "lambda";
+    if (head) {
+        name = head->GetName();
+        if (auto var = Lookup(name)) {
+            arity = var->arity;
+        }
+    } else if (auto lambda = dynamic_cast<LambdaForm*>(items.front())) {
+        arity = lambda->GetInfo()->params.size();
+    }
+    if (arity) {
+        if (*arity != items.size() - 1) {
+            FailArity(name);
+            return;
+        }
+        stats_->checked_calls += 1;
+    }
+}
+
+void Analyzer::CheckBuiltinCall(Cell* call, const Symbol& head, const std::vector<Object*>& items) {
+    const auto& name = head.GetName();
+    auto signature = Symbol::GetSignature(name);
+    if (!signature) {
+        return;
+    }
+    size_t count = items.size() - 1;
+    if (count < signature->min || count > signature->max) {
+        FailArity(name);
+        return;
+    }
+    stats_->checked_calls += 1;
+
+    bool fixnums = count <= Cell::kMaxFixnumArgs;
+    for (size_t i = 1; i < items.size(); ++i) {
+        fixnums = fixnums && TypeOf(items[i]) == StaticType::kNumber;
+    }
+
+    if (dynamic_cast<FixnumProcedure*>(head.GetBuiltin().get())) {
+        stats_->fixnum_calls += call->MarkFixnumCall(fixnums);
+    }
+}
+
+void Analyzer::WalkLambda(const LambdaInfo& info, const std::vector<bool>& fixnums) {
+    auto frame = MakeFrame(info);
+    for (size_t i = 0; i < fixnums.size(); ++i) {
+        frame[info.params[i]].fixnum = fixnums[i];
+    }
+    frames_.push_back(std::move(frame));
+    WalkBody(info.body.get());
+    frames_.pop_back();
+}
+
+void Analyzer::WalkLet(const LetInfo& info) {
+    if (info.loop) {
+        for (const auto& init : info.inits) {
+            Walk(init.get());
+        }
+        auto fixnums = InferLoopFixnums(info);
+        auto arity = LambdaArity(info.loop_name, info.loop.get());
+        frames_.push_back({{info.loop_name, {false, arity}}});
+        WalkLambda(*info.loop->GetInfo(), fixnums);
+        frames_.pop_back();
+        return;
+    }
+
+    // A name bound twice is rebound in place, so it may change its type.
+    bool duplicates = HasDuplicates(info.names);
+    auto bind = [&](size_t i) {
+        Variable var{false, LambdaArity(info.names[i], info.inits[i].get())};
+        var.fixnum = !info.boxed[i] && !duplicates && info.kind != LetKind::kLetRec &&
+                     TypeOf(info.inits[i].get()) == StaticType::kNumber;
+        return var;
+    };
+
+    Frame frame;
+    if (info.kind == LetKind::kLet || info.kind == LetKind::kDo) {
+        for (const auto& init : info.inits) {
+            Walk(init.get());
+        }
+        for (size_t i = 0; i < info.names.size(); ++i) {
+            frame[info.names[i]] = bind(i);
+        }
+        frames_.push_back(std::move(frame));
+    } else if (info.kind == LetKind::kLetStar) {
+        frames_.push_back(std::move(frame));
+        for (size_t i = 0; i < info.names.size(); ++i) {
+            Walk(info.inits[i].get());
+            frames_.back()[info.names[i]] = bind(i);
+        }
+    } else {
+        for (size_t i = 0; i < info.names.size(); ++i) {
+            frame[info.names[i]] = bind(i);
+        }
+        frames_.push_back(std::move(frame));
+        for (const auto& init : info.inits) {
+            Walk(init.get());
+        }
+    }
+    for (const auto& name : info.locals) {
+        frames_.back()[name] = {false, LambdaArity(name, nullptr)};
+    }
+
+    // Steps see the values of the previous iteration, so do variables are narrowed until every
+    // step of a fixnum is a fixnum too.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 0; i < info.steps.size(); ++i) {
+            auto& var = frames_.back()[info.names[i]];
+            if (var.fixnum && info.steps[i] &&
+                TypeOf(info.steps[i].get()) != StaticType::kNumber) {
+                var.fixnum = false;
+                changed = true;
+            }
+        }
+    }
+    // A do loop may end before its first iteration.
+    bool loops = info.kind == LetKind::kDo;
+    for (const auto& step : info.steps) {
+        WalkMaybe(step.get(), loops);
+    }
+    Walk(info.test.get());
+    WalkBody(info.result.get());
+    ForEachInBody(info.body.get(), [&](Object* item) { WalkMaybe(item, loops); });
+    frames_.pop_back();
+}
+
+void Analyzer::WalkMaybe(Object* expr, bool uncertain) {
+    uncertain_ += uncertain;
+    Walk(expr);
+    uncertain_ -= uncertain;
+}
+
+void Analyzer::WalkBody(Object* body) {
+    ForEachInBody(body, [this](Object* item) { Walk(item); });
+}
+
+StaticType Analyzer::TypeOf(Object* expr) const {
+    Task::CheckStack();
+    if (dynamic_cast<Number*>(expr)) {
+        return StaticType::kNumber;
+    }
+    if (dynamic_cast<Boolean*>(expr)) {
+        return StaticType::kBoolean;
+    }
+    if (dynamic_cast<String*>(expr)) {
+        return StaticType::kString;
+    }
+    if (auto symb = dynamic_cast<Symbol*>(expr)) {
+        auto var = symb->GetBuiltin() ? nullptr : Lookup(symb->GetName());
+        return var && var->fixnum ? StaticType::kNumber : StaticType::kUnknown;
+    }
+
+    auto call = dynamic_cast<Cell*>(expr);
+    auto head = call ? dynamic_cast<Symbol*>(call->GetFirst().get()) : nullptr;
+    if (!head || !head->GetBuiltin()) {
+        return StaticType::kUnknown;
+    }
+    const auto& name = head->GetName();
+    if (name == "if") {
+        std::vector<Object*> items;
+        if (!ListToVector(expr, &items) || items.size() != 4) {
+            return StaticType::kUnknown;
+        }
+        auto type = TypeOf(items[2]);
+        return type == TypeOf(items[3]) ? type : StaticType::kUnknown;
+    }
+    auto signature = Symbol::GetSignature(name);
+    return signature ? signature->result : StaticType::kUnknown;
+}
+
+// Loop variables are fixnums if their inits are and every call of the loop passes fixnums in
+// their places, assuming the ones still in question are. The loop has to be called only by name.
+std::vector<bool> Analyzer::InferLoopFixnums(const LetInfo& info) {
+    const auto& loop = *info.loop->GetInfo();
+    std::vector<bool> fixnums(loop.params.size());
+    if (assigned_.count(info.loop_name) || defines_.count(info.loop_name) ||
+        HasDuplicates(loop.params) || info.inits.size() != loop.params.size()) {
+        return fixnums;
+    }
+    for (size_t i = 0; i < fixnums.size(); ++i) {
+        fixnums[i] = !loop.boxed[i] && TypeOf(info.inits[i].get()) == StaticType::kNumber;
+    }
+
+    while (true) {
+        auto frame = MakeFrame(loop);
+        for (size_t i = 0; i < fixnums.size(); ++i) {
+            frame[loop.params[i]].fixnum = fixnums[i];
+        }
+        frames_.push_back(std::move(frame));
+        auto next = fixnums;
+        bool escapes = false;
+        ForEachInBody(loop.body.get(), [&](Object* item) {
+            ScanLoopCalls(item, info.loop_name, &next, &escapes);
+        });
+        frames_.pop_back();
+
+        if (escapes) {
+            return std::vector<bool>(fixnums.size());
+        }
+        if (next == fixnums) {
+            return fixnums;
+        }
+        fixnums = std::move(next);
+    }
+}
+
+// Shadowing of the loop name is not tracked: calls to an inner binding of the same name only
+// add constraints. Inner bindings of other names hide outer fixnums, as they do at run time.
+void Analyzer::ScanLoopCalls(Object* expr, const std::string& name, std::vector<bool>* fixnums,
+                             bool* escapes) {
+    Task::CheckStack();
+    auto scan = [&](Object* item) { ScanLoopCalls(item, name, fixnums, escapes); };
+
+    if (auto symb = dynamic_cast<Symbol*>(expr)) {
+        *escapes = *escapes || symb->GetName() == name;
+        return;
+    }
+    if (auto lambda = dynamic_cast<LambdaForm*>(expr)) {
+        frames_.push_back(MakeFrame(*lambda->GetInfo()));
+        ForEachInBody(lambda->GetInfo()->body.get(), scan);
+        frames_.pop_back();
+        return;
+    }
+    if (auto let = dynamic_cast<LetForm*>(expr)) {
+        const auto& info = *let->GetInfo();
+        Frame frame;
+        for (const auto& bound : info.names) {
+            frame[bound] = {};
+        }
+        for (const auto& bound : info.locals) {
+            frame[bound] = {};
+        }
+        if (info.loop) {
+            frame[info.loop_name] = {};
+        }
+        frames_.push_back(std::move(frame));
+        for (const auto& init : info.inits) {
+            scan(init.get());
+        }
+        for (const auto& step : info.steps) {
+            scan(step.get());
+        }
+        scan(info.test.get());
+        ForEachInBody(info.result.get(), scan);
+        ForEachInBody(info.body.get(), scan);
+        scan(info.loop.get());
+        frames_.pop_back();
+        return;
+    }
+
+    std::vector<Object*> items;
+    auto head = HeadName(expr);
+    if (!dynamic_cast<Cell*>(expr) || (head && *head == "quote")) {
+        return;
+    }
+    if (!ListToVector(expr, &items)) {
+        *escapes = true;
+        return;
+    }
+    if (head && *head == name) {
+        if (items.size() - 1 != fixnums->size()) {
+            *escapes = true;
+            return;
+        }
+        for (size_t i = 1; i < items.size(); ++i) {
+            if (TypeOf(items[i]) != StaticType::kNumber) {
+                (*fixnums)[i - 1] = false;
+            }
+            scan(items[i]);
+        }
+        return;
+    }
+    for (auto item : items) {
+        scan(item);
+    }
+}
+
+void Analyzer::CollectAssignments(Object* expr) {
+    Task::CheckStack();
+    auto collect = [this](Object* item) { CollectAssignments(item); };
+
+    if (auto lambda = dynamic_cast<LambdaForm*>(expr)) {
+        ForEachInBody(lambda->GetInfo()->body.get(), collect);
+        return;
+    }
+    if (auto let = dynamic_cast<LetForm*>(expr)) {
+        const auto& info = *let->GetInfo();
+        for (const auto& init : info.inits) {
+            collect(init.get());
+        }
+        for (const auto& step : info.steps) {
+            collect(step.get());
+        }
+        collect(info.test.get());
+        ForEachInBody(info.result.get(), collect);
+        ForEachInBody(info.body.get(), collect);
+        collect(info.loop.get());
+        return;
+    }
+
+    std::vector<Object*> items;
+    auto head = HeadName(expr);
+    if ((head && *head == "quote") || !ListToVector(expr, &items) || items.empty()) {
+        return;
+    }
+    auto target = head && items.size() >= 2 ? dynamic_cast<Symbol*>(items[1]) : nullptr;
+    if (target && *head == "define") {
+        defines_[target->GetName()].push_back(items.size() == 3 ? items[2] : nullptr);
+    } else if (target && (*head == "set!" || *head == "set-car!" || *head == "set-cdr!")) {
+        assigned_.insert(target->GetName());
+    }
+    for (auto item : items) {
+        collect(item);
+    }
+}
+
+Analyzer::Frame Analyzer::MakeFrame(const LambdaInfo& info) const {
+    Frame frame;
+    for (const auto& param : info.params) {
+        frame[param] = {};
+    }
+    for (const auto& name : info.locals) {
+        frame[name] = {false, LambdaArity(name, nullptr)};
+    }
+    return frame;
+}
+
+// The arity of a binding whose only value is a lambda: the init of a let binding, or with a null
+// value the one internal define of the name.
+std::optional<size_t> Analyzer::LambdaArity(const std::string& name, const Object* value) const {
+    if (assigned_.count(name)) {
+        return std::nullopt;
+    }
+    auto it = defines_.find(name);
+    size_t defines = it == defines_.end() ? 0 : it->second.size();
+    if (!value && defines == 1) {
+        value = it->second.front();
+    } else if (defines != 0) {
+        return std::nullopt;
+    }
+
+    auto lambda = dynamic_cast<const LambdaForm*>(value);
+    if (!lambda) {
+        return std::nullopt;
+    }
+    return lambda->GetInfo()->params.size();
+}
+
+const Analyzer::Variable* Analyzer::Lookup(const std::string& name) const {
+    for (auto frame = frames_.rbegin(); frame != frames_.rend(); ++frame) {
+        if (auto it = frame->find(name); it != frame->end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void Analyzer::FailArity(const std::string& name) const {
+    if (uncertain_ == 0) {
+        Fail(name + ": wrong number of arguments");
+    }
+}
+
+void Analyzer::Fail(const std::string& message) const {
+    for (auto form = forms_.rbegin(); positions_ && form != forms_.rend(); ++form) {
+        auto where = positions_->Describe(*form);
+        if (!where.empty()) {
+            throw SyntaxError{where + ": " + message};
+        }
+    }
+    throw SyntaxError{message};
+}
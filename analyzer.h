@@ -0,0 +1,73 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "object.h"
+#include "parser.h"
+
+struct AnalyzerStats {
+    size_t checked_calls = 0;
+    size_t fixnum_calls = 0;
+};
+
+// Checks closure-converted code before it runs. Calls to builtins, to literal lambdas and to
+// lambdas bound locally and never reassigned must match their arity. Globals can be redefined,
+// so calls through them are left to run time. Only code that surely runs once its lambda is
+// called is held to this. A branch of if, and, or or cond, a do body, and the code of a guard or
+// with-exception-handler may be skipped or have its error handled. A call there that does not
+// match is left to raise at run time, as are arguments of a wrong type.
+//
+// A variable of let, let*, do or a named let loop is a fixnum if it is never assigned and every
+// value bound to it is a number. Calls of numeric builtins whose arguments all are fixnums are
+// marked to skip the argument checks. Errors are SyntaxErrors naming the position of the
+// innermost enclosing form that came from the source.
+class Analyzer {
+public:
+    Analyzer(const SourceMap* positions, AnalyzerStats* stats)
+        : positions_(positions), stats_(stats) {
+    }
+
+    void Analyze(const std::shared_ptr<Object>& expr);
+
+private:
+    struct Variable {
+        bool fixnum = false;
+        std::optional<size_t> arity{};
+    };
+
+    using Frame = std::map<std::string, Variable>;
+
+    // The code is owned by the caller of Analyze, so it is walked through raw pointers.
+    void Walk(Object* expr);
+    void WalkCall(Cell* call);
+    void WalkLambda(const LambdaInfo& info, const std::vector<bool>& fixnums = {});
+    void WalkLet(const LetInfo& info);
+    void WalkMaybe(Object* expr, bool uncertain);
+    void WalkBody(Object* body);
+    void CheckBuiltinCall(Cell* call, const Symbol& head, const std::vector<Object*>& items);
+
+    StaticType TypeOf(Object* expr) const;
+    std::vector<bool> InferLoopFixnums(const LetInfo& info);
+    void ScanLoopCalls(Object* expr, const std::string& name, std::vector<bool>* fixnums,
+                       bool* escapes);
+
+    void CollectAssignments(Object* expr);
+    Frame MakeFrame(const LambdaInfo& info) const;
+    std::optional<size_t> LambdaArity(const std::string& name, const Object* value) const;
+    const Variable* Lookup(const std::string& name) const;
+    void FailArity(const std::string& name) const;
+    [[noreturn]] void Fail(const std::string& message) const;
+
+    const SourceMap* positions_;
+    AnalyzerStats* stats_;
+    std::set<std::string> assigned_{};
+    std::map<std::string, std::vector<const Object*>> defines_{};
+    std::vector<Frame> frames_{};
+    std::vector<const Object*> forms_{};
+    size_t uncertain_ = 0;
+};
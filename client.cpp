@@ -0,0 +1,198 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "protocol.h"
+
+// Load generator for scheme_server:
+//
+//     scheme_client SOCKET [--connections C] [--requests N] [--pipeline D] [--expr CODE]
+//
+// Sends N requests in total over C connections, keeping up to D of them in flight on each, and
+// reports the throughput, the latency percentiles and the number of responses of every status.
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socket_path{};
+    size_t connections = 4;
+    size_t requests = 100000;
+    size_t pipeline = 16;
+    std::string expr = "(+ 1 2)";
+};
+
+struct Results {
+    std::vector<double> latencies{};
+    size_t statuses[static_cast<size_t>(ResponseStatus::kTimeout) + 1] = {};
+    size_t lost = 0;
+};
+
+static Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg[0] != '-' && options.socket_path.empty()) {
+            options.socket_path = arg;
+            continue;
+        }
+        if (i + 1 == argc) {
+            throw std::runtime_error{"bad argument " + arg};
+        }
+        std::string value = argv[++i];
+        if (arg == "--connections") {
+            options.connections = std::max(1ul, std::stoul(value));
+        } else if (arg == "--requests") {
+            options.requests = std::stoul(value);
+        } else if (arg == "--pipeline") {
+            options.pipeline = std::max(1ul, std::stoul(value));
+        } else if (arg == "--expr") {
+            options.expr = value;
+        } else {
+            throw std::runtime_error{"bad argument " + arg};
+        }
+    }
+    if (options.socket_path.empty()) {
+        throw std::runtime_error{
+            "usage: scheme_client SOCKET [--connections C] [--requests N] [--pipeline D] "
+            "[--expr CODE]"};
+    }
+    return options;
+}
+
+static int Connect(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error{"socket path is too long: " + path};
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "connect " + path);
+    }
+    return fd;
+}
+
+// Sends the requests of one connection, keeping the pipeline full, and times every response.
+static void RunConnection(int fd, const Options& options, size_t count, Results* results) {
+    std::unordered_map<uint64_t, Clock::time_point> in_flight;
+    FrameReader reader;
+    uint64_t next_id = 0;
+    auto send_one = [&] {
+        auto frame = EncodeRequest({next_id, options.expr});
+        in_flight.emplace(next_id++, Clock::now());
+        return SendAll(fd, frame);
+    };
+
+    bool open = true;
+    while (open && next_id < std::min(count, options.pipeline)) {
+        open = send_one();
+    }
+    while (open && !in_flight.empty()) {
+        std::string_view frame;
+        if (!reader.Next(&frame)) {
+            open = reader.Fill(fd);
+            continue;
+        }
+        Response response;
+        auto it = DecodeResponse(frame, &response) ? in_flight.find(response.id) : in_flight.end();
+        if (it == in_flight.end()) {
+            break;
+        }
+        std::chrono::duration<double, std::micro> latency = Clock::now() - it->second;
+        results->latencies.push_back(latency.count());
+        results->statuses[static_cast<size_t>(response.status)] += 1;
+        in_flight.erase(it);
+        if (next_id < count) {
+            open = send_one();
+        }
+    }
+    results->lost = in_flight.size() + (count - next_id);
+}
+
+static double Percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(fraction * sorted.size());
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv) {
+    try {
+        auto options = ParseOptions(argc, argv);
+
+        std::vector<int> fds;
+        for (size_t i = 0; i < options.connections; ++i) {
+            fds.push_back(Connect(options.socket_path));
+        }
+
+        std::vector<Results> results(options.connections);
+        std::vector<std::thread> threads;
+        auto start = Clock::now();
+        for (size_t i = 0; i < options.connections; ++i) {
+            size_t count = options.requests / options.connections +
+                           (i < options.requests % options.connections);
+            threads.emplace_back(RunConnection, fds[i], std::cref(options), count, &results[i]);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        for (int fd : fds) {
+            close(fd);
+        }
+
+        Results total;
+        for (const auto& part : results) {
+            total.latencies.insert(total.latencies.end(), part.latencies.begin(),
+                                   part.latencies.end());
+            for (size_t i = 0; i < std::size(total.statuses); ++i) {
+                total.statuses[i] += part.statuses[i];
+            }
+            total.lost += part.lost;
+        }
+        std::sort(total.latencies.begin(), total.latencies.end());
+
+        static constexpr const char* kStatusNames[] = {"ok", "syntax error", "runtime error",
+                                                       "name error", "timeout"};
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "responses:  " << total.latencies.size() << " in " << elapsed.count()
+                  << " s\n";
+        std::cout << "throughput: " << total.latencies.size() / elapsed.count() << " req/s\n";
+        std::cout << "latency:    p50 " << Percentile(total.latencies, 0.5) << " us, p99 "
+                  << Percentile(total.latencies, 0.99) << " us, p999 "
+                  << Percentile(total.latencies, 0.999) << " us, max "
+                  << (total.latencies.empty() ? 0 : total.latencies.back()) << " us\n";
+        for (size_t i = 0; i < std::size(total.statuses); ++i) {
+            if (total.statuses[i] > 0) {
+                std::cout << kStatusNames[i] << ": " << total.statuses[i] << "\n";
+            }
+        }
+        if (total.lost > 0) {
+            std::cout << "unanswered: " << total.lost << "\n";
+            return 1;
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "scheme_client: " << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
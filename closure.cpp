@@ -0,0 +1,405 @@
+#include "closure.h"
+
+// Procedure builtins can be shadowed by local bindings; syntax keywords can not be bound.
+static void CheckBindable(const std::string& name) {
+    auto builtin = Symbol::GetBuiltin(name);
+    if (builtin && !dynamic_cast<Procedure*>(builtin.get())) {
+        throw SyntaxError{"can not bind " + name + ": it is a syntax keyword"};
+    }
+}
+
+// The lambda is bound to name for good, so calls can bind it themselves.
+static void SetSelf(LambdaInfo* info, const std::string& name) {
+    if (std::count(info->params.begin(), info->params.end(), name) ||
+        std::count(info->locals.begin(), info->locals.end(), name)) {
+        return;
+    }
+    info->self = name;
+    info->free.erase(std::remove(info->free.begin(), info->free.end(), name), info->free.end());
+}
+
+void CollectDefines(const std::shared_ptr<Object>& expr, std::set<std::string>* names) {
+    Task::CheckStack();
+    auto cell = As<Cell>(expr);
+    if (!cell || HeadIs(cell, "quote") || HeadIs(cell, "lambda") || HeadIs(cell, "let") ||
+        HeadIs(cell, "let*") || HeadIs(cell, "letrec") || HeadIs(cell, "do") ||
+        HeadIs(cell, "guard")) {
+        return;
+    }
+    if (HeadIs(cell, "define")) {
+        if (auto rest = As<Cell>(cell->GetSecond())) {
+            auto target = rest->GetFirst();
+            if (auto signature = As<Cell>(target)) {
+                target = signature->GetFirst();
+            } else {
+                CollectDefines(rest->GetSecond(), names);
+            }
+            if (auto name = As<Symbol>(target)) {
+                names->insert(name->GetName());
+            }
+        }
+        return;
+    }
+
+    for (auto curr = expr; Is<Cell>(curr); curr = As<Cell>(curr)->GetSecond()) {
+        CollectDefines(As<Cell>(curr)->GetFirst(), names);
+    }
+}
+
+std::shared_ptr<Object> ClosureConverter::Convert(const std::shared_ptr<Object>& expr) {
+    globals_defined_.clear();
+    CollectDefines(expr, &globals_defined_);
+    Names names;
+    return Walk(expr, &names);
+}
+
+std::shared_ptr<LambdaForm> ClosureConverter::ConvertLambda(const std::shared_ptr<Object>& params,
+                                                            const std::shared_ptr<Object>& body) {
+    Names names;
+    return MakeLambda(params, body, &names);
+}
+
+std::shared_ptr<LetForm> ClosureConverter::ConvertLet(LetKind kind,
+                                                     const std::shared_ptr<Object>& rest) {
+    Names names;
+    return MakeLet(kind, rest, &names);
+}
+
+std::shared_ptr<Object> ClosureConverter::Walk(const std::shared_ptr<Object>& expr,
+                                               Names* names) {
+    Task::CheckStack();
+    if (auto symb = As<Symbol>(expr)) {
+        if (symb->IsShadowable() && (IsLocal(symb->GetName()) || IsGlobal(symb->GetName()))) {
+            symb = Symbol::MakeVariable(symb->GetName());
+        }
+        if (!symb->GetBuiltin()) {
+            names->refs.insert(symb->GetName());
+        }
+        return symb;
+    }
+
+    std::vector<std::shared_ptr<Object>> items;
+    if (!Is<Cell>(expr) || HeadIs(expr, "quote") || !ListToVector(expr, &items)) {
+        return expr;
+    }
+
+    if (HeadIs(expr, "lambda") && items.size() >= 3) {
+        return MakeLambda(items[1], VectorToList(items, 2), names);
+    }
+    // Globals may shadow procedure builtins, but not syntax keywords.
+    if ((HeadIs(expr, "define") || HeadIs(expr, "set!")) && items.size() >= 2) {
+        auto target = Is<Cell>(items[1]) ? As<Cell>(items[1])->GetFirst() : items[1];
+        if (auto name = As<Symbol>(target)) {
+            CheckBindable(name->GetName());
+        }
+    }
+    if (HeadIs(expr, "define") && items.size() >= 3 && Is<Cell>(items[1])) {
+        auto signature = As<Cell>(items[1]);
+        auto lambda = MakeLambda(signature->GetSecond(), VectorToList(items, 2), names);
+        if (auto name = As<Symbol>(signature->GetFirst())) {
+            names->defined[name->GetName()].push_back(lambda->GetInfo().get());
+        }
+        return VectorToList({items[0], signature->GetFirst(), lambda});
+    }
+    if ((HeadIs(expr, "delay") || HeadIs(expr, "delay-force")) && items.size() == 2) {
+        items[1] = MakeLambda(nullptr, VectorToList(items, 1), names);
+        return VectorToList(items);
+    }
+    if (HeadIs(expr, "cons-stream") && items.size() == 3) {
+        items[1] = Walk(items[1], names);
+        items[2] = MakeLambda(nullptr, VectorToList(items, 2), names);
+        return VectorToList(items);
+    }
+    if (HeadIs(expr, "guard") && items.size() >= 3) {
+        auto spec = As<Cell>(items[1]);
+        auto clauses = spec->GetSecond();
+        std::vector<std::shared_ptr<Object>> cases;
+        ListToVector(clauses, &cases);
+        auto last = cases.empty() ? nullptr : As<Cell>(cases.back());
+        if (!last || !HeadIs(last, "else")) {
+            auto reraise = VectorToList({std::make_shared<Symbol>("raise-continuable"),
+                                         spec->GetFirst()});
+            cases.push_back(VectorToList({std::make_shared<Symbol>("else"), reraise}));
+        }
+        cases.insert(cases.begin(), std::make_shared<Symbol>("cond"));
+
+        auto body = MakeLambda(nullptr, VectorToList(items, 2), names);
+        auto handler = MakeLambda(VectorToList({spec->GetFirst()}),
+                                  VectorToList({VectorToList(cases)}), names);
+        return VectorToList({items[0], body, handler});
+    }
+    for (auto [keyword, kind] : {std::pair{"let", LetKind::kLet}, {"let*", LetKind::kLetStar},
+                                 {"letrec", LetKind::kLetRec}, {"do", LetKind::kDo}}) {
+        if (HeadIs(expr, keyword)) {
+            return MakeLet(kind, As<Cell>(expr)->GetSecond(), names);
+        }
+    }
+
+    std::vector<bool> walk(items.size(), true);
+    bool assigns = HeadIs(expr, "set!") || HeadIs(expr, "set-car!") || HeadIs(expr, "set-cdr!");
+    if ((assigns || HeadIs(expr, "define")) && items.size() >= 2) {
+        if (auto target = As<Symbol>(items[1])) {
+            walk[1] = false;
+            if (assigns) {
+                names->refs.insert(target->GetName());
+                names->mutated.insert(target->GetName());
+            }
+        }
+        if (!HeadIs(expr, "define") && !HeadIs(expr, "set!") && items.size() == 3 &&
+            !Is<Cell>(items[2])) {
+            walk[2] = false;
+        }
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (!walk[i]) {
+            continue;
+        }
+        auto converted = Walk(items[i], names);
+        changed = changed || converted != items[i];
+        items[i] = converted;
+    }
+    auto result = changed ? As<Cell>(VectorToList(items)) : As<Cell>(expr);
+    if (changed && positions_) {
+        positions_->Inherit(result, expr.get());
+    }
+    if (HeadIs(expr, "define") && Is<Symbol>(items[1])) {
+        auto lambda = items.size() == 3 ? As<LambdaForm>(items[2]) : nullptr;
+        names->defined[As<Symbol>(items[1])->GetName()].push_back(
+            lambda ? lambda->GetInfo().get() : nullptr);
+    }
+
+    auto head = As<Symbol>(items.front());
+    if (mark_call_sites_ && head && !head->GetBuiltin() &&
+        !IsLocal(head->GetName())) {
+        result->MarkGlobalCallSite();
+    }
+    return result;
+}
+
+std::shared_ptr<LambdaForm> ClosureConverter::MakeLambda(const std::shared_ptr<Object>& params,
+                                                         const std::shared_ptr<Object>& body,
+                                                         Names* names) {
+    auto info = std::make_shared<LambdaInfo>();
+    std::vector<std::shared_ptr<Object>> items;
+    if (!ListToVector(params, &items)) {
+        throw SyntaxError{"lambda parameters should form a proper list"};
+    }
+    for (const auto& item : items) {
+        auto param = As<Symbol>(item);
+        if (!param) {
+            throw SyntaxError{"lambda parameters should be symbols"};
+        }
+        CheckBindable(param->GetName());
+        info->params.emplace_back(param->GetName());
+    }
+    if (HasDuplicates(info->params)) {
+        throw SyntaxError{"lambda parameters should be distinct"};
+    }
+
+    std::set<std::string> defines;
+    CollectDefines(body, &defines);
+    std::for_each(defines.begin(), defines.end(), CheckBindable);
+    std::set<std::string> bound(info->params.begin(), info->params.end());
+    bound.insert(defines.begin(), defines.end());
+
+    bound_.push_back(bound);
+    Names inner;
+    info->body = WalkBody(body, &inner);
+    bound_.pop_back();
+    SetSelfNames(inner, defines);
+
+    for (const auto& param : info->params) {
+        info->boxed.push_back(inner.mutated.count(param) || defines.count(param));
+    }
+    for (const auto& name : defines) {
+        if (!std::count(info->params.begin(), info->params.end(), name)) {
+            info->locals.push_back(name);
+        }
+    }
+    for (const auto& name : inner.refs) {
+        if (!bound.count(name)) {
+            info->free.push_back(name);
+            names->refs.insert(name);
+        }
+    }
+    for (const auto& name : inner.mutated) {
+        if (!bound.count(name)) {
+            names->mutated.insert(name);
+        }
+    }
+
+    return std::make_shared<LambdaForm>(info);
+}
+
+std::shared_ptr<LetForm> ClosureConverter::MakeLet(LetKind kind,
+                                                   const std::shared_ptr<Object>& rest,
+                                                   Names* names) {
+    auto info = std::make_shared<LetInfo>();
+    info->kind = kind;
+    std::vector<std::shared_ptr<Object>> items;
+    ListToVector(rest, &items);
+    size_t pos = 0;
+    if (kind == LetKind::kLet && !items.empty() && Is<Symbol>(items[0])) {
+        info->loop_name = As<Symbol>(items[0])->GetName();
+        CheckBindable(info->loop_name);
+        pos = 1;
+    }
+    if (items.size() < pos + 2) {
+        throw SyntaxError{"binding form should have bindings and a body"};
+    }
+
+    std::vector<std::shared_ptr<Object>> bindings;
+    std::vector<std::shared_ptr<Object>> params;
+    ListToVector(items[pos], &bindings);
+    for (const auto& binding : bindings) {
+        std::vector<std::shared_ptr<Object>> parts;
+        if (!ListToVector(binding, &parts) || parts.size() < 2 || parts.size() > 3 ||
+            !Is<Symbol>(parts[0])) {
+            throw SyntaxError{"binding should be a symbol with an init"};
+        }
+        params.push_back(parts[0]);
+        CheckBindable(As<Symbol>(parts[0])->GetName());
+        info->names.push_back(As<Symbol>(parts[0])->GetName());
+        info->inits.push_back(parts[1]);
+        info->steps.push_back(parts.size() == 3 ? parts[2] : nullptr);
+    }
+    // Only let* binds its names one after another, so only it may rebind a name.
+    if (kind != LetKind::kLetStar && HasDuplicates(info->names)) {
+        throw SyntaxError{"binding form names should be distinct"};
+    }
+
+    auto body = VectorToList(items, pos + 1);
+    if (kind == LetKind::kDo) {
+        auto clause = As<Cell>(items[1]);
+        if (!clause) {
+            throw SyntaxError{"do should have a test clause"};
+        }
+        info->test = clause->GetFirst();
+        info->result = clause->GetSecond();
+        body = VectorToList(items, 2);
+    }
+
+    Names inner;
+    std::set<std::string> bound;
+    std::set<std::string> defines;
+    if (!info->loop_name.empty()) {
+        for (auto& init : info->inits) {
+            init = Walk(init, names);
+        }
+        bound.insert(info->loop_name);
+        bound_.push_back(bound);
+        info->loop = MakeLambda(VectorToList(params), body, &inner);
+        bound_.pop_back();
+        if (!inner.mutated.count(info->loop_name)) {
+            SetSelf(info->loop->GetInfo().get(), info->loop_name);
+        }
+    } else {
+        CollectDefines(body, &defines);
+        std::for_each(defines.begin(), defines.end(), CheckBindable);
+        bound.insert(info->names.begin(), info->names.end());
+        bound.insert(defines.begin(), defines.end());
+
+        if (kind == LetKind::kLetStar) {
+            std::set<std::string> prefix;
+            for (size_t i = 0; i < info->inits.size(); ++i) {
+                Names init;
+                bound_.push_back(prefix);
+                info->inits[i] = Walk(info->inits[i], &init);
+                bound_.pop_back();
+                for (const auto& name : init.refs) {
+                    (prefix.count(name) ? inner : *names).refs.insert(name);
+                }
+                for (const auto& name : init.mutated) {
+                    (prefix.count(name) ? inner : *names).mutated.insert(name);
+                }
+                prefix.insert(info->names[i]);
+            }
+        } else if (kind != LetKind::kLetRec) {
+            for (auto& init : info->inits) {
+                init = Walk(init, names);
+            }
+        }
+
+        bound_.push_back(bound);
+        if (kind == LetKind::kLetRec) {
+            for (size_t i = 0; i < info->inits.size(); ++i) {
+                info->inits[i] = Walk(info->inits[i], &inner);
+                auto lambda = As<LambdaForm>(info->inits[i]);
+                inner.defined[info->names[i]].push_back(lambda ? lambda->GetInfo().get() : nullptr);
+            }
+        }
+        for (auto& step : info->steps) {
+            if (step) {
+                step = Walk(step, &inner);
+            }
+        }
+        if (info->test) {
+            info->test = Walk(info->test, &inner);
+            info->result = WalkBody(info->result, &inner);
+        }
+        info->body = WalkBody(body, &inner);
+        bound_.pop_back();
+        // A do body runs once per iteration, so its defines may bind a name more than once.
+        if (kind != LetKind::kDo) {
+            SetSelfNames(inner, bound);
+        }
+    }
+
+    for (const auto& name : info->names) {
+        info->boxed.push_back(kind == LetKind::kLetRec || inner.mutated.count(name) ||
+                              defines.count(name));
+    }
+    for (const auto& name : defines) {
+        if (!std::count(info->names.begin(), info->names.end(), name)) {
+            info->locals.push_back(name);
+        }
+    }
+    for (const auto& name : inner.refs) {
+        if (!bound.count(name)) {
+            names->refs.insert(name);
+        }
+    }
+    for (const auto& name : inner.mutated) {
+        if (!bound.count(name)) {
+            names->mutated.insert(name);
+        }
+    }
+
+    return std::make_shared<LetForm>(info);
+}
+
+std::shared_ptr<Object> ClosureConverter::WalkBody(const std::shared_ptr<Object>& body,
+                                                   Names* names) {
+    std::vector<std::shared_ptr<Object>> items;
+    ListToVector(body, &items);
+    for (auto& item : items) {
+        item = Walk(item, names);
+    }
+    return VectorToList(items);
+}
+
+// A lambda defined once under a name of the body that is never assigned always is its value.
+void ClosureConverter::SetSelfNames(const Names& inner, const std::set<std::string>& bound) const {
+    for (const auto& [name, lambdas] : inner.defined) {
+        if (bound.count(name) && lambdas.size() == 1 && lambdas[0] && !inner.mutated.count(name)) {
+            SetSelf(lambdas[0], name);
+        }
+    }
+}
+
+// Bound in the global scope or by a define of the converted form; calls to a builtin of the
+// name then go to the global instead.
+bool ClosureConverter::IsGlobal(const std::string& name) const {
+    return globals_defined_.count(name) || (globals_ && globals_->Contains(name));
+}
+
+bool ClosureConverter::IsLocal(const std::string& name) const {
+    for (const auto& names : bound_) {
+        if (names.count(name)) {
+            return true;
+        }
+    }
+    return false;
+}
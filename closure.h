@@ -0,0 +1,54 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "object.h"
+#include "parser.h"
+
+// Adds the names that the defines in expr bind in the body expr is part of. Nested bodies of
+// lambdas and binding forms are not searched.
+void CollectDefines(const std::shared_ptr<Object>& expr, std::set<std::string>* names);
+
+class ClosureConverter {
+public:
+    // With globals, builtin names bound there are converted to plain global variables. Lists
+    // rebuilt from lists in positions inherit their positions.
+    explicit ClosureConverter(bool mark_call_sites = true, const Scope* globals = nullptr,
+                              SourceMap* positions = nullptr)
+        : mark_call_sites_(mark_call_sites), globals_(globals), positions_(positions) {
+    }
+
+    std::shared_ptr<Object> Convert(const std::shared_ptr<Object>& expr);
+
+    std::shared_ptr<LambdaForm> ConvertLambda(const std::shared_ptr<Object>& params,
+                                              const std::shared_ptr<Object>& body);
+    std::shared_ptr<LetForm> ConvertLet(LetKind kind, const std::shared_ptr<Object>& rest);
+
+private:
+    struct Names {
+        std::set<std::string> refs{};
+        std::set<std::string> mutated{};
+        // Values defined in the body by name; nullptr for anything but a lambda.
+        std::map<std::string, std::vector<LambdaInfo*>> defined{};
+    };
+
+    std::shared_ptr<Object> Walk(const std::shared_ptr<Object>& expr, Names* names);
+    std::shared_ptr<LambdaForm> MakeLambda(const std::shared_ptr<Object>& params,
+                                           const std::shared_ptr<Object>& body, Names* names);
+    std::shared_ptr<LetForm> MakeLet(LetKind kind, const std::shared_ptr<Object>& rest,
+                                     Names* names);
+    std::shared_ptr<Object> WalkBody(const std::shared_ptr<Object>& body, Names* names);
+    bool IsLocal(const std::string& name) const;
+    bool IsGlobal(const std::string& name) const;
+    void SetSelfNames(const Names& inner, const std::set<std::string>& bound) const;
+
+    bool mark_call_sites_;
+    const Scope* globals_;
+    SourceMap* positions_;
+    std::set<std::string> globals_defined_{};
+    std::vector<std::set<std::string>> bound_{};
+};
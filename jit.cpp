@@ -0,0 +1,446 @@
+#include "jit.h"
+
+#include <cstring>
+#include <set>
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define SCHEME_JIT_X86_64 1
+#endif
+
+#ifdef SCHEME_JIT_X86_64
+
+// Condition codes of the x86-64 jcc instruction family.
+enum JitCondition : uint8_t {
+    kEqual = 0x4,
+    kNotEqual = 0x5,
+    kLess = 0xC,
+    kGreaterEqual = 0xD,
+    kLessEqual = 0xE,
+    kGreater = 0xF,
+};
+
+// Compiles a lambda body with one template per form. Every value is an untagged int64 in
+// rax, pending operands live on the machine stack and rbx points at the argument array. The
+// entry saves its stack pointer in r14 and the lowest one self calls may reach in r12, the
+// higher of the budget and the stack limit of the run state, which r13 points at. A self call
+// below that unwinds to the entry and reports the failure. One past the last step calls out to
+// yield; the stack is aligned there and no value is pending in rax or rcx. Tail self calls
+// overwrite the arguments and jump back to the body.
+class JitCompiler {
+public:
+    JitCompiler(const LambdaInfo& info, const Object* self, Scope& root, uint64_t next_slice)
+        : info_(info), self_(self), root_(root), next_slice_(next_slice) {
+    }
+
+    bool Compile() {
+        if (info_.params.size() > JitCode::kMaxParams || !info_.locals.empty() || !info_.body ||
+            As<Cell>(info_.body)->GetSecond()) {
+            return false;
+        }
+        for (bool boxed : info_.boxed) {
+            if (boxed) {
+                return false;
+            }
+        }
+
+        // push rbp; mov rbp, rsp; push rbx, r12, r13, r14; mov r13, rsi; lea r12, [rsp - budget]
+        Emit({0x55, 0x48, 0x89, 0xE5, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x49, 0x89, 0xF5,
+              0x4C, 0x8D, 0xA4, 0x24});
+        EmitImm(-static_cast<int64_t>(JitCode::kStackBudget), 4);
+        // cmp r12, [r13 + 16]; cmovb r12, [r13 + 16]; mov r14, rsp; call body
+        Emit({0x4D, 0x3B, 0x65, 0x10, 0x4D, 0x0F, 0x42, 0x65, 0x10, 0x49, 0x89, 0xE6, 0xE8});
+        size_t call = code_.size();
+        EmitImm(0, 4);
+        size_t done = code_.size();
+        Emit({0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0x5D, 0xC3});
+        // mov rsp, r14; mov byte [r13 + 8], 1; xor eax, eax; jmp done
+        bail_ = code_.size();
+        Emit({0x4C, 0x89, 0xF4, 0x41, 0xC6, 0x45, 0x08, 0x01, 0x31, 0xC0, 0xE9});
+        EmitImm(static_cast<int64_t>(done) - static_cast<int64_t>(code_.size() + 4), 4);
+
+        body_ = code_.size();
+        PatchJump(call);
+        Emit({0x53, 0x48, 0x89, 0xFB});
+        start_ = code_.size();
+        if (!CompileValue(As<Cell>(info_.body)->GetFirst(), true)) {
+            return false;
+        }
+        Emit({0x5B, 0xC3});
+        return true;
+    }
+
+    const std::vector<uint8_t>& GetCode() const {
+        return code_;
+    }
+
+    std::vector<std::string> GetSelfNames() const {
+        return {self_names_.begin(), self_names_.end()};
+    }
+
+    std::vector<std::string> GetBuiltinNames() const {
+        return {builtin_names_.begin(), builtin_names_.end()};
+    }
+
+private:
+    bool CompileValue(const std::shared_ptr<Object>& expr, bool tail = false) {
+        Task::CheckStack();
+        if (auto folded = As<FoldedCall>(expr)) {
+            for (const auto& name : folded->GetNames()) {
+                if (!UseBuiltin(name)) {
+                    return false;
+                }
+            }
+            return CompileValue(folded->GetValue(), tail);
+        }
+        if (auto number = As<Number>(expr)) {
+            Emit({0x48, 0xB8});
+            EmitImm(number->GetValue(), 8);
+            return true;
+        }
+        if (auto symb = As<Symbol>(expr)) {
+            auto index = ParamIndex(symb->GetName());
+            if (index == info_.params.size()) {
+                return false;
+            }
+            Emit({0x48, 0x8B, 0x83});
+            EmitImm(static_cast<int64_t>(8 * index), 4);
+            return true;
+        }
+
+        std::vector<std::shared_ptr<Object>> items;
+        auto head = SplitCall(expr, &items);
+        if (!head) {
+            return false;
+        }
+        if (head->GetBuiltin()) {
+            const auto& name = head->GetLookupName();
+            if (name == "if") {
+                return items.size() == 3 && CompileIf(items, tail);
+            }
+            if (name == "+" || name == "*" || name == "-" || name == "max" || name == "min") {
+                return UseBuiltin(name) && CompileArithmetic(name, items);
+            }
+            return false;
+        }
+        if (IsSelf(head->GetName())) {
+            if (items.size() != info_.params.size()) {
+                return false;
+            }
+            return tail && depth_ == 0 ? CompileTailCall(items) : CompileSelfCall(items);
+        }
+        return false;
+    }
+
+    bool CompileIf(const std::vector<std::shared_ptr<Object>>& items, bool tail) {
+        std::vector<size_t> false_jumps;
+        if (!CompileCondition(items[0], &false_jumps) || !CompileValue(items[1], tail)) {
+            return false;
+        }
+        auto end_jump = EmitJump();
+        for (auto jump : false_jumps) {
+            PatchJump(jump);
+        }
+        if (!CompileValue(items[2], tail)) {
+            return false;
+        }
+        PatchJump(end_jump);
+        return true;
+    }
+
+    bool CompileArithmetic(const std::string& name,
+                           const std::vector<std::shared_ptr<Object>>& items) {
+        if (items.empty()) {
+            if (name != "+" && name != "*") {
+                return false;
+            }
+            return CompileValue(std::make_shared<Number>(name == "+" ? 0 : 1));
+        }
+        if (!CompileValue(items[0])) {
+            return false;
+        }
+        for (size_t i = 1; i < items.size(); ++i) {
+            if (!CompileOperand(items[i])) {
+                return false;
+            }
+            if (name == "+") {
+                Emit({0x48, 0x01, 0xC8});
+            } else if (name == "-") {
+                Emit({0x48, 0x29, 0xC1, 0x48, 0x89, 0xC8});
+            } else if (name == "*") {
+                Emit({0x48, 0x0F, 0xAF, 0xC1});
+            } else {
+                Emit({0x48, 0x39, 0xC1, 0x48, 0x0F, name == "max" ? uint8_t{0x4F} : uint8_t{0x4C},
+                      0xC1});
+            }
+        }
+        return true;
+    }
+
+    bool CompileCondition(const std::shared_ptr<Object>& expr, std::vector<size_t>* false_jumps) {
+        if (auto boolean = As<Boolean>(expr)) {
+            if (!boolean->GetValue()) {
+                false_jumps->push_back(EmitJump());
+            }
+            return true;
+        }
+
+        std::vector<std::shared_ptr<Object>> items;
+        auto head = SplitCall(expr, &items);
+        if (!head || !head->GetBuiltin() || items.size() != 2) {
+            return false;
+        }
+        JitCondition inverse;
+        const auto& name = head->GetLookupName();
+        if (name == "=") {
+            inverse = kNotEqual;
+        } else if (name == "<") {
+            inverse = kGreaterEqual;
+        } else if (name == ">") {
+            inverse = kLessEqual;
+        } else if (name == "<=") {
+            inverse = kGreater;
+        } else if (name == ">=") {
+            inverse = kLess;
+        } else {
+            return false;
+        }
+
+        if (!UseBuiltin(name) || !CompileValue(items[0]) || !CompileOperand(items[1])) {
+            return false;
+        }
+        Emit({0x48, 0x39, 0xC1, 0x0F, static_cast<uint8_t>(0x80 | inverse)});
+        false_jumps->push_back(code_.size());
+        EmitImm(0, 4);
+        return true;
+    }
+
+    // Keeps the left operand in rcx and the right one in rax.
+    bool CompileOperand(const std::shared_ptr<Object>& expr) {
+        Emit({0x50});
+        depth_ += 1;
+        if (!CompileValue(expr)) {
+            return false;
+        }
+        Emit({0x59});
+        depth_ -= 1;
+        return true;
+    }
+
+    bool CompileSelfCall(const std::vector<std::shared_ptr<Object>>& args) {
+        size_t pad = (depth_ + args.size()) % 2;
+        if (pad) {
+            Emit({0x48, 0x83, 0xEC, 0x08});
+            depth_ += 1;
+        }
+        for (size_t i = args.size(); i > 0; --i) {
+            if (!CompileValue(args[i - 1])) {
+                return false;
+            }
+            Emit({0x50});
+            depth_ += 1;
+        }
+        // cmp rsp, r12; jb bail; mov rdi, rsp; call body
+        Emit({0x4C, 0x39, 0xE4, 0x0F, 0x82});
+        EmitImm(static_cast<int64_t>(bail_) - static_cast<int64_t>(code_.size() + 4), 4);
+        EmitStep();
+        Emit({0x48, 0x89, 0xE7, 0xE8});
+        EmitImm(static_cast<int64_t>(body_) - static_cast<int64_t>(code_.size() + 4), 4);
+        Emit({0x48, 0x81, 0xC4});
+        EmitImm(static_cast<int64_t>(8 * (args.size() + pad)), 4);
+        depth_ -= args.size() + pad;
+        return true;
+    }
+
+    // The new arguments are all computed before any of the old ones is overwritten.
+    bool CompileTailCall(const std::vector<std::shared_ptr<Object>>& args) {
+        for (size_t i = args.size(); i > 0; --i) {
+            if (!CompileValue(args[i - 1])) {
+                return false;
+            }
+            Emit({0x50});
+            depth_ += 1;
+        }
+        for (size_t i = 0; i < args.size(); ++i) {
+            Emit({0x58, 0x48, 0x89, 0x83});
+            EmitImm(static_cast<int64_t>(8 * i), 4);
+        }
+        depth_ -= args.size();
+        EmitStep();
+        Emit({0xE9});
+        EmitImm(static_cast<int64_t>(start_) - static_cast<int64_t>(code_.size() + 4), 4);
+        return true;
+    }
+
+    std::shared_ptr<Symbol> SplitCall(const std::shared_ptr<Object>& expr,
+                                      std::vector<std::shared_ptr<Object>>* args) const {
+        auto cell = As<Cell>(expr);
+        if (!cell) {
+            return nullptr;
+        }
+        for (auto curr = cell->GetSecond(); curr;) {
+            auto arg = As<Cell>(curr);
+            if (!arg) {
+                return nullptr;
+            }
+            args->push_back(arg->GetFirst());
+            curr = arg->GetSecond();
+        }
+        return As<Symbol>(cell->GetFirst());
+    }
+
+    size_t ParamIndex(const std::string& name) const {
+        size_t index = 0;
+        while (index < info_.params.size() && info_.params[index] != name) {
+            ++index;
+        }
+        return index;
+    }
+
+    // Called with a name that does not resolve to a builtin.
+    bool IsSelf(const std::string& name) {
+        if (ParamIndex(name) != info_.params.size()) {
+            return false;
+        }
+        if (name == info_.self) {
+            return true;
+        }
+        auto binding = root_.Find(name).first;
+        if (!binding || binding->Get().get() != self_) {
+            return false;
+        }
+        self_names_.insert(name);
+        return true;
+    }
+
+    // The operator is compiled inline only while no global shadows its builtin.
+    bool UseBuiltin(const std::string& name) {
+        if (root_.Contains(name)) {
+            return false;
+        }
+        builtin_names_.insert(name);
+        return true;
+    }
+
+    // dec qword [r13]; jnz next; mov rdi, r13; mov rax, NextSlice; call rax; test al, al;
+    // jz bail; next:
+    void EmitStep() {
+        Emit({0x49, 0xFF, 0x4D, 0x00, 0x75, 0x17, 0x4C, 0x89, 0xEF, 0x48, 0xB8});
+        EmitImm(static_cast<int64_t>(next_slice_), 8);
+        Emit({0xFF, 0xD0, 0x84, 0xC0, 0x0F, 0x84});
+        EmitImm(static_cast<int64_t>(bail_) - static_cast<int64_t>(code_.size() + 4), 4);
+    }
+
+    size_t EmitJump() {
+        Emit({0xE9});
+        EmitImm(0, 4);
+        return code_.size() - 4;
+    }
+
+    void PatchJump(size_t pos) {
+        auto offset = static_cast<int32_t>(code_.size() - (pos + 4));
+        std::memcpy(code_.data() + pos, &offset, 4);
+    }
+
+    void Emit(std::initializer_list<uint8_t> bytes) {
+        code_.insert(code_.end(), bytes);
+    }
+
+    void EmitImm(int64_t value, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            code_.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+        }
+    }
+
+    const LambdaInfo& info_;
+    const Object* self_;
+    Scope& root_;
+    uint64_t next_slice_;
+    std::vector<uint8_t> code_{};
+    std::set<std::string> self_names_{};
+    std::set<std::string> builtin_names_{};
+    size_t depth_ = 0;
+    size_t bail_ = 0;
+    size_t body_ = 0;
+    size_t start_ = 0;
+};
+
+std::unique_ptr<JitCode> JitCode::Compile(const LambdaInfo& info, const Object* self,
+                                          Scope& root) {
+    JitCompiler compiler(info, self, root, reinterpret_cast<uint64_t>(&JitCode::NextSlice));
+    if (!compiler.Compile()) {
+        return nullptr;
+    }
+
+    const auto& code = compiler.GetCode();
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = (code.size() + page - 1) / page * page;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return nullptr;
+    }
+    return std::unique_ptr<JitCode>(new JitCode(memory, size, compiler.GetSelfNames(),
+                                                compiler.GetBuiltinNames(), root.GetVersion()));
+}
+
+JitCode::~JitCode() {
+    munmap(code_, size_);
+}
+
+#else
+
+std::unique_ptr<JitCode> JitCode::Compile(const LambdaInfo&, const Object*, Scope&) {
+    return nullptr;
+}
+
+JitCode::~JitCode() = default;
+
+#endif
+
+JitCode::JitCode(void* code, size_t size, std::vector<std::string> self_names,
+                 std::vector<std::string> builtin_names, uint64_t version)
+    : code_(code),
+      size_(size),
+      entry_(reinterpret_cast<Entry>(code)),
+      self_names_(std::move(self_names)),
+      builtin_names_(std::move(builtin_names)),
+      version_(version) {
+}
+
+bool JitCode::NextSlice(RunState* state) {
+    try {
+        Task::Yield();
+    } catch (...) {
+        state->error = std::current_exception();
+        return false;
+    }
+    state->steps = Task::GetStepsLeft();
+    return true;
+}
+
+bool JitCode::CheckGuards(Scope& root, const Object* self) {
+    if (version_ == root.GetVersion()) {
+        return true;
+    }
+    for (const auto& name : self_names_) {
+        Scope::RecordRead(name);
+        auto binding = root.Find(name).first;
+        if (!binding || binding->Get().get() != self) {
+            return false;
+        }
+    }
+    for (const auto& name : builtin_names_) {
+        Scope::RecordRead(name);
+        if (root.Contains(name)) {
+            return false;
+        }
+    }
+    version_ = root.GetVersion();
+    return true;
+}
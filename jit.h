@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "object.h"
+#include "task.h"
+
+class JitCode {
+public:
+    static constexpr size_t kMaxParams = 8;
+    static constexpr size_t kThreshold = 1000;
+    // Machine stack that nested self calls of one run may take, unless less is left above the
+    // stack limit of the task.
+    static constexpr size_t kStackBudget = 512 << 10;
+
+    // Returns nullptr unless the lambda only uses fixnum arithmetic, comparisons, if and calls
+    // to itself through global names or its self name.
+    static std::unique_ptr<JitCode> Compile(const LambdaInfo& info, const Object* self,
+                                            Scope& root);
+
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+    ~JitCode();
+
+    // Every self call takes a step of the task slice, and the code yields where it is once the
+    // slice is used up. Returns nothing if the self calls went deeper than the stack budget
+    // allows; the code has no effects, so the call can be evaluated again by other means. A
+    // task cancelled while the code yielded is unwound once the code has returned.
+    inline std::optional<int64_t> Run(const int64_t* args) const {
+        RunState state{Task::GetStepsLeft(), false, Task::GetStackLimit()};
+        auto result = entry_(args, &state);
+        Task::SetStepsLeft(state.steps);
+        if (state.error) {
+            std::rethrow_exception(state.error);
+        }
+        if (state.failed) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    // The global names the code calls itself by still hold it and no global shadows a builtin it
+    // compiled inline.
+    bool CheckGuards(Scope& root, const Object* self);
+
+    static bool IsEnabled() {
+        return k_enabled.load(std::memory_order_relaxed);
+    }
+    static void SetEnabled(bool enabled) {
+        k_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+private:
+    struct RunState {
+        uint64_t steps;
+        bool failed;
+        uintptr_t stack_limit;
+        std::exception_ptr error{};
+    };
+    using Entry = int64_t (*)(const int64_t*, RunState*);
+
+    // Called by the code when its steps run out: yields and refills them from the next slice.
+    // Returns false if the task is cancelled meanwhile; the code then bails.
+    static bool NextSlice(RunState* state);
+
+    JitCode(void* code, size_t size, std::vector<std::string> self_names,
+            std::vector<std::string> builtin_names, uint64_t version);
+
+    inline static std::atomic<bool> k_enabled = true;
+
+    void* code_;
+    size_t size_;
+    Entry entry_;
+    std::vector<std::string> self_names_;
+    std::vector<std::string> builtin_names_;
+    uint64_t version_;
+};
@@ -0,0 +1,568 @@
+#include "macro.h"
+
+#include "closure.h"
+
+static bool IsEllipsis(const std::shared_ptr<Object>& obj) {
+    auto symb = As<Symbol>(obj);
+    return symb && symb->GetName() == "...";
+}
+
+static bool IsWildcard(const std::shared_ptr<Object>& obj) {
+    auto symb = As<Symbol>(obj);
+    return symb && symb->GetName() == "_";
+}
+
+// Syntax keywords and clause markers mean the same wherever a template puts them.
+static bool IsKeyword(const std::string& name) {
+    auto builtin = Symbol::GetBuiltin(name);
+    return (builtin && !dynamic_cast<Procedure*>(builtin.get())) || name == "else" ||
+           name == "=>" || name == "define-memoized";
+}
+
+// Adds the names of a parameter list, which may end in a rest parameter.
+static void CollectParams(const std::shared_ptr<Object>& params, std::set<std::string>* names) {
+    auto curr = params;
+    for (; Is<Cell>(curr); curr = As<Cell>(curr)->GetSecond()) {
+        if (auto symb = As<Symbol>(As<Cell>(curr)->GetFirst())) {
+            names->insert(symb->GetName());
+        }
+    }
+    if (auto symb = As<Symbol>(curr)) {
+        names->insert(symb->GetName());
+    }
+}
+
+static std::shared_ptr<Object> SplitList(const std::shared_ptr<Object>& list,
+                                         std::vector<std::shared_ptr<Object>>* items) {
+    auto curr = list;
+    while (auto cell = As<Cell>(curr)) {
+        items->emplace_back(cell->GetFirst());
+        curr = cell->GetSecond();
+    }
+    return curr;
+}
+
+template <class F>
+static std::shared_ptr<Object> MapItems(const std::shared_ptr<Object>& list, F fn) {
+    std::vector<std::shared_ptr<Object>> items;
+    auto tail = SplitList(list, &items);
+    bool changed = false;
+    for (size_t i = 0; i < items.size(); ++i) {
+        auto mapped = fn(i, items[i]);
+        changed = changed || mapped != items[i];
+        items[i] = mapped;
+    }
+    return changed ? VectorToList(items, 0, tail) : list;
+}
+
+static void CollectVars(const std::shared_ptr<Object>& pattern,
+                        const std::set<std::string>& literals, std::set<std::string>* vars) {
+    Task::CheckStack();
+    if (auto symb = As<Symbol>(pattern)) {
+        if (!literals.count(symb->GetName()) && !IsEllipsis(symb) && !IsWildcard(symb)) {
+            vars->insert(symb->GetName());
+        }
+        return;
+    }
+    if (auto cell = As<Cell>(pattern)) {
+        CollectVars(cell->GetFirst(), literals, vars);
+        CollectVars(cell->GetSecond(), literals, vars);
+    }
+}
+
+// Names the code binds locally; a define binds its name locally unless it is the whole code.
+static void CollectBinders(const std::shared_ptr<Object>& templ, std::set<std::string>* binders,
+                           bool nested = false) {
+    Task::CheckStack();
+    auto cell = As<Cell>(templ);
+    if (!cell || HeadIs(cell, "quote")) {
+        return;
+    }
+
+    auto add = [binders](const std::shared_ptr<Object>& obj) {
+        if (auto symb = As<Symbol>(obj); symb && !IsEllipsis(symb)) {
+            binders->insert(symb->GetName());
+        }
+    };
+    auto rest = As<Cell>(cell->GetSecond());
+    auto params = [&add](std::shared_ptr<Object> params) {
+        for (; Is<Cell>(params); params = As<Cell>(params)->GetSecond()) {
+            add(As<Cell>(params)->GetFirst());
+        }
+        add(params);
+    };
+    if (HeadIs(cell, "lambda") && rest) {
+        params(rest->GetFirst());
+    }
+    if (HeadIs(cell, "define") && rest) {
+        auto target = rest->GetFirst();
+        if (auto signature = As<Cell>(target)) {
+            params(signature->GetSecond());
+            target = signature->GetFirst();
+        }
+        if (nested) {
+            add(target);
+        }
+    }
+    if ((HeadIs(cell, "let") || HeadIs(cell, "let*") || HeadIs(cell, "letrec") ||
+         HeadIs(cell, "do")) &&
+        rest) {
+        if (Is<Symbol>(rest->GetFirst())) {
+            add(rest->GetFirst());
+            rest = As<Cell>(rest->GetSecond());
+        }
+        for (auto curr = rest ? As<Cell>(rest->GetFirst()) : nullptr; curr;
+             curr = As<Cell>(curr->GetSecond())) {
+            if (auto binding = As<Cell>(curr->GetFirst())) {
+                add(binding->GetFirst());
+            }
+        }
+    }
+
+    if (HeadIs(cell, "guard") && rest && Is<Cell>(rest->GetFirst())) {
+        add(As<Cell>(rest->GetFirst())->GetFirst());
+    }
+
+    for (auto curr = templ; Is<Cell>(curr); curr = As<Cell>(curr)->GetSecond()) {
+        CollectBinders(As<Cell>(curr)->GetFirst(), binders, true);
+    }
+}
+
+static bool SameConstant(const std::shared_ptr<Object>& pattern,
+                         const std::shared_ptr<Object>& form) {
+    if (auto number = As<Number>(pattern)) {
+        return Is<Number>(form) && As<Number>(form)->GetValue() == number->GetValue();
+    }
+    if (auto boolean = As<Boolean>(pattern)) {
+        return Is<Boolean>(form) && As<Boolean>(form)->GetValue() == boolean->GetValue();
+    }
+    if (auto str = As<String>(pattern)) {
+        return Is<String>(form) && As<String>(form)->GetView() == str->GetView();
+    }
+    return false;
+}
+
+std::shared_ptr<Object> MacroExpander::Expand(const std::shared_ptr<Object>& expr) {
+    bound_.clear();
+    if (HeadIs(expr, "define-syntax")) {
+        DefineSyntax(expr);
+        return nullptr;
+    }
+    return ExpandForm(expr, 0);
+}
+
+void MacroExpander::DefineSyntax(const std::shared_ptr<Object>& form) {
+    std::vector<std::shared_ptr<Object>> items;
+    SplitList(form, &items);
+    if (items.size() != 3 || !Is<Symbol>(items[1]) || !HeadIs(items[2], "syntax-rules")) {
+        throw SyntaxError{"define-syntax should bind a symbol to syntax-rules"};
+    }
+
+    std::vector<std::shared_ptr<Object>> spec;
+    if (SplitList(items[2], &spec) || spec.size() < 2) {
+        throw SyntaxError{"syntax-rules should have a literal list and rules"};
+    }
+    Macro macro;
+    std::vector<std::shared_ptr<Object>> literals;
+    if (SplitList(spec[1], &literals)) {
+        throw SyntaxError{"syntax-rules literals should form a proper list"};
+    }
+    for (const auto& literal : literals) {
+        if (!Is<Symbol>(literal)) {
+            throw SyntaxError{"syntax-rules literals should be symbols"};
+        }
+        macro.literals.insert(As<Symbol>(literal)->GetName());
+    }
+    for (size_t i = 2; i < spec.size(); ++i) {
+        std::vector<std::shared_ptr<Object>> rule;
+        if (SplitList(spec[i], &rule) || rule.size() != 2 || !Is<Cell>(rule[0])) {
+            throw SyntaxError{"syntax-rules rule should be a pattern and a template"};
+        }
+        macro.rules.push_back({rule[0], rule[1]});
+    }
+
+    macros_[As<Symbol>(items[1])->GetName()] = std::move(macro);
+    stats_.defined_macros += 1;
+}
+
+// (define-memoized (name . params) body ...) => (define name (memoize (lambda params body ...)))
+static std::shared_ptr<Object> ExpandMemoized(const std::shared_ptr<Cell>& form) {
+    auto rest = As<Cell>(form->GetSecond());
+    auto signature = rest ? As<Cell>(rest->GetFirst()) : nullptr;
+    if (!signature || !Is<Symbol>(signature->GetFirst()) || !Is<Cell>(rest->GetSecond())) {
+        throw SyntaxError{"define-memoized should have a signature and a body"};
+    }
+
+    auto lambda = Cell::Make(std::make_shared<Symbol>("lambda"),
+                             Cell::Make(signature->GetSecond(), rest->GetSecond()));
+    auto memoize =
+        Cell::Make(std::make_shared<Symbol>("memoize"), Cell::Make(std::move(lambda), nullptr));
+    return Cell::Make(std::make_shared<Symbol>("define"),
+                      Cell::Make(signature->GetFirst(), Cell::Make(std::move(memoize), nullptr)));
+}
+
+std::shared_ptr<Object> MacroExpander::ExpandForm(const std::shared_ptr<Object>& expr,
+                                                  size_t depth) {
+    Task::CheckStack();
+    if (depth > kMaxDepth) {
+        throw SyntaxError{"macro expansion is too deep"};
+    }
+    auto cell = As<Cell>(expr);
+    if (!cell) {
+        return expr;
+    }
+
+    auto expand = [this, depth](const std::shared_ptr<Object>& item) {
+        return ExpandForm(item, depth);
+    };
+    auto expand_from = [&expand](size_t from) {
+        return [&expand, from](size_t i, const std::shared_ptr<Object>& item) {
+            return i < from ? item : expand(item);
+        };
+    };
+    // Expands the item where the names are bound too.
+    auto expand_in = [this, depth](const std::set<std::string>& names,
+                                   const std::shared_ptr<Object>& item) {
+        return ExpandScoped(item, depth, names);
+    };
+
+    auto head = As<Symbol>(cell->GetFirst());
+    if (!head) {
+        return MapItems(expr, expand_from(0));
+    }
+    const auto& name = head->GetName();
+    if (name == "quote") {
+        return expr;
+    }
+    if (name == "define-syntax") {
+        throw SyntaxError{"define-syntax is only allowed at top level"};
+    }
+    // A local binding hides a macro of the same name, but not from the templates that use it.
+    const auto& global = head->GetGlobalName();
+    auto it = global.empty() ? (IsBound(name) ? macros_.end() : macros_.find(name))
+                             : macros_.find(global);
+    if (it != macros_.end()) {
+        stats_.expanded_macros += 1;
+        return ExpandForm(ApplyMacro(it->second, expr), depth + 1);
+    }
+    if (name == "define-memoized" && !IsBound(name)) {
+        return ExpandForm(ExpandMemoized(cell), depth);
+    }
+
+    auto rest = As<Cell>(cell->GetSecond());
+    auto signature = rest && name == "define" ? As<Cell>(rest->GetFirst()) : nullptr;
+    if ((name == "lambda" && rest) || signature) {
+        std::set<std::string> names;
+        CollectParams(signature ? signature->GetSecond() : rest->GetFirst(), &names);
+        for (auto body = rest->GetSecond(); Is<Cell>(body); body = As<Cell>(body)->GetSecond()) {
+            CollectDefines(As<Cell>(body)->GetFirst(), &names);
+        }
+        return MapItems(expr, [&](size_t i, const std::shared_ptr<Object>& item) {
+            return i < 2 ? item : expand_in(names, item);
+        });
+    }
+    if (name == "define" || name == "set!") {
+        return MapItems(expr, expand_from(2));
+    }
+    if (name == "let" || name == "let*" || name == "letrec" || name == "do") {
+        size_t pos = rest && name == "let" && Is<Symbol>(rest->GetFirst()) ? 2 : 1;
+        // Inits see the names let* bound before them and all the names letrec binds; do steps,
+        // the exit clause and every body see all the names.
+        std::vector<std::shared_ptr<Object>> items, bindings;
+        SplitList(expr, &items);
+        if (pos < items.size()) {
+            SplitList(items[pos], &bindings);
+        }
+        std::set<std::string> names, before;
+        if (pos == 2) {
+            names.insert(As<Symbol>(items[1])->GetName());
+        }
+        for (const auto& binding : bindings) {
+            auto var = Is<Cell>(binding) ? As<Symbol>(As<Cell>(binding)->GetFirst()) : nullptr;
+            if (var) {
+                names.insert(var->GetName());
+            }
+        }
+        for (size_t i = pos + 1; name != "do" && i < items.size(); ++i) {
+            CollectDefines(items[i], &names);
+        }
+        return MapItems(expr, [&](size_t i, const std::shared_ptr<Object>& item) {
+            if (i == pos) {
+                return MapItems(item, [&](size_t, const std::shared_ptr<Object>& binding) {
+                    auto mapped = MapItems(binding, [&](size_t j, const auto& part) {
+                        if (j == 0) {
+                            return part;
+                        }
+                        if (name == "letrec" || (name == "do" && j == 2)) {
+                            return expand_in(names, part);
+                        }
+                        return name == "let*" ? expand_in(before, part) : expand(part);
+                    });
+                    if (auto var = Is<Cell>(binding) ? As<Symbol>(As<Cell>(binding)->GetFirst())
+                                                     : nullptr) {
+                        before.insert(var->GetName());
+                    }
+                    return mapped;
+                });
+            }
+            if (name == "do" && i == 2) {
+                return MapItems(item, [&](size_t, const auto& part) {
+                    return expand_in(names, part);
+                });
+            }
+            return i == 0 || (pos == 2 && i == 1) ? item : expand_in(names, item);
+        });
+    }
+    if (name == "cond") {
+        return MapItems(expr, [&](size_t i, const std::shared_ptr<Object>& clause) {
+            return i == 0 ? clause : MapItems(clause, expand_from(0));
+        });
+    }
+    if (name == "guard") {
+        return MapItems(expr, [&](size_t i, const std::shared_ptr<Object>& item) {
+            if (i != 1) {
+                return i == 0 ? item : expand(item);
+            }
+            std::set<std::string> names;
+            if (auto spec = As<Cell>(item); spec && Is<Symbol>(spec->GetFirst())) {
+                names.insert(As<Symbol>(spec->GetFirst())->GetName());
+            }
+            return MapItems(item, [&](size_t j, const std::shared_ptr<Object>& clause) {
+                return j == 0 ? clause : MapItems(clause, [&](size_t, const auto& part) {
+                    return expand_in(names, part);
+                });
+            });
+        });
+    }
+    return MapItems(expr, expand_from(0));
+}
+
+std::shared_ptr<Object> MacroExpander::ExpandScoped(const std::shared_ptr<Object>& expr,
+                                                    size_t depth, std::set<std::string> names) {
+    bound_.push_back(std::move(names));
+    auto result = ExpandForm(expr, depth);
+    bound_.pop_back();
+    return result;
+}
+
+bool MacroExpander::IsBound(const std::string& name) const {
+    return std::any_of(bound_.begin(), bound_.end(),
+                       [&name](const auto& names) { return names.count(name); });
+}
+
+std::shared_ptr<Object> MacroExpander::ApplyMacro(const Macro& macro,
+                                                  const std::shared_ptr<Object>& form) {
+    for (const auto& rule : macro.rules) {
+        Matches matches;
+        if (!MatchPattern(macro, As<Cell>(rule.pattern)->GetSecond(),
+                          As<Cell>(form)->GetSecond(), &matches)) {
+            continue;
+        }
+
+        Hygiene hygiene;
+        std::set<std::string> binders;
+        CollectBinders(rule.templ, &binders);
+        for (const auto& binder : binders) {
+            if (!matches.count(binder)) {
+                hygiene.renames[binder] = binder + "." + std::to_string(++renames_);
+            }
+        }
+        for (const auto& names : bound_) {
+            hygiene.captured.insert(names.begin(), names.end());
+        }
+        // The caller's code may bind where the template places it: a symbol, as a binder, or the
+        // binding forms within a larger piece.
+        auto capture = [&hygiene](const auto& self, const Match& match) -> void {
+            if (auto symb = As<Symbol>(match.value)) {
+                hygiene.captured.insert(symb->GetName());
+            }
+            CollectBinders(match.value, &hygiene.captured, true);
+            for (const auto& item : match.items) {
+                self(self, item);
+            }
+        };
+        for (const auto& [var, match] : matches) {
+            capture(capture, match);
+        }
+        return Instantiate(rule.templ, Bindings{&matches}, hygiene);
+    }
+    throw SyntaxError{"no syntax-rules pattern matches " + form->Stringify()};
+}
+
+bool MacroExpander::MatchPattern(const Macro& macro, const std::shared_ptr<Object>& pattern,
+                                 const std::shared_ptr<Object>& form, Matches* matches) const {
+    Task::CheckStack();
+    if (auto symb = As<Symbol>(pattern)) {
+        if (macro.literals.count(symb->GetName())) {
+            return Is<Symbol>(form) && As<Symbol>(form)->GetName() == symb->GetName();
+        }
+        if (!IsWildcard(symb)) {
+            (*matches)[symb->GetName()] = Match{form};
+        }
+        return true;
+    }
+    if (!pattern) {
+        return !form;
+    }
+    if (!Is<Cell>(pattern)) {
+        return SameConstant(pattern, form);
+    }
+
+    std::vector<std::shared_ptr<Object>> patterns;
+    auto pattern_tail = SplitList(pattern, &patterns);
+    std::vector<std::shared_ptr<Object>> items;
+    auto tail = SplitList(form, &items);
+
+    size_t ellipsis = patterns.size();
+    for (size_t i = 0; i + 1 < patterns.size(); ++i) {
+        if (IsEllipsis(patterns[i + 1])) {
+            ellipsis = i;
+            break;
+        }
+    }
+    size_t after = ellipsis < patterns.size() ? patterns.size() - ellipsis - 2 : 0;
+    size_t required = std::min(ellipsis, patterns.size()) + after;
+    if (items.size() < required ||
+        (ellipsis == patterns.size() && !pattern_tail && items.size() != required)) {
+        return false;
+    }
+
+    size_t repeated = ellipsis < patterns.size() ? items.size() - required : 0;
+    size_t used = ellipsis == patterns.size() ? patterns.size() : items.size();
+    for (size_t i = 0; i < std::min(ellipsis, patterns.size()); ++i) {
+        if (!MatchPattern(macro, patterns[i], items[i], matches)) {
+            return false;
+        }
+    }
+    if (ellipsis < patterns.size()) {
+        std::set<std::string> vars;
+        CollectVars(patterns[ellipsis], macro.literals, &vars);
+        for (const auto& var : vars) {
+            (*matches)[var] = Match{nullptr, {}, true};
+        }
+        for (size_t j = 0; j < repeated; ++j) {
+            Matches sub;
+            if (!MatchPattern(macro, patterns[ellipsis], items[ellipsis + j], &sub)) {
+                return false;
+            }
+            for (const auto& var : vars) {
+                (*matches)[var].items.push_back(std::move(sub[var]));
+            }
+        }
+        for (size_t k = 0; k < after; ++k) {
+            if (!MatchPattern(macro, patterns[ellipsis + 2 + k], items[ellipsis + repeated + k],
+                              matches)) {
+                return false;
+            }
+        }
+    }
+
+    if (!pattern_tail) {
+        return !tail;
+    }
+    std::vector<std::shared_ptr<Object>> rest(items.begin() + used, items.end());
+    return MatchPattern(macro, pattern_tail, VectorToList(rest, 0, tail), matches);
+}
+
+const MacroExpander::Match* MacroExpander::Bindings::Find(const std::string& name) const {
+    for (auto layer = this; layer; layer = layer->outer) {
+        for (const auto& [var, match] : layer->items) {
+            if (*var == name) {
+                return match;
+            }
+        }
+        if (layer->matches) {
+            if (auto it = layer->matches->find(name); it != layer->matches->end()) {
+                return &it->second;
+            }
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Object> MacroExpander::Instantiate(const std::shared_ptr<Object>& templ,
+                                                   const Bindings& bindings,
+                                                   const Hygiene& hygiene, bool quoted) const {
+    Task::CheckStack();
+    if (auto symb = As<Symbol>(templ)) {
+        const auto& name = symb->GetName();
+        if (auto match = bindings.Find(name)) {
+            if (match->sequence) {
+                throw SyntaxError{"pattern variable " + name + " should be followed by ..."};
+            }
+            return match->value;
+        }
+        if (quoted) {
+            return templ;
+        }
+        if (auto it = hygiene.renames.find(name); it != hygiene.renames.end()) {
+            return std::make_shared<Symbol>(it->second);
+        }
+        if (hygiene.captured.count(name) && !IsKeyword(name)) {
+            return Symbol::MakeGlobal(name);
+        }
+        return templ;
+    }
+    if (!Is<Cell>(templ)) {
+        return templ;
+    }
+
+    std::vector<std::shared_ptr<Object>> items;
+    auto tail = SplitList(templ, &items);
+    if (items.size() == 2 && !tail && IsEllipsis(items[0])) {
+        return items[1];
+    }
+    quoted = quoted || (HeadIs(templ, "quote") && !bindings.Find("quote"));
+    // The names the template defines keep their names unless they are renamed as binders.
+    bool defines = !quoted && HeadIs(templ, "define") && !bindings.Find("define");
+    auto instantiate = [&](size_t i, const std::shared_ptr<Object>& item,
+                           const Bindings& sub) -> std::shared_ptr<Object> {
+        auto signature = As<Cell>(item);
+        auto target = As<Symbol>(signature ? signature->GetFirst() : item);
+        if (!defines || i != 1 || !target || sub.Find(target->GetName()) ||
+            hygiene.renames.count(target->GetName())) {
+            return Instantiate(item, sub, hygiene, quoted);
+        }
+        if (signature) {
+            return Cell::Make(target, Instantiate(signature->GetSecond(), sub, hygiene));
+        }
+        return item;
+    };
+
+    std::vector<std::shared_ptr<Object>> result;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i + 1 == items.size() || !IsEllipsis(items[i + 1])) {
+            result.push_back(instantiate(i, items[i], bindings));
+            continue;
+        }
+
+        std::set<std::string> vars;
+        CollectVars(items[i], {}, &vars);
+        std::vector<std::pair<const std::string*, const Match*>> sequences;
+        for (const auto& var : vars) {
+            if (auto match = bindings.Find(var); match && match->sequence) {
+                sequences.emplace_back(&var, match);
+            }
+        }
+        if (sequences.empty()) {
+            throw SyntaxError{"... should follow a template with pattern variables"};
+        }
+        size_t size = sequences.front().second->items.size();
+        for (const auto& [var, match] : sequences) {
+            if (match->items.size() != size) {
+                throw SyntaxError{"pattern variables under ... have different lengths"};
+            }
+        }
+        Bindings sub{nullptr, {}, &bindings};
+        for (size_t j = 0; j < size; ++j) {
+            sub.items.clear();
+            for (const auto& [var, match] : sequences) {
+                sub.items.emplace_back(var, &match->items[j]);
+            }
+            result.push_back(instantiate(i, items[i], sub));
+        }
+        i += 1;
+    }
+
+    return VectorToList(result, 0, Instantiate(tail, bindings, hygiene, quoted));
+}
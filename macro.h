@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "object.h"
+
+struct MacroStats {
+    size_t defined_macros = 0;
+    size_t expanded_macros = 0;
+};
+
+class MacroExpander {
+    static constexpr size_t kMaxDepth = 1000;
+
+public:
+    std::shared_ptr<Object> Expand(const std::shared_ptr<Object>& expr);
+
+    const MacroStats& GetStats() const {
+        return stats_;
+    }
+
+private:
+    struct Rule {
+        std::shared_ptr<Object> pattern;
+        std::shared_ptr<Object> templ;
+    };
+
+    struct Macro {
+        std::set<std::string> literals{};
+        std::vector<Rule> rules{};
+    };
+
+    struct Match {
+        std::shared_ptr<Object> value{};
+        std::vector<Match> items{};
+        bool sequence = false;
+    };
+
+    using Matches = std::map<std::string, Match>;
+
+    // The pattern variables a template sees: those of the current ellipsis item first, then the
+    // ones around it. Layers point into the matches, so no item copies them.
+    struct Bindings {
+        const Matches* matches = nullptr;
+        std::vector<std::pair<const std::string*, const Match*>> items{};
+        const Bindings* outer = nullptr;
+
+        const Match* Find(const std::string& name) const;
+    };
+
+    // Template binders get fresh names; free template identifiers that a binding around the use,
+    // or one the expansion makes from the caller's code, could capture refer to globals instead.
+    struct Hygiene {
+        std::map<std::string, std::string> renames{};
+        std::set<std::string> captured{};
+    };
+
+    void DefineSyntax(const std::shared_ptr<Object>& form);
+    std::shared_ptr<Object> ExpandForm(const std::shared_ptr<Object>& expr, size_t depth);
+    std::shared_ptr<Object> ApplyMacro(const Macro& macro, const std::shared_ptr<Object>& form);
+
+    bool MatchPattern(const Macro& macro, const std::shared_ptr<Object>& pattern,
+                      const std::shared_ptr<Object>& form, Matches* matches) const;
+    std::shared_ptr<Object> Instantiate(const std::shared_ptr<Object>& templ,
+                                        const Bindings& bindings, const Hygiene& hygiene,
+                                        bool quoted = false) const;
+
+    bool IsBound(const std::string& name) const;
+    std::shared_ptr<Object> ExpandScoped(const std::shared_ptr<Object>& expr, size_t depth,
+                                         std::set<std::string> names);
+
+    std::map<std::string, Macro> macros_{};
+    // Names bound by the lambdas and binding forms around the form being expanded.
+    std::vector<std::set<std::string>> bound_{};
+    MacroStats stats_{};
+    size_t renames_ = 0;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "object.h"
+
+// Converts an evaluated argument to the parameter type of a native function.
+template <class T>
+struct NativeArgument;
+
+// Numbers that do not fit in T are rejected, not truncated.
+template <std::integral T>
+    requires(!std::same_as<T, bool>)
+struct NativeArgument<T> {
+    static T Convert(const std::shared_ptr<Object>& arg, const std::string& name) {
+        auto number = dynamic_cast<Number*>(arg.get());
+        if (!number) {
+            throw RuntimeError{name + ": expected a number"};
+        }
+        if (!std::in_range<T>(number->GetValue())) {
+            throw RuntimeError{name + ": number out of range"};
+        }
+        return static_cast<T>(number->GetValue());
+    }
+};
+
+template <>
+struct NativeArgument<bool> {
+    static bool Convert(const std::shared_ptr<Object>& arg, const std::string& name) {
+        auto boolean = dynamic_cast<Boolean*>(arg.get());
+        if (!boolean) {
+            throw RuntimeError{name + ": expected a boolean"};
+        }
+        return boolean->GetValue();
+    }
+};
+
+// Views stay valid for the duration of the call.
+template <>
+struct NativeArgument<std::string_view> {
+    static std::string_view Convert(const std::shared_ptr<Object>& arg, const std::string& name) {
+        auto str = dynamic_cast<String*>(arg.get());
+        if (!str) {
+            throw RuntimeError{name + ": expected a string"};
+        }
+        return str->GetView();
+    }
+};
+
+template <>
+struct NativeArgument<std::string> {
+    static std::string Convert(const std::shared_ptr<Object>& arg, const std::string& name) {
+        return std::string(NativeArgument<std::string_view>::Convert(arg, name));
+    }
+};
+
+template <class T>
+    requires std::derived_from<T, Object>
+struct NativeArgument<std::shared_ptr<T>> {
+    static std::shared_ptr<T> Convert(const std::shared_ptr<Object>& arg, const std::string& name) {
+        if constexpr (std::same_as<T, Object>) {
+            return arg;
+        } else {
+            auto value = As<T>(arg);
+            if (!value) {
+                throw RuntimeError{name + ": unexpected argument type"};
+            }
+            return value;
+        }
+    }
+};
+
+template <class R>
+std::shared_ptr<Object> MakeNativeResult(R&& value, const std::string& name) {
+    using T = std::remove_cvref_t<R>;
+    if constexpr (std::same_as<T, bool>) {
+        return std::make_shared<Boolean>(value);
+    } else if constexpr (std::integral<T>) {
+        if (!std::in_range<int64_t>(value)) {
+            throw RuntimeError{name + ": result out of range"};
+        }
+        return std::make_shared<Number>(static_cast<int64_t>(value));
+    } else if constexpr (std::same_as<T, std::string> || std::same_as<T, std::string_view>) {
+        return std::make_shared<String>(std::string_view(value));
+    } else {
+        return std::shared_ptr<Object>(std::forward<R>(value));
+    }
+}
+
+template <class F, class R, class... Args>
+class NativeProcedure : public Procedure {
+public:
+    NativeProcedure(std::string name, F callable)
+        : name_(std::move(name)), callable_(std::move(callable)) {
+    }
+
+    std::shared_ptr<Object> Call(Arguments args) override {
+        if (args.size() != sizeof...(Args)) {
+            throw RuntimeError{name_ + ": wrong number of arguments"};
+        }
+        return Invoke(args, std::index_sequence_for<Args...>{});
+    }
+
+private:
+    template <size_t... I>
+    std::shared_ptr<Object> Invoke(Arguments args, std::index_sequence<I...>) {
+        if constexpr (std::is_void_v<R>) {
+            callable_(NativeArgument<std::remove_cvref_t<Args>>::Convert(args[I], name_)...);
+            return nullptr;
+        } else {
+            return MakeNativeResult(
+                callable_(NativeArgument<std::remove_cvref_t<Args>>::Convert(args[I], name_)...),
+                name_);
+        }
+    }
+
+    std::string name_;
+    F callable_;
+};
+
+template <class R, class... Args>
+struct NativeTraits {
+    template <class F>
+    using Procedure = NativeProcedure<F, R, Args...>;
+};
+
+// Deduces the signature of function pointers and of lambdas and other function objects.
+template <class F>
+struct NativeSignature : NativeSignature<decltype(&F::operator())> {};
+
+template <class R, class... Args>
+struct NativeSignature<R (*)(Args...)> : NativeTraits<R, Args...> {};
+
+template <class C, class R, class... Args>
+struct NativeSignature<R (C::*)(Args...)> : NativeTraits<R, Args...> {};
+
+template <class C, class R, class... Args>
+struct NativeSignature<R (C::*)(Args...) const> : NativeTraits<R, Args...> {};
+
+template <class F>
+std::shared_ptr<Procedure> MakeNativeProcedure(std::string name, F callable) {
+    using Native = typename NativeSignature<F>::template Procedure<F>;
+    return std::make_shared<Native>(std::move(name), std::move(callable));
+}
@@ -1,149 +1,535 @@
 #include "object.h"
-#include <random>
+#include "closure.h"
+#include "jit.h"
+#include "port.h"
+#include "printer.h"
+#include <array>
+#include <bit>
+#include <optional>
+#include <sstream>
 
-size_t GetNumberOfArguments(const std::shared_ptr<Object>& head) {
-    if (!head) {
-        return 0;
+template <class T>
+static T* ArgumentAs(const std::shared_ptr<Object>& arg, const char* name) {
+    auto value = dynamic_cast<T*>(arg.get());
+    if (!value) {
+        throw RuntimeError{std::string(name) + ": unexpected argument type"};
     }
+    return value;
+}
 
-    auto cell = As<Cell>(head);
-    if (cell) {
-        return 1 + GetNumberOfArguments(cell->GetSecond());
+static void CheckArity(Arguments args, size_t min, size_t max, const char* name) {
+    if (args.size() < min || args.size() > max) {
+        throw RuntimeError{std::string(name) + ": wrong number of arguments"};
     }
-    return 1;
 }
 
-template <class T>
-std::vector<std::shared_ptr<Object>> MakeVector(const std::shared_ptr<Object>& head, Scope& scope) {
-    if (!head) {
-        return {};
+static bool IsFalse(const std::shared_ptr<Object>& value) {
+    auto boolean = As<Boolean>(value);
+    return boolean && !boolean->GetValue();
+}
+
+// Pairs are never mutated in place, so raw pointers into a list stay valid while its head is
+// alive, even across calls back into Scheme.
+static Cell* ListCell(Object* list, const char* name) {
+    auto cell = dynamic_cast<Cell*>(list);
+    if (!cell && list) {
+        throw RuntimeError{std::string(name) + ": expected a proper list"};
     }
+    return cell;
+}
+
+static Cell* NextCell(Cell* cell, const char* name) {
+    return ListCell(cell->GetSecond().get(), name);
+}
 
-    auto curr = head;
-    if (!Is<Cell>(curr) || !As<Cell>(curr)->GetFirst()) {
-        throw RuntimeError{"MakeVector arguments should have type T"};
+static std::vector<Cell*> ListHeads(Arguments lists, const char* name) {
+    std::vector<Cell*> heads;
+    for (const auto& list : lists) {
+        heads.push_back(ListCell(list.get(), name));
     }
-    std::vector<std::shared_ptr<Object>> result;
-    while (curr) {
-        auto t = As<T>(As<Cell>(curr)->GetFirst()->Eval(scope));
-        if (!t) {
-            throw RuntimeError{"MakeVector arguments should have type T"};
+    return heads;
+}
+
+// Pushes the current element of every list and advances them; false once one runs out.
+static bool PushRow(std::vector<Cell*>* heads, ValueStack::Frame* frame, const char* name) {
+    for (auto head : *heads) {
+        if (!head) {
+            return false;
         }
-        result.emplace_back(t);
-        auto cell = As<Cell>(curr);
+    }
+    for (auto& head : *heads) {
+        frame->Push(head->GetFirst());
+        head = NextCell(head, name);
+    }
+    return true;
+}
+
+// Returns false as soon as an argument raises.
+static bool EvalArguments(Object* head, Scope& scope, ValueStack::Frame* frame) {
+    for (auto curr = head; curr;) {
+        auto cell = dynamic_cast<Cell*>(curr);
         if (!cell) {
-            throw RuntimeError{"MakeVector deals only with lists"};
+            throw RuntimeError{"arguments should form a proper list"};
+        }
+        if (!cell->GetFirst()) {
+            throw RuntimeError{"empty object can not be an argument"};
+        }
+        auto value = cell->GetFirst()->Eval(scope);
+        if (IsRaising(value)) {
+            return false;
+        }
+        frame->Push(std::move(value));
+        curr = cell->GetSecond().get();
+    }
+    return true;
+}
+
+static std::shared_ptr<Object> EvalBody(Object* body, Scope& scope) {
+    std::shared_ptr<Object> res;
+    while (body) {
+        auto cell = static_cast<Cell*>(body);
+        res = cell->GetFirst()->Eval(scope);
+        if (IsRaising(res)) {
+            break;
         }
-        curr = cell->GetSecond();
+        body = cell->GetSecond().get();
+    }
+    return res;
+}
+
+// Builtins that call procedures can not hand Raising back through their own loops, so the raise
+// goes on to the guard as a RaisedError.
+static std::shared_ptr<Object> CallChecked(Procedure* proc, Arguments args) {
+    auto result = proc->Call(args);
+    if (IsRaising(result)) {
+        throw RaisedError{std::move(ValueStack::Current().GetRaised())};
+    }
+    return result;
+}
+
+static void BindSlot(Scope& frame, const std::string& name, const std::shared_ptr<Object>& value,
+                     bool boxed) {
+    if (boxed) {
+        frame.Bind(name, nullptr, std::make_shared<Box>(Box{value}));
+    } else {
+        frame.Bind(name, value, nullptr);
+    }
+}
+
+static void RebindSlot(Scope& frame, size_t index, const std::shared_ptr<Object>& value,
+                       bool boxed) {
+    auto& slot = frame.GetSlot(index);
+    if (boxed) {
+        slot.box = std::make_shared<Box>(Box{value});
+    } else {
+        slot.value = value;
+    }
+}
+
+// Errors thrown by a procedure are raised where it was called, so they unwind only its own
+// frames and go on to the guard or the top level as Raising.
+template <class F>
+static std::shared_ptr<Object> CallRaising(F&& call) {
+    ErrorKind kind;
+    std::string message;
+    try {
+        return call();
+    } catch (RaisedError& error) {
+        ValueStack::Current().GetRaised() = std::move(error.value);
+        return Raising::Get();
+    } catch (const RuntimeError& error) {
+        kind = ErrorKind::kRuntime;
+        message = error.what();
+    } catch (const NameError& error) {
+        kind = ErrorKind::kName;
+        message = error.what();
+    }
+    return RaiseError(kind, message);
+}
+
+std::shared_ptr<Object> Procedure::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
+    ValueStack::Frame frame(ValueStack::Current());
+    if (!EvalArguments(head.get(), scope, &frame)) {
+        return Raising::Get();
+    }
+
+    return CallRaising([&] { return Call(frame.Args()); });
+}
 
-        if (curr && !Is<Cell>(curr)) {
-            if (Is<T>(curr)) {
-                result.emplace_back(curr);
+// The Analyzer proved the arguments form a proper list of at most kMaxFixnumArgs expressions
+// that evaluate to numbers, and cached a FixnumProcedure that no global shadows as the callee.
+// The proof may rest on builtins a global shadowed since, e.g. (+ (length l) 1), so the values
+// are still checked, and the call falls back to the procedure's own checks on anything else.
+std::shared_ptr<Object> Cell::EvalFixnums(Scope& scope) {
+    int64_t values[kMaxFixnumArgs];
+    size_t count = 0;
+    for (auto arg = static_cast<Cell*>(second_.get()); arg;
+         arg = static_cast<Cell*>(arg->second_.get())) {
+        auto value = arg->first_->Eval(scope);
+        if (IsRaising(value)) {
+            return value;
+        }
+        auto number = dynamic_cast<Number*>(value.get());
+        if (!number) {
+            ValueStack::Frame frame(ValueStack::Current());
+            for (size_t i = 0; i < count; ++i) {
+                frame.Push(std::make_shared<Number>(values[i]));
+            }
+            frame.Push(std::move(value));
+            if (!EvalArguments(arg->second_.get(), scope, &frame)) {
+                return Raising::Get();
             }
+            return CallRaising(
+                [&] { return static_cast<Procedure*>(cache_->callee.get())->Call(frame.Args()); });
+        }
+        values[count++] = number->GetValue();
+    }
+    return CallRaising([&] {
+        return static_cast<FixnumProcedure*>(cache_->callee.get())->CallFixnums({values, count});
+    });
+}
+
+// The worklist of the release running on this thread. It is reused, so freeing a cell does not
+// allocate, and a release nested in one that is running only adds to it.
+struct ReleaseList {
+    ~ReleaseList() {
+        k_gone = true;
+    }
+
+    std::vector<std::shared_ptr<Object>> pending;
+    bool draining = false;
+
+    // Set once an exiting thread has destroyed its list; releases after that use their own.
+    inline static thread_local bool k_gone = false;
+};
+
+static thread_local ReleaseList k_release_list;
+
+Cell::~Cell() {
+    Release(std::move(first_), std::move(second_));
+}
+
+void Cell::Release(std::shared_ptr<Object> first, std::shared_ptr<Object> second) {
+    if (first.use_count() != 1 && second.use_count() != 1) {
+        return;
+    }
+    if (ReleaseList::k_gone) {
+        std::vector<std::shared_ptr<Object>> pending;
+        pending.emplace_back(std::move(first));
+        pending.emplace_back(std::move(second));
+        ReleaseAll(&pending);
+        return;
+    }
+
+    auto& list = k_release_list;
+    list.pending.emplace_back(std::move(first));
+    list.pending.emplace_back(std::move(second));
+    if (list.draining) {
+        return;
+    }
+    list.draining = true;
+    ReleaseAll(&list.pending);
+    list.draining = false;
+}
 
-            throw RuntimeError{"MakeVector arguments should have type T"};
+void Cell::ReleaseAll(std::vector<std::shared_ptr<Object>>* pending) {
+    while (!pending->empty()) {
+        auto obj = std::move(pending->back());
+        pending->pop_back();
+        if (obj.use_count() != 1) {
+            continue;
+        }
+        if (auto cell = dynamic_cast<Cell*>(obj.get())) {
+            pending->emplace_back(std::move(cell->first_));
+            pending->emplace_back(std::move(cell->second_));
+        } else if (auto promise = dynamic_cast<Promise*>(obj.get())) {
+            promise->Release(pending);
         }
     }
+}
 
-    return result;
+Promise::~Promise() {
+    if (state_ && state_.use_count() == 1) {
+        Cell::Release(std::move(state_->value));
+    }
 }
 
-std::shared_ptr<Object> ReturnItself::Apply(const std::shared_ptr<Object>& head, Scope&) {
-    if (Is<Cell>(head) && As<Cell>(head)->GetSecond() == nullptr) {
-        return As<Cell>(head)->GetFirst();
+void Promise::Release(std::vector<std::shared_ptr<Object>>* pending) {
+    if (state_ && state_.use_count() == 1) {
+        pending->emplace_back(std::move(state_->value));
     }
-    return head;
 }
 
-template <class T>
-std::shared_ptr<Object> IsType<T>::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    if (GetNumberOfArguments(head) != 1) {
-        throw RuntimeError{"IsType expects 1 argument"};
+// Forcing a delay-force promise adopts the state of the promise its thunk returns, so chains
+// of any length are forced in this loop rather than by recursion.
+std::shared_ptr<Object> Promise::Force(const std::shared_ptr<Object>& obj) {
+    auto promise = As<Promise>(obj);
+    if (!promise) {
+        return obj;
     }
-    if (!Is<Cell>(head)) {
-        throw RuntimeError{"IsType expects cell with 1 argument"};
+
+    while (!promise->state_->done) {
+        auto state = promise->state_;
+        auto thunk = state->value;
+        auto result = CallChecked(static_cast<Procedure*>(thunk.get()), {});
+        if (state->done) {
+            continue;
+        }
+
+        auto next = state->chained ? As<Promise>(result) : nullptr;
+        if (!next) {
+            state->done = true;
+            state->chained = false;
+            state->value = std::move(result);
+        } else if (next->state_ != state) {
+            *state = *next->state_;
+            next->state_ = state;
+        }
     }
+    return promise->state_->value;
+}
 
-    if (Is<T>(As<Cell>(head)->GetFirst()->Eval(scope))) {
-        return std::make_shared<Boolean>(true);
+std::string ErrorObject::Stringify() {
+    std::ostringstream out;
+    out << "#<error " << message_->Stringify();
+    for (auto curr = irritants_; Is<Cell>(curr); curr = As<Cell>(curr)->GetSecond()) {
+        out << ' ';
+        Print(As<Cell>(curr)->GetFirst(), out);
     }
-    return std::make_shared<Boolean>(false);
+    out << '>';
+    return out.str();
+}
+
+std::string Cell::Stringify() {
+    std::ostringstream out;
+    Print(shared_from_this(), out);
+    return out.str();
 }
 
-std::shared_ptr<Object> Not::Apply(const std::shared_ptr<Object>& head, Scope&) {
-    if (GetNumberOfArguments(head) != 1) {
-        throw RuntimeError{"Not expects 1 argument"};
+String::String(std::string_view value) : size_(value.size()) {
+    if (size_ <= kInlineCapacity) {
+        std::copy(value.begin(), value.end(), inline_);
+        return;
     }
-    if (!Is<Cell>(head)) {
-        throw RuntimeError{"Not expects cell with 1 argument"};
+
+    auto buffer = std::make_shared<char[]>(size_);
+    std::copy(value.begin(), value.end(), buffer.get());
+    data_ = std::shared_ptr<const char>(buffer, buffer.get());
+}
+
+String::String(std::shared_ptr<const char> data, size_t size)
+    : size_(size), data_(std::move(data)) {
+}
+
+String::String(std::shared_ptr<String> left, std::shared_ptr<String> right)
+    : size_(left->Size() + right->Size()), left_(std::move(left)), right_(std::move(right)) {
+}
+
+String::~String() {
+    ReleaseChildren();
+}
+
+void String::ReleaseChildren() {
+    if (!left_) {
+        return;
     }
-    auto val = As<Boolean>(As<Cell>(head)->GetFirst());
-    if (!val) {
-        return std::make_shared<Boolean>(false);
+
+    std::vector<std::shared_ptr<String>> pending;
+    pending.emplace_back(std::move(left_));
+    pending.emplace_back(std::move(right_));
+    while (!pending.empty()) {
+        auto node = std::move(pending.back());
+        pending.pop_back();
+        if (node.use_count() == 1 && node->left_) {
+            pending.emplace_back(std::move(node->left_));
+            pending.emplace_back(std::move(node->right_));
+        }
     }
+}
 
-    if (val->GetValue()) {
-        return std::make_shared<Boolean>(false);
+std::shared_ptr<String> String::Append(const std::vector<std::shared_ptr<String>>& parts) {
+    size_t total = 0;
+    for (const auto& part : parts) {
+        total += part->Size();
     }
-    return std::make_shared<Boolean>(true);
+
+    if (total <= kFlatAppendLimit) {
+        std::string flat;
+        flat.reserve(total);
+        for (const auto& part : parts) {
+            flat += part->GetView();
+        }
+        return std::make_shared<String>(flat);
+    }
+
+    std::shared_ptr<String> result;
+    for (const auto& part : parts) {
+        if (part->Size() == 0) {
+            continue;
+        }
+        result = result ? std::make_shared<String>(result, part) : part;
+    }
+    return result;
+}
+
+std::string_view String::GetView() {
+    if (left_) {
+        Flatten();
+    }
+    if (!data_) {
+        return std::string_view(inline_, size_);
+    }
+    return std::string_view(data_.get(), size_);
+}
+
+std::shared_ptr<String> String::Substring(size_t begin, size_t end) {
+    auto view = GetView();
+    if (end - begin <= kInlineCapacity) {
+        return std::make_shared<String>(view.substr(begin, end - begin));
+    }
+    return std::make_shared<String>(std::shared_ptr<const char>(data_, data_.get() + begin),
+                                    end - begin);
 }
 
-std::shared_ptr<Object> Abs::Apply(const std::shared_ptr<Object>& head, Scope&) {
-    if (GetNumberOfArguments(head) != 1) {
-        throw RuntimeError{"Not expects 1 argument"};
+void String::Flatten() {
+    auto buffer = std::make_shared<char[]>(size_);
+    size_t pos = 0;
+
+    std::vector<String*> pending{this};
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        if (node->left_) {
+            pending.push_back(node->right_.get());
+            pending.push_back(node->left_.get());
+            continue;
+        }
+        auto view = node->GetView();
+        std::copy(view.begin(), view.end(), buffer.get() + pos);
+        pos += view.size();
     }
-    if (!Is<Cell>(head)) {
-        throw RuntimeError{"Not expects cell with 1 argument"};
+
+    ReleaseChildren();
+    data_ = std::shared_ptr<const char>(buffer, buffer.get());
+}
+
+std::string String::Stringify() {
+    std::string res = "\"";
+    for (char c : GetView()) {
+        if (c == '"' || c == '\\') {
+            res.push_back('\\');
+            res.push_back(c);
+        } else if (c == '\n') {
+            res += "\\n";
+        } else if (c == '\t') {
+            res += "\\t";
+        } else {
+            res.push_back(c);
+        }
     }
-    auto val = As<Number>(As<Cell>(head)->GetFirst());
-    if (!val) {
-        throw RuntimeError{"Abs expects a Number as an argument"};
+    res.push_back('"');
+
+    return res;
+}
+
+std::shared_ptr<Object> ReturnItself::Apply(const std::shared_ptr<Object>& head, Scope&) {
+    if (Is<Cell>(head) && As<Cell>(head)->GetSecond() == nullptr) {
+        return As<Cell>(head)->GetFirst();
     }
+    return head;
+}
+
+template <class T>
+std::shared_ptr<Object> IsType<T>::Call(Arguments args) {
+    CheckArity(args, 1, 1, "IsType");
+
+    return std::make_shared<Boolean>(Is<T>(args[0]));
+}
+
+std::shared_ptr<Object> Not::Call(Arguments args) {
+    CheckArity(args, 1, 1, "not");
+    auto val = dynamic_cast<Boolean*>(args[0].get());
+
+    return std::make_shared<Boolean>(val && !val->GetValue());
+}
+
+std::shared_ptr<Object> Abs::Call(Arguments args) {
+    CheckArity(args, 1, 1, "abs");
+
+    int64_t value = ArgumentAs<Number>(args[0], "abs")->GetValue();
+    return CallFixnums({&value, 1});
+}
 
-    return std::make_shared<Number>(std::abs(val->GetValue()));
+std::shared_ptr<Object> Abs::CallFixnums(std::span<const int64_t> args) {
+    return std::make_shared<Number>(std::abs(args[0]));
 }
 
 template <typename F>
-std::shared_ptr<Object> CompareNumbers<F>::Apply(const std::shared_ptr<Object>& head,
-                                                 Scope& scope) {
-    auto list = MakeVector<Number>(head, scope);
+std::shared_ptr<Object> CompareNumbers<F>::Call(Arguments args) {
+    bool result = true;
+    int64_t prev = 0;
+    for (size_t i = 0; i < args.size(); ++i) {
+        auto value = ArgumentAs<Number>(args[i], kNumericName<F>)->GetValue();
+        if (i > 0 && !f_(prev, value)) {
+            result = false;
+        }
+        prev = value;
+    }
 
-    F cmp{};
-    for (size_t i = 0; i + 1 < list.size(); ++i) {
-        if (!cmp(As<Number>(list[i])->GetValue(), As<Number>(list[i + 1])->GetValue())) {
+    return std::make_shared<Boolean>(result);
+}
+
+template <typename F>
+std::shared_ptr<Object> CompareNumbers<F>::CallFixnums(std::span<const int64_t> args) {
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (!f_(args[i - 1], args[i])) {
             return std::make_shared<Boolean>(false);
         }
     }
-
     return std::make_shared<Boolean>(true);
 }
 
 template <typename F, int64_t init, bool has_one>
-std::shared_ptr<Object> AccumulateNumbers<F, init, has_one>::Apply(
-    const std::shared_ptr<Object>& head, Scope& scope) {
-    auto list = MakeVector<Number>(head, scope);
+std::shared_ptr<Object> AccumulateNumbers<F, init, has_one>::Call(Arguments args) {
+    if (args.empty()) {
+        if (has_one) {
+            return std::make_shared<Number>(init);
+        }
+        throw RuntimeError{std::string(kNumericName<F>) + ": wrong number of arguments"};
+    }
+
+    F op{};
+    int64_t res = ArgumentAs<Number>(args[0], kNumericName<F>)->GetValue();
+    for (size_t i = 1; i < args.size(); ++i) {
+        res = op(res, ArgumentAs<Number>(args[i], kNumericName<F>)->GetValue());
+    }
+
+    return std::make_shared<Number>(res);
+}
 
-    if (list.empty()) {
+template <typename F, int64_t init, bool has_one>
+std::shared_ptr<Object> AccumulateNumbers<F, init, has_one>::CallFixnums(
+    std::span<const int64_t> args) {
+    if (args.empty()) {
         if (has_one) {
             return std::make_shared<Number>(init);
         }
-        throw RuntimeError{"AccumulateNumbers invokes op without one element"};
+        throw RuntimeError{std::string(kNumericName<F>) + ": wrong number of arguments"};
     }
 
     F op{};
-    int64_t res = As<Number>(list.front())->GetValue();
-    for (size_t i = 1; i < list.size(); ++i) {
-        res = op(res, As<Number>(list[i])->GetValue());
+    int64_t res = args[0];
+    for (size_t i = 1; i < args.size(); ++i) {
+        res = op(res, args[i]);
     }
 
     return std::make_shared<Number>(res);
 }
 
-std::shared_ptr<Object> IsPair::Apply(const std::shared_ptr<Object>& head_, Scope& scope) {
-    auto head = As<Cell>(head_)->GetFirst();
-    head = head->Eval(scope);
+std::shared_ptr<Object> IsPair::Call(Arguments args) {
+    CheckArity(args, 1, 1, "pair?");
 
-    auto cell = As<Cell>(head);
+    auto cell = As<Cell>(args[0]);
     if (!cell) {
         return std::make_shared<Boolean>(false);
     }
@@ -160,19 +546,21 @@ std::shared_ptr<Object> IsPair::Apply(const std::shared_ptr<Object>& head_, Scop
     return std::make_shared<Boolean>(Is<Number>(cell->GetSecond()));
 }
 
-std::shared_ptr<Object> IsNull::Apply(const std::shared_ptr<Object>& head_, Scope& scope) {
-    auto head = As<Cell>(head_)->GetFirst();
-    head = head->Eval(scope);
-    return std::make_shared<Boolean>(!head);
+std::shared_ptr<Object> IsNull::Call(Arguments args) {
+    CheckArity(args, 1, 1, "null?");
+
+    return std::make_shared<Boolean>(!args[0]);
 }
 
-std::shared_ptr<Object> IsList::Apply(const std::shared_ptr<Object>& head_, Scope& scope) {
-    auto head = As<Cell>(head_)->GetFirst();
-    head = head->Eval(scope);
-    if (!head) {
+std::shared_ptr<Object> IsList::Call(Arguments args) {
+    CheckArity(args, 1, 1, "list?");
+    if (!args[0]) {
         return std::make_shared<Boolean>(true);
     }
-    auto cell = As<Cell>(head);
+    auto cell = As<Cell>(args[0]);
+    if (!cell) {
+        return std::make_shared<Boolean>(false);
+    }
     while (Is<Cell>(cell->GetSecond())) {
         cell = As<Cell>(cell->GetSecond());
     }
@@ -183,186 +571,700 @@ std::shared_ptr<Object> IsList::Apply(const std::shared_ptr<Object>& head_, Scop
     return std::make_shared<Boolean>(true);
 }
 
-std::shared_ptr<Object> Cons::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    if (GetNumberOfArguments(head) != 2) {
-        throw RuntimeError{"Cons requires 2 arguments"};
-    }
-
-    auto cell = As<Cell>(head);
-    auto first = cell->GetFirst()->Eval(scope);
-    auto second = As<Cell>(cell->GetSecond())->GetFirst()->Eval(scope);
+static bool AreEqual(Object* lhs, Object* rhs) {
+    Task::CheckStack();
+    while (lhs != rhs) {
+        if (!lhs || !rhs) {
+            return false;
+        }
+        auto lhs_cell = dynamic_cast<Cell*>(lhs);
+        auto rhs_cell = dynamic_cast<Cell*>(rhs);
+        if (lhs_cell && rhs_cell) {
+            if (!AreEqual(lhs_cell->GetFirst().get(), rhs_cell->GetFirst().get())) {
+                return false;
+            }
+            lhs = lhs_cell->GetSecond().get();
+            rhs = rhs_cell->GetSecond().get();
+            continue;
+        }
 
-    return std::make_shared<Cell>(first, second);
+        if (auto number = dynamic_cast<Number*>(lhs)) {
+            auto other = dynamic_cast<Number*>(rhs);
+            return other && other->GetValue() == number->GetValue();
+        }
+        if (auto boolean = dynamic_cast<Boolean*>(lhs)) {
+            auto other = dynamic_cast<Boolean*>(rhs);
+            return other && other->GetValue() == boolean->GetValue();
+        }
+        if (auto symb = dynamic_cast<Symbol*>(lhs)) {
+            auto other = dynamic_cast<Symbol*>(rhs);
+            return other && other->GetName() == symb->GetName();
+        }
+        if (auto str = dynamic_cast<String*>(lhs)) {
+            auto other = dynamic_cast<String*>(rhs);
+            return other && other->GetView() == str->GetView();
+        }
+        return false;
+    }
+    return true;
 }
 
-std::shared_ptr<Object> Car::Apply(const std::shared_ptr<Object>& head_, Scope& scope) {
-    auto head = As<Cell>(head_)->GetFirst();
-    head = head->Eval(scope);
-    if (!head) {
-        throw RuntimeError{"Car requires not empty cell as argument"};
+// Identity, except that numbers, booleans and symbols compare by value since the reader does
+// not share them.
+static bool AreEqv(Object* lhs, Object* rhs) {
+    if (lhs == rhs) {
+        return true;
     }
-    auto cell = As<Cell>(head);
-    if (!cell) {
-        cell = As<Cell>(head->Eval(scope));
+    if (auto number = dynamic_cast<Number*>(lhs)) {
+        auto other = dynamic_cast<Number*>(rhs);
+        return other && other->GetValue() == number->GetValue();
+    }
+    if (auto boolean = dynamic_cast<Boolean*>(lhs)) {
+        auto other = dynamic_cast<Boolean*>(rhs);
+        return other && other->GetValue() == boolean->GetValue();
     }
+    if (auto symb = dynamic_cast<Symbol*>(lhs)) {
+        auto other = dynamic_cast<Symbol*>(rhs);
+        return other && other->GetName() == symb->GetName();
+    }
+    return false;
+}
 
-    return As<Cell>(cell)->GetFirst();
+std::shared_ptr<Object> IsEqual::Call(Arguments args) {
+    CheckArity(args, 2, 2, "equal?");
+
+    return std::make_shared<Boolean>(AreEqual(args[0].get(), args[1].get()));
 }
 
-std::shared_ptr<Object> Cdr::Apply(const std::shared_ptr<Object>& head_, Scope& scope) {
-    auto head = As<Cell>(head_)->GetFirst();
-    head = head->Eval(scope);
-    if (!head) {
-        throw RuntimeError{"Cdr requires not empty cell as argument"};
-    }
-    auto cell = As<Cell>(head);
-    while (!cell) {
-        cell = As<Cell>(head->Eval(scope));
+std::shared_ptr<Object> MakePromise::Call(Arguments args) {
+    CheckArity(args, 1, 1, "make-promise");
+    if (Is<Promise>(args[0])) {
+        return args[0];
     }
 
-    return As<Cell>(cell)->GetSecond();
+    return std::make_shared<Promise>(args[0], true, false);
 }
 
-std::shared_ptr<Object> List::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    if (!head) {
-        return nullptr;
-    }
-    auto list = MakeVector<Number>(head, scope);
-    int sz = list.size();
-    std::shared_ptr<Object> cell = std::make_shared<Cell>(list[sz - 1], nullptr);
-    for (int i = sz - 2; i >= 0; --i) {
-        cell = std::make_shared<Cell>(list[i], cell);
-    }
+std::shared_ptr<Object> Force::Call(Arguments args) {
+    CheckArity(args, 1, 1, "force");
 
-    return cell;
+    return Promise::Force(args[0]);
 }
 
-std::shared_ptr<Object> ListRef::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    auto cell = As<Cell>(head);
-    if (!cell) {
-        throw RuntimeError{"list-ref expected 2 arguments"};
-    }
+std::shared_ptr<Object> IsPromise::Call(Arguments args) {
+    CheckArity(args, 1, 1, "promise?");
 
-    auto first = cell->GetFirst()->Eval(scope);
-    auto elems = MakeVector<Number>(first, scope);
-    auto second = As<Number>(As<Cell>(cell->GetSecond())->GetFirst());
-    if (!second) {
-        throw RuntimeError{"list-ref expected Number as 2 argument"};
-    }
+    return std::make_shared<Boolean>(Is<Promise>(args[0]));
+}
 
-    if (static_cast<size_t>(second->GetValue()) >= elems.size()) {
-        throw RuntimeError{"list-ref: index out of range"};
-    }
+std::shared_ptr<Object> StreamCar::Call(Arguments args) {
+    CheckArity(args, 1, 1, "stream-car");
 
-    return std::make_shared<Number>(As<Number>(elems[second->GetValue()])->GetValue());
+    return ArgumentAs<Cell>(args[0], "stream-car")->GetFirst();
 }
 
-std::shared_ptr<Object> ListTail::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    auto cell = As<Cell>(head);
-    if (!cell) {
-        throw RuntimeError{"list-ref expected 2 arguments"};
-    }
+std::shared_ptr<Object> StreamCdr::Call(Arguments args) {
+    CheckArity(args, 1, 1, "stream-cdr");
 
-    auto first = cell->GetFirst()->Eval(scope);
-    auto elems = MakeVector<Number>(first, scope);
-    auto second = As<Number>(As<Cell>(cell->GetSecond())->GetFirst());
-    if (!second) {
-        throw RuntimeError{"list-ref expected Number as 2 argument"};
-    }
+    return Promise::Force(ArgumentAs<Cell>(args[0], "stream-cdr")->GetSecond());
+}
 
-    size_t idx = second->GetValue();
+std::shared_ptr<Object> IsStreamPair::Call(Arguments args) {
+    CheckArity(args, 1, 1, "stream-pair?");
+    auto cell = As<Cell>(args[0]);
 
-    if (idx > elems.size()) {
-        throw RuntimeError{"list-ref: index out of range"};
+    return std::make_shared<Boolean>(cell && Is<Promise>(cell->GetSecond()));
+}
+
+template <bool to_list>
+std::shared_ptr<Object> StreamWalk<to_list>::Call(Arguments args) {
+    const char* name = to_list ? "stream-take" : "stream-tail";
+    CheckArity(args, 2, 2, name);
+    auto count = ArgumentAs<Number>(args[1], name)->GetValue();
+
+    auto stream = args[0];
+    std::vector<std::shared_ptr<Object>> items;
+    for (int64_t i = 0; i < count; ++i) {
+        auto cell = As<Cell>(stream);
+        if (!cell) {
+            if (to_list) {
+                break;
+            }
+            throw RuntimeError{"stream-tail: stream is too short"};
+        }
+        if (to_list) {
+            items.push_back(cell->GetFirst());
+        }
+        stream = Promise::Force(cell->GetSecond());
     }
-    if (idx == elems.size()) {
-        return nullptr;
+    if (!to_list) {
+        return stream;
     }
 
-    int sz = elems.size();
-    std::shared_ptr<Object> list = std::make_shared<Cell>(elems[sz - 1], nullptr);
-    for (size_t i = static_cast<int>(sz) - 2; i >= idx; --i) {
-        list = std::make_shared<Cell>(elems[i], list);
+    std::shared_ptr<Object> list;
+    for (size_t i = items.size(); i > 0; --i) {
+        list = Cell::Make(std::move(items[i - 1]), list);
     }
-
     return list;
 }
 
-template <bool op>
-std::shared_ptr<Object> LogicOp<op>::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    auto arg = head;
-    std::shared_ptr<Object> last;
-    if (!head) {
-        return std::make_shared<Boolean>(op);
+std::shared_ptr<Object> StreamRef::Call(Arguments args) {
+    CheckArity(args, 2, 2, "stream-ref");
+    auto stream = args[0];
+    for (auto count = ArgumentAs<Number>(args[1], "stream-ref")->GetValue(); count > 0; --count) {
+        stream = Promise::Force(ArgumentAs<Cell>(stream, "stream-ref")->GetSecond());
     }
-    auto args = GetNumberOfArguments(head);
-    while (args--) {
-        auto val = As<Cell>(arg)->GetFirst()->Eval(scope);
 
-        if (Is<Boolean>(val)) {
-            auto curr = As<Boolean>(val)->GetValue();
-            if (op) {
-                curr = !curr;
-            }
-            if (curr) {
-                return val;
-            }
-        }
+    return ArgumentAs<Cell>(stream, "stream-ref")->GetFirst();
+}
 
-        last = val;
-        arg = As<Cell>(arg)->GetSecond();
-    }
+std::shared_ptr<Object> Cons::Call(Arguments args) {
+    CheckArity(args, 2, 2, "Cons");
 
-    return last;
+    return Cell::Make(args[0], args[1]);
 }
 
-std::shared_ptr<Object> If::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    auto cell = As<Cell>(head);
-    auto cond = cell->GetFirst()->Eval(scope);
-    if (!Is<Boolean>(cond)) {
-        throw RuntimeError{"If condition must can be evaluated into Boolean"};
-    }
+std::shared_ptr<Object> Car::Call(Arguments args) {
+    CheckArity(args, 1, 1, "car");
 
-    if (As<Boolean>(cond)->GetValue()) {
-        return As<Cell>(cell->GetSecond())->GetFirst()->Eval(scope);
-    }
+    return ArgumentAs<Cell>(args[0], "car")->GetFirst();
+}
 
-    auto branches = As<Cell>(cell->GetSecond());
-    auto second_branch = branches->GetSecond();
-    if (As<Cell>(branches)->GetSecond() != nullptr) {
-        return As<Cell>(second_branch)->GetFirst()->Eval(scope);
-    }
+std::shared_ptr<Object> Cdr::Call(Arguments args) {
+    CheckArity(args, 1, 1, "cdr");
 
-    return nullptr;
+    return ArgumentAs<Cell>(args[0], "cdr")->GetSecond();
 }
 
-std::shared_ptr<Object> Define::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    auto cell = As<Cell>(head);
-    auto name = As<Symbol>(cell->GetFirst());
-    if (!name) {
-        auto lambda = As<Cell>(cell->GetFirst());
-        if (!lambda) {
-            throw RuntimeError{"Define should define a symbol or lambda"};
-        }
+std::shared_ptr<Object> List::Call(Arguments args) {
+    std::shared_ptr<Object> cell;
+    for (size_t i = args.size(); i > 0; --i) {
+        cell = Cell::Make(args[i - 1], cell);
+    }
 
-        auto curr_name = As<Symbol>(lambda->GetFirst())->GetName();
-        std::vector<std::string> args;
-        auto curr_args = lambda->GetSecond();
-        while (curr_args) {
-            args.emplace_back(As<Symbol>(As<Cell>(curr_args)->GetFirst())->GetName());
-            curr_args = As<Cell>(curr_args)->GetSecond();
-        }
+    return cell;
+}
 
-        auto body = As<Cell>(cell->GetSecond());
-        auto new_lambda = std::make_shared<LambdaFunction>(&scope, body, args);
-        scope.Assign(curr_name, new_lambda);
+std::shared_ptr<Object> ListRef::Call(Arguments args) {
+    CheckArity(args, 2, 2, "list-ref");
 
-        return nullptr;
+    auto idx = ArgumentAs<Number>(args[1], "list-ref")->GetValue();
+    auto cell = ListCell(args[0].get(), "list-ref");
+    for (; cell && idx > 0; --idx) {
+        cell = NextCell(cell, "list-ref");
+    }
+    if (!cell || idx < 0) {
+        throw RuntimeError{"list-ref: index out of range"};
     }
 
-    auto value = As<Cell>(cell->GetSecond())->GetFirst()->Eval(scope);
+    return cell->GetFirst();
+}
 
-    scope.Assign(name->GetName(), value);
+std::shared_ptr<Object> ListTail::Call(Arguments args) {
+    CheckArity(args, 2, 2, "list-tail");
+
+    auto idx = ArgumentAs<Number>(args[1], "list-tail")->GetValue();
+    auto list = args[0].get();
+    for (; idx > 0; --idx) {
+        auto cell = ListCell(list, "list-tail");
+        if (!cell) {
+            break;
+        }
+        list = cell->GetSecond().get();
+    }
+    if (idx != 0) {
+        throw RuntimeError{"list-tail: index out of range"};
+    }
+
+    return list ? list->shared_from_this() : nullptr;
+}
+
+std::shared_ptr<Object> Length::Call(Arguments args) {
+    CheckArity(args, 1, 1, "length");
+
+    int64_t length = 0;
+    for (auto cell = ListCell(args[0].get(), "length"); cell; cell = NextCell(cell, "length")) {
+        ++length;
+    }
+    return std::make_shared<Number>(length);
+}
+
+std::shared_ptr<Object> Append::Call(Arguments args) {
+    if (args.empty()) {
+        return nullptr;
+    }
+
+    ListBuilder result;
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        for (auto cell = ListCell(args[i].get(), "append"); cell; cell = NextCell(cell, "append")) {
+            result.Push(cell->GetFirst());
+        }
+    }
+    return result.Finish(args.back());
+}
+
+std::shared_ptr<Object> Reverse::Call(Arguments args) {
+    CheckArity(args, 1, 1, "reverse");
+
+    std::shared_ptr<Object> result;
+    for (auto cell = ListCell(args[0].get(), "reverse"); cell; cell = NextCell(cell, "reverse")) {
+        result = Cell::Make(cell->GetFirst(), std::move(result));
+    }
+    return result;
+}
+
+std::shared_ptr<Object> ListCopy::Call(Arguments args) {
+    CheckArity(args, 1, 1, "list-copy");
+
+    ListBuilder result;
+    auto list = args[0];
+    while (auto cell = dynamic_cast<Cell*>(list.get())) {
+        result.Push(cell->GetFirst());
+        list = cell->GetSecond();
+    }
+    return result.Finish(std::move(list));
+}
+
+template <bool collect>
+std::shared_ptr<Object> MapLists<collect>::Call(Arguments args) {
+    const char* name = collect ? "map" : "for-each";
+    CheckArity(args, 2, SIZE_MAX, name);
+    auto proc = ArgumentAs<Procedure>(args[0], name);
+    auto heads = ListHeads(args.subspan(1), name);
+
+    auto& stack = ValueStack::Current();
+    ListBuilder result;
+    while (true) {
+        Task::Tick();
+        ValueStack::Frame row(stack);
+        if (!PushRow(&heads, &row, name)) {
+            break;
+        }
+        auto value = CallChecked(proc, row.Args());
+        if constexpr (collect) {
+            result.Push(std::move(value));
+        }
+    }
+    return result.Finish();
+}
+
+std::shared_ptr<Object> Filter::Call(Arguments args) {
+    CheckArity(args, 2, 2, "filter");
+    auto pred = ArgumentAs<Procedure>(args[0], "filter");
+
+    auto& stack = ValueStack::Current();
+    ListBuilder result;
+    for (auto cell = ListCell(args[1].get(), "filter"); cell; cell = NextCell(cell, "filter")) {
+        Task::Tick();
+        ValueStack::Frame row(stack);
+        row.Push(cell->GetFirst());
+        if (!IsFalse(CallChecked(pred, row.Args()))) {
+            result.Push(cell->GetFirst());
+        }
+    }
+    return result.Finish();
+}
+
+// fold-left calls (proc acc x ...) from the front; fold-right calls (proc x ... acc) from the
+// back, after recording the pairs of every row.
+template <bool left>
+std::shared_ptr<Object> FoldLists<left>::Call(Arguments args) {
+    const char* name = left ? "fold-left" : "fold-right";
+    CheckArity(args, 3, SIZE_MAX, name);
+    auto proc = ArgumentAs<Procedure>(args[0], name);
+    auto heads = ListHeads(args.subspan(2), name);
+    auto acc = args[1];
+
+    auto& stack = ValueStack::Current();
+    if constexpr (left) {
+        while (true) {
+            Task::Tick();
+            ValueStack::Frame row(stack);
+            row.Push(acc);
+            if (!PushRow(&heads, &row, name)) {
+                break;
+            }
+            acc = CallChecked(proc, row.Args());
+        }
+        return acc;
+    }
+
+    std::vector<Cell*> rows;
+    while (std::all_of(heads.begin(), heads.end(), [](Cell* head) { return head; })) {
+        for (auto& head : heads) {
+            rows.push_back(head);
+            head = NextCell(head, name);
+        }
+    }
+    for (size_t end = rows.size(); end > 0; end -= heads.size()) {
+        Task::Tick();
+        ValueStack::Frame row(stack);
+        for (size_t i = end - heads.size(); i < end; ++i) {
+            row.Push(rows[i]->GetFirst());
+        }
+        row.Push(std::move(acc));
+        acc = CallChecked(proc, row.Args());
+    }
+    return acc;
+}
+
+template <bool eqv>
+std::shared_ptr<Object> FindEntry<eqv>::Call(Arguments args) {
+    const char* name = eqv ? "assq" : "assoc";
+    CheckArity(args, 2, eqv ? 2 : 3, name);
+    auto compare = args.size() == 3 ? ArgumentAs<Procedure>(args[2], name) : nullptr;
+
+    auto& stack = ValueStack::Current();
+    for (auto cell = ListCell(args[1].get(), name); cell; cell = NextCell(cell, name)) {
+        auto entry = ArgumentAs<Cell>(cell->GetFirst(), name);
+        bool found;
+        if (compare) {
+            ValueStack::Frame row(stack);
+            row.Push(args[0]);
+            row.Push(entry->GetFirst());
+            found = !IsFalse(CallChecked(compare, row.Args()));
+        } else if constexpr (eqv) {
+            found = AreEqv(args[0].get(), entry->GetFirst().get());
+        } else {
+            found = AreEqual(args[0].get(), entry->GetFirst().get());
+        }
+        if (found) {
+            return cell->GetFirst();
+        }
+    }
+    return std::make_shared<Boolean>(false);
+}
+
+std::shared_ptr<Object> Member::Call(Arguments args) {
+    CheckArity(args, 2, 3, "member");
+    auto compare = args.size() == 3 ? ArgumentAs<Procedure>(args[2], "member") : nullptr;
+
+    auto& stack = ValueStack::Current();
+    for (auto cell = ListCell(args[1].get(), "member"); cell; cell = NextCell(cell, "member")) {
+        bool found;
+        if (compare) {
+            ValueStack::Frame row(stack);
+            row.Push(args[0]);
+            row.Push(cell->GetFirst());
+            found = !IsFalse(CallChecked(compare, row.Args()));
+        } else {
+            found = AreEqual(args[0].get(), cell->GetFirst().get());
+        }
+        if (found) {
+            return cell->shared_from_this();
+        }
+    }
+    return std::make_shared<Boolean>(false);
+}
+
+// Bottom-up merge sort: stable, and safe whatever the comparator answers.
+std::shared_ptr<Object> Sort::Call(Arguments args) {
+    CheckArity(args, 2, 2, "sort");
+    auto less = ArgumentAs<Procedure>(args[1], "sort");
+
+    std::vector<std::shared_ptr<Object>> items;
+    for (auto cell = ListCell(args[0].get(), "sort"); cell; cell = NextCell(cell, "sort")) {
+        items.push_back(cell->GetFirst());
+    }
+
+    auto& stack = ValueStack::Current();
+    auto before = [&](const std::shared_ptr<Object>& lhs, const std::shared_ptr<Object>& rhs) {
+        Task::Tick();
+        ValueStack::Frame row(stack);
+        row.Push(lhs);
+        row.Push(rhs);
+        return !IsFalse(CallChecked(less, row.Args()));
+    };
+
+    std::vector<std::shared_ptr<Object>> merged(items.size());
+    for (size_t width = 1; width < items.size(); width *= 2) {
+        for (size_t begin = 0; begin < items.size(); begin += 2 * width) {
+            size_t mid = std::min(begin + width, items.size());
+            size_t end = std::min(begin + 2 * width, items.size());
+            size_t lhs = begin;
+            size_t rhs = mid;
+            for (size_t out = begin; out < end; ++out) {
+                if (lhs < mid && (rhs == end || !before(items[rhs], items[lhs]))) {
+                    merged[out] = std::move(items[lhs++]);
+                } else {
+                    merged[out] = std::move(items[rhs++]);
+                }
+            }
+        }
+        items.swap(merged);
+    }
+
+    std::shared_ptr<Object> result;
+    for (size_t i = items.size(); i > 0; --i) {
+        result = Cell::Make(std::move(items[i - 1]), std::move(result));
+    }
+    return result;
+}
+
+template <bool op>
+std::shared_ptr<Object> LogicOp<op>::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
+    if (!head) {
+        return std::make_shared<Boolean>(op);
+    }
+    std::shared_ptr<Object> last;
+    for (auto arg = head.get(); arg;) {
+        auto cell = dynamic_cast<Cell*>(arg);
+        if (!cell) {
+            throw SyntaxError{std::string(op ? "and" : "or") +
+                              " arguments should form a proper list"};
+        }
+        if (!cell->GetFirst()) {
+            throw RuntimeError{"empty object can not be an argument"};
+        }
+        auto val = cell->GetFirst()->Eval(scope);
+        if (IsRaising(val)) {
+            return val;
+        }
+
+        if (Is<Boolean>(val)) {
+            auto curr = As<Boolean>(val)->GetValue();
+            if (op) {
+                curr = !curr;
+            }
+            if (curr) {
+                return val;
+            }
+        }
+
+        last = std::move(val);
+        arg = cell->GetSecond().get();
+    }
+
+    return last;
+}
+
+// Returns the test and the branches; the parser checks the size of if forms, but not of dotted
+// ones. A missing else branch is nullptr.
+static std::array<Object*, 3> SplitIf(Object* head) {
+    std::array<Object*, 3> parts{};
+    size_t size = 0;
+    for (auto curr = head; curr; ++size) {
+        auto cell = dynamic_cast<Cell*>(curr);
+        if (!cell || size == parts.size()) {
+            throw SyntaxError{"if should have condition and 1 or 2 statements"};
+        }
+        parts[size] = cell->GetFirst().get();
+        if (!parts[size]) {
+            throw RuntimeError{"empty object can not be evaluated"};
+        }
+        curr = cell->GetSecond().get();
+    }
+    if (size < 2) {
+        throw SyntaxError{"if should have condition and 1 or 2 statements"};
+    }
+    return parts;
+}
+
+std::shared_ptr<Object> If::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
+    auto [test, then, otherwise] = SplitIf(head.get());
+    auto cond = test->Eval(scope);
+    if (IsRaising(cond)) {
+        return cond;
+    }
+    auto boolean = dynamic_cast<Boolean*>(cond.get());
+    if (!boolean) {
+        throw RuntimeError{"If condition must can be evaluated into Boolean"};
+    }
+
+    if (boolean->GetValue()) {
+        return then->Eval(scope);
+    }
+    return otherwise ? otherwise->Eval(scope) : nullptr;
+}
+
+std::shared_ptr<Object> Cond::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
+    std::shared_ptr<Object> result;
+    auto tail = SelectTail(head.get(), scope, &result);
+    return tail ? tail->Eval(scope) : result;
+}
+
+Object* Cond::SelectTail(Object* clauses, Scope& scope, std::shared_ptr<Object>* result) {
+    for (auto curr = static_cast<Cell*>(clauses); curr;
+         curr = static_cast<Cell*>(curr->GetSecond().get())) {
+        auto clause = static_cast<Cell*>(curr->GetFirst().get());
+        std::shared_ptr<Object> value;
+        auto keyword = As<Symbol>(clause->GetFirst());
+        if (!keyword || keyword->GetName() != "else") {
+            value = clause->GetFirst()->Eval(scope);
+            if (IsRaising(value)) {
+                *result = std::move(value);
+                return nullptr;
+            }
+            if (IsFalse(value)) {
+                continue;
+            }
+        }
+
+        auto body = static_cast<Cell*>(clause->GetSecond().get());
+        if (!body) {
+            *result = value;
+            return nullptr;
+        }
+        auto arrow = As<Symbol>(body->GetFirst());
+        if (arrow && arrow->GetName() == "=>") {
+            auto receiver = As<Cell>(body->GetSecond())->GetFirst()->Eval(scope);
+            if (IsRaising(receiver)) {
+                *result = std::move(receiver);
+                return nullptr;
+            }
+            auto proc = dynamic_cast<Procedure*>(receiver.get());
+            if (!proc) {
+                throw RuntimeError{"cond: => receiver should be a procedure"};
+            }
+            ValueStack::Frame args(ValueStack::Current());
+            args.Push(value);
+            *result = proc->Call(args.Args());
+            return nullptr;
+        }
+        for (; body->GetSecond(); body = static_cast<Cell*>(body->GetSecond().get())) {
+            auto value = body->GetFirst()->Eval(scope);
+            if (IsRaising(value)) {
+                *result = std::move(value);
+                return nullptr;
+            }
+        }
+        return body->GetFirst().get();
+    }
+
+    *result = nullptr;
+    return nullptr;
+}
+
+// Installs a handler for the dynamic extent of a call; guards install nullptr.
+class HandlerScope {
+public:
+    explicit HandlerScope(std::shared_ptr<Object> handler)
+        : handlers_(ValueStack::Current().GetHandlers()) {
+        handlers_.push_back(std::move(handler));
+    }
+    HandlerScope(const HandlerScope&) = delete;
+    HandlerScope& operator=(const HandlerScope&) = delete;
+
+    ~HandlerScope() {
+        handlers_.pop_back();
+    }
+
+private:
+    std::vector<std::shared_ptr<Object>>& handlers_;
+};
+
+// Uninstalls the innermost handler while it runs, so a raise from it goes further out.
+class OuterHandlerScope {
+public:
+    OuterHandlerScope() : handlers_(ValueStack::Current().GetHandlers()) {
+        handler_ = std::move(handlers_.back());
+        handlers_.pop_back();
+    }
+    OuterHandlerScope(const OuterHandlerScope&) = delete;
+    OuterHandlerScope& operator=(const OuterHandlerScope&) = delete;
+
+    ~OuterHandlerScope() {
+        handlers_.push_back(std::move(handler_));
+    }
+
+    const std::shared_ptr<Object>& GetHandler() const {
+        return handler_;
+    }
+
+private:
+    std::vector<std::shared_ptr<Object>>& handlers_;
+    std::shared_ptr<Object> handler_;
+};
+
+static std::shared_ptr<Object> CallHandler(const std::shared_ptr<Object>& handler,
+                                           std::shared_ptr<Object> condition) {
+    ValueStack::Frame args(ValueStack::Current());
+    args.Push(std::move(condition));
+    return static_cast<Procedure*>(handler.get())->Call(args.Args());
+}
+
+static std::shared_ptr<Object> MakeCondition(std::string_view message,
+                                             ErrorKind kind = ErrorKind::kRaised) {
+    return std::make_shared<ErrorObject>(std::make_shared<String>(message), nullptr, kind);
+}
+
+// The error object for an error the evaluator threw.
+static std::shared_ptr<Object> MakeCondition(const std::runtime_error& error) {
+    auto kind = dynamic_cast<const NameError*>(&error) ? ErrorKind::kName : ErrorKind::kRuntime;
+    return MakeCondition(error.what(), kind);
+}
+
+// Calls the innermost handler where the raise happened; when a guard is closer than any handler,
+// the object is left in the value stack and Raising is returned for the guard to take. A handler
+// returning from a non-continuable raise raises again in its own dynamic environment.
+static std::shared_ptr<Object> RaiseValue(std::shared_ptr<Object> value, bool continuable) {
+    auto& stack = ValueStack::Current();
+    auto& handlers = stack.GetHandlers();
+    if (handlers.empty() || !handlers.back()) {
+        stack.GetRaised() = std::move(value);
+        return Raising::Get();
+    }
+
+    OuterHandlerScope outer;
+    auto result = CallHandler(outer.GetHandler(), std::move(value));
+    if (!continuable && !IsRaising(result)) {
+        return RaiseValue(MakeCondition("handler returned from a non-continuable raise"), false);
+    }
+    return result;
+}
+
+std::shared_ptr<Object> RaiseError(ErrorKind kind, std::string_view message) {
+    return RaiseValue(MakeCondition(message, kind), false);
+}
+
+std::shared_ptr<Object> Guard::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
+    auto cell = As<Cell>(head);
+    if (!Is<LambdaForm>(cell->GetFirst())) {
+        auto form = Cell::Make(std::make_shared<Symbol>("guard"), head);
+        return ClosureConverter(false).Convert(form)->Eval(scope);
+    }
+
+    std::shared_ptr<Object> condition;
+    {
+        auto body = cell->GetFirst()->Eval(scope);
+        HandlerScope guard(nullptr);
+        try {
+            auto result = static_cast<Procedure*>(body.get())->Call({});
+            if (!IsRaising(result)) {
+                return result;
+            }
+            condition = std::move(ValueStack::Current().GetRaised());
+        } catch (RaisedError& error) {
+            condition = std::move(error.value);
+        } catch (const std::runtime_error& error) {
+            condition = MakeCondition(error);
+        }
+    }
+    return CallHandler(As<Cell>(cell->GetSecond())->GetFirst()->Eval(scope), condition);
+}
+
+std::shared_ptr<Object> Define::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
+    auto cell = As<Cell>(head);
+    auto name = As<Symbol>(cell->GetFirst());
+    if (!name) {
+        auto signature = As<Cell>(cell->GetFirst());
+        if (!signature || !Is<Symbol>(signature->GetFirst())) {
+            throw RuntimeError{"Define should define a symbol or lambda"};
+        }
+
+        auto lambda = ClosureConverter(false).ConvertLambda(signature->GetSecond(),
+                                                            cell->GetSecond());
+        scope.Assign(As<Symbol>(signature->GetFirst())->GetName(), lambda->Eval(scope));
+
+        return nullptr;
+    }
+
+    auto value = As<Cell>(cell->GetSecond())->GetFirst()->Eval(scope);
+    if (IsRaising(value)) {
+        return value;
+    }
+
+    scope.Assign(name->GetName(), value);
 
     return nullptr;
 }
@@ -373,128 +1275,919 @@ std::shared_ptr<Object> Set::Apply(const std::shared_ptr<Object>& head, Scope& s
     if (!name) {
         throw RuntimeError{"Set should define a symbol"};
     }
-    Scope* to_assign = scope.CheckToSet(name->GetName());
+    Scope* to_assign = name->GetLookupScope(scope).CheckToSet(name->GetLookupName());
     auto value = As<Cell>(cell->GetSecond())->GetFirst()->Eval(scope);
+    if (IsRaising(value)) {
+        return value;
+    }
 
-    to_assign->Assign(name->GetName(), value);
+    to_assign->Assign(name->GetLookupName(), value);
 
     return nullptr;
 }
 
 template <bool car>
 std::shared_ptr<Object> SetPair<car>::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
+    const char* function = car ? "set-car!" : "set-cdr!";
     auto cell = As<Cell>(head);
+    auto rest = cell ? As<Cell>(cell->GetSecond()) : nullptr;
+    if (!rest || rest->GetSecond() || !cell->GetFirst()) {
+        throw RuntimeError{std::string(function) + ": should have 2 arguments"};
+    }
     auto name = As<Symbol>(cell->GetFirst());
     if (!name) {
-        name = As<Symbol>(cell->GetFirst()->Eval(scope));
+        auto target = cell->GetFirst()->Eval(scope);
+        if (IsRaising(target)) {
+            return target;
+        }
+        name = As<Symbol>(target);
+        if (!name) {
+            ArgumentAs<Cell>(target, function);
+            throw RuntimeError{std::string(function) + ": the pair should be held by a variable"};
+        }
     }
-    scope.CheckToSet(name->GetName());
+    const auto& var = name->GetLookupName();
+    Scope& from = name->GetLookupScope(scope);
+    Scope* to_assign = from.CheckToSet(var);
+    ArgumentAs<Cell>(from.At(var), function);
 
     auto new_value = As<Cell>(cell->GetSecond())->GetFirst();
     if (Is<Cell>(new_value)) {
         new_value = new_value->Eval(scope);
+        if (IsRaising(new_value)) {
+            return new_value;
+        }
     }
 
     if constexpr (car) {
-        auto old_second = As<Cell>(scope.At(name->GetName()))->GetSecond();
+        auto old_second = As<Cell>(from.At(var))->GetSecond();
 
-        scope.Assign(name->GetName(), std::make_shared<Cell>(new_value, old_second));
+        to_assign->Assign(var, Cell::Make(new_value, old_second));
     } else {
-        auto old_first = As<Cell>(scope.At(name->GetName()))->GetFirst();
+        auto old_first = As<Cell>(from.At(var))->GetFirst();
 
-        scope.Assign(name->GetName(), std::make_shared<Cell>(old_first, new_value));
+        to_assign->Assign(var, Cell::Make(old_first, new_value));
     }
 
     return nullptr;
 }
 
 std::shared_ptr<Object> CreateLambda::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
-    static auto gen_lambda_name = []() -> std::string {
-        static std::mt19937 rnd(time(0));
-        static std::uniform_int_distribution<int> dist(0, 25);
-        size_t len = 10;
-        std::string name;
-        for (size_t i = 0; i < len; ++i) {
-            name.push_back(static_cast<char>('a' + dist(rnd)));
+    auto cell = As<Cell>(head);
+
+    return ClosureConverter(false).ConvertLambda(cell->GetFirst(), cell->GetSecond())->Eval(scope);
+}
+
+std::shared_ptr<Object> LambdaForm::Eval(Scope& scope) {
+    auto root = scope.GetRoot();
+    std::shared_ptr<Scope> env;
+    for (const auto& name : info_->free) {
+        auto [binding, owner] = scope.Find(name);
+        if (!binding || owner->IsRoot()) {
+            continue;
+        }
+        if (!env) {
+            env = std::make_shared<Scope>(root);
         }
+        env->Bind(name, binding->value, binding->box);
+    }
 
-        return name;
-    };
+    return std::make_shared<LambdaFunction>(info_, std::move(env), root);
+}
 
-    auto curr_name = gen_lambda_name();
-    auto cell = As<Cell>(head);
-    std::vector<std::string> args;
-    auto curr_args = cell->GetFirst();
-    while (curr_args) {
-        args.emplace_back(As<Symbol>(As<Cell>(curr_args)->GetFirst())->GetName());
-        curr_args = As<Cell>(curr_args)->GetSecond();
+LambdaFunction::LambdaFunction(std::shared_ptr<LambdaInfo> info, std::shared_ptr<Scope> env,
+                               Scope* root)
+    : info_(std::move(info)), env_(std::move(env)), root_(root) {
+}
+
+LambdaFunction::~LambdaFunction() = default;
+
+std::shared_ptr<Object> LambdaFunction::Call(Arguments args) {
+    if (!jit_failed_ && JitCode::IsEnabled()) {
+        if (auto res = CallJit(args)) {
+            return res;
+        }
     }
+    return CallInterpreted(args);
+}
 
-    auto body = As<Cell>(cell->GetSecond());
-    auto lambda = std::make_shared<LambdaFunction>(&scope, body, args);
-    scope.Assign(curr_name, lambda);
+std::shared_ptr<Object> LambdaFunction::CallInterpreted(Arguments args) {
+    Task::CheckStack();
+    const auto& info = *info_;
+    Scope frame(env_ ? env_.get() : root_);
+    frame.Reserve(info.params.size() + info.locals.size() + 1);
+    BindFrame(frame, args);
+    if (!info.body) {
+        return nullptr;
+    }
 
-    return lambda;
+    auto last = info.body.get();
+    while (static_cast<Cell*>(last)->GetSecond()) {
+        last = static_cast<Cell*>(last)->GetSecond().get();
+    }
+    while (true) {
+        for (auto body = info.body.get(); body != last;) {
+            auto cell = static_cast<Cell*>(body);
+            auto value = cell->GetFirst()->Eval(frame);
+            if (IsRaising(value)) {
+                return value;
+            }
+            body = cell->GetSecond().get();
+        }
+        std::shared_ptr<Object> res;
+        if (!EvalTail(static_cast<Cell*>(last)->GetFirst().get(), frame, &res)) {
+            return res;
+        }
+    }
 }
 
-std::shared_ptr<Object> LambdaFunction::Apply(const std::shared_ptr<Object>& head, Scope&) {
-    auto& scope = GetScope();
-    auto args = GetArgs();
-    auto body = As<Cell>(GetBody());
+std::shared_ptr<Object> LambdaFunction::CallJit(Arguments args) {
+    if (!jit_) {
+        if (++calls_ < JitCode::kThreshold) {
+            return nullptr;
+        }
+        if (!env_) {
+            jit_ = JitCode::Compile(*info_, this, *root_);
+        }
+        if (!jit_) {
+            jit_failed_ = true;
+            return nullptr;
+        }
+    }
+    if (!jit_->CheckGuards(*root_, this)) {
+        jit_.reset();
+        jit_failed_ = true;
+        return nullptr;
+    }
 
+    // Code that is called with anything but fixnums or recurses too deep for the compiled code
+    // is interpreted from then on, nested calls included.
+    int64_t values[JitCode::kMaxParams];
+    if (args.size() != info_->params.size()) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < args.size(); ++i) {
+        auto number = dynamic_cast<Number*>(args[i].get());
+        if (!number) {
+            jit_.reset();
+            jit_failed_ = true;
+            return nullptr;
+        }
+        values[i] = number->GetValue();
+    }
+    if (auto result = jit_->Run(values)) {
+        return std::make_shared<Number>(*result);
+    }
+
+    jit_.reset();
+    jit_failed_ = true;
+    return CallInterpreted(args);
+}
+
+void LambdaFunction::BindFrame(Scope& frame, Arguments args) {
+    const auto& info = *info_;
+    if (args.size() != info.params.size()) {
+        throw RuntimeError{"lambda: wrong number of arguments"};
+    }
+
+    // Argument slots belong to the caller's value-stack frame and are dead once bound. Clearing
+    // them keeps a long tail loop from pinning its first arguments, e.g. the head of a stream.
+    bool fresh = frame.Size() == 0;
+    for (size_t i = 0; i < args.size(); ++i) {
+        auto& arg = const_cast<std::shared_ptr<Object>&>(args[i]);
+        if (fresh) {
+            BindSlot(frame, info.params[i], arg, info.boxed[i]);
+        } else {
+            RebindSlot(frame, i, arg, info.boxed[i]);
+        }
+        arg.reset();
+    }
+    for (size_t i = 0; i < info.locals.size(); ++i) {
+        if (fresh) {
+            frame.Bind(info.locals[i], nullptr, std::make_shared<Box>());
+        } else {
+            frame.GetSlot(args.size() + i).box = std::make_shared<Box>();
+        }
+    }
+    if (fresh && !info.self.empty()) {
+        frame.Bind(info.self, shared_from_this(), nullptr);
+    }
+}
+
+// Self calls in tail position rebind the current frame instead of growing the C++ stack, so
+// loops written as named let or tail recursion run in constant space.
+bool LambdaFunction::EvalTail(Object* expr, Scope& frame, std::shared_ptr<Object>* result) {
+    while (true) {
+        Task::Tick();
+        auto cell = dynamic_cast<Cell*>(expr);
+        if (!cell || !cell->GetFirst()) {
+            *result = expr ? expr->Eval(frame) : nullptr;
+            return false;
+        }
+
+        if (cell->IsFixnumCall(frame)) {
+            *result = cell->EvalFixnums(frame);
+            return false;
+        }
+        auto callee = cell->ResolveCallee(frame);
+        if (!callee) {
+            throw RuntimeError{"apply on empty object in cell"};
+        }
+        if (IsRaising(callee)) {
+            *result = callee;
+            return false;
+        }
+        if (callee.get() == this) {
+            ValueStack::Frame args(ValueStack::Current());
+            if (!EvalArguments(cell->GetSecond().get(), frame, &args)) {
+                *result = Raising::Get();
+                return false;
+            }
+            BindFrame(frame, args.Args());
+            return true;
+        }
+        if (dynamic_cast<Cond*>(callee.get())) {
+            expr = Cond::SelectTail(cell->GetSecond().get(), frame, result);
+            if (!expr) {
+                return false;
+            }
+            continue;
+        }
+        if (!dynamic_cast<If*>(callee.get())) {
+            *result = callee->Apply(cell->GetSecond(), frame);
+            return false;
+        }
+
+        auto [test, then, otherwise] = SplitIf(cell->GetSecond().get());
+        auto value = test->Eval(frame);
+        if (IsRaising(value)) {
+            *result = std::move(value);
+            return false;
+        }
+        auto cond = dynamic_cast<Boolean*>(value.get());
+        if (!cond) {
+            throw RuntimeError{"If condition must can be evaluated into Boolean"};
+        }
+        expr = cond->GetValue() ? then : otherwise;
+        if (!expr) {
+            *result = nullptr;
+            return false;
+        }
+    }
+}
+
+std::shared_ptr<Object> FoldedCall::Eval(Scope& scope) {
+    if (version_ != scope.GetBuiltinVersion()) {
+        auto& root = *scope.GetRoot();
+        shadowed_ = false;
+        for (const auto& name : names_) {
+            Scope::RecordRead(name);
+            shadowed_ = shadowed_ || root.Contains(name);
+        }
+        version_ = scope.GetBuiltinVersion();
+    }
+    return shadowed_ ? call_->Eval(scope) : value_;
+}
+
+std::shared_ptr<Object> LetForm::Eval(Scope& scope) {
+    Task::CheckStack();
+    const auto& info = *info_;
+    Scope frame(&scope);
+    frame.Reserve(info.names.size() + info.locals.size() + 1);
+
+    if (info.loop) {
+        // A loop that binds its own name needs no frame; otherwise it captures the box of the
+        // name, and the two keep each other alive.
+        std::shared_ptr<Object> loop;
+        if (!info.loop->GetInfo()->self.empty()) {
+            loop = info.loop->Eval(scope);
+        } else {
+            frame.Bind(info.loop_name, nullptr, std::make_shared<Box>());
+            loop = info.loop->Eval(frame);
+            frame.GetSlot(0).Set(loop);
+        }
+
+        ValueStack::Frame args(ValueStack::Current());
+        for (const auto& init : info.inits) {
+            auto value = init->Eval(scope);
+            if (IsRaising(value)) {
+                return value;
+            }
+            args.Push(std::move(value));
+        }
+        return static_cast<Procedure*>(loop.get())->Call(args.Args());
+    }
+
+    switch (info.kind) {
+        case LetKind::kLet:
+        case LetKind::kDo:
+            for (size_t i = 0; i < info.names.size(); ++i) {
+                auto value = info.inits[i]->Eval(scope);
+                if (IsRaising(value)) {
+                    return value;
+                }
+                BindSlot(frame, info.names[i], value, info.boxed[i]);
+            }
+            break;
+        case LetKind::kLetStar:
+            for (size_t i = 0; i < info.names.size(); ++i) {
+                auto value = info.inits[i]->Eval(frame);
+                if (IsRaising(value)) {
+                    return value;
+                }
+                if (frame.Find(info.names[i]).second == &frame) {
+                    frame.Assign(info.names[i], value);
+                } else {
+                    BindSlot(frame, info.names[i], value, info.boxed[i]);
+                }
+            }
+            break;
+        case LetKind::kLetRec:
+            for (const auto& name : info.names) {
+                frame.Bind(name, nullptr, std::make_shared<Box>());
+            }
+            for (size_t i = 0; i < info.names.size(); ++i) {
+                auto value = info.inits[i]->Eval(frame);
+                if (IsRaising(value)) {
+                    return value;
+                }
+                frame.GetSlot(i).Set(std::move(value));
+            }
+            break;
+    }
+    for (const auto& name : info.locals) {
+        frame.Bind(name, nullptr, std::make_shared<Box>());
+    }
+
+    if (info.kind == LetKind::kDo) {
+        return EvalDo(frame);
+    }
+    return EvalBody(info.body.get(), frame);
+}
+
+std::shared_ptr<Object> LetForm::EvalDo(Scope& frame) {
+    const auto& info = *info_;
+    while (true) {
+        auto test = info.test->Eval(frame);
+        if (IsRaising(test)) {
+            return test;
+        }
+        auto cond = As<Boolean>(test);
+        if (!cond) {
+            throw RuntimeError{"do test must be evaluated into Boolean"};
+        }
+        if (cond->GetValue()) {
+            return EvalBody(info.result.get(), frame);
+        }
+        auto body = EvalBody(info.body.get(), frame);
+        if (IsRaising(body)) {
+            return body;
+        }
+
+        ValueStack::Frame values(ValueStack::Current());
+        for (const auto& step : info.steps) {
+            if (step) {
+                auto value = step->Eval(frame);
+                if (IsRaising(value)) {
+                    return value;
+                }
+                values.Push(std::move(value));
+            }
+        }
+        auto args = values.Args();
+        for (size_t i = 0, next = 0; i < info.steps.size(); ++i) {
+            if (info.steps[i]) {
+                RebindSlot(frame, i, args[next++], info.boxed[i]);
+            }
+        }
+    }
+}
+
+static std::shared_ptr<Object> MakeThunk(const std::shared_ptr<Object>& body, Scope& scope) {
+    auto expr = As<Cell>(body)->GetFirst();
+    if (Is<LambdaForm>(expr)) {
+        return expr->Eval(scope);
+    }
+    return ClosureConverter(false).ConvertLambda(nullptr, body)->Eval(scope);
+}
+
+template <bool chained>
+std::shared_ptr<Object> DelayForm<chained>::Apply(const std::shared_ptr<Object>& head,
+                                                  Scope& scope) {
+    return std::make_shared<Promise>(MakeThunk(head, scope), false, chained);
+}
+
+std::shared_ptr<Object> ConsStream::Apply(const std::shared_ptr<Object>& head, Scope& scope) {
     auto cell = As<Cell>(head);
+    auto first = cell->GetFirst()->Eval(scope);
+    if (IsRaising(first)) {
+        return first;
+    }
+
+    return Cell::Make(
+        first, std::make_shared<Promise>(MakeThunk(cell->GetSecond(), scope), false, false));
+}
+
+template <LetKind kind>
+std::shared_ptr<Object> BindingForm<kind>::Apply(const std::shared_ptr<Object>& head,
+                                                 Scope& scope) {
+    return ClosureConverter(false).ConvertLet(kind, head)->Eval(scope);
+}
+
+std::shared_ptr<Object> StringLength::Call(Arguments args) {
+    CheckArity(args, 1, 1, "string-length");
+
+    return std::make_shared<Number>(ArgumentAs<String>(args[0], "string-length")->Size());
+}
+
+std::shared_ptr<Object> StringRef::Call(Arguments args) {
+    CheckArity(args, 2, 2, "string-ref");
+    auto str = ArgumentAs<String>(args[0], "string-ref");
+    auto idx = ArgumentAs<Number>(args[1], "string-ref")->GetValue();
+    if (idx < 0 || static_cast<size_t>(idx) >= str->Size()) {
+        throw RuntimeError{"string-ref: index out of range"};
+    }
+
+    return str->Substring(idx, idx + 1);
+}
+
+std::shared_ptr<Object> Substring::Call(Arguments args) {
+    CheckArity(args, 2, 3, "substring");
+    auto str = ArgumentAs<String>(args[0], "substring");
+    auto begin = ArgumentAs<Number>(args[1], "substring")->GetValue();
+    int64_t end = str->Size();
+    if (args.size() == 3) {
+        end = ArgumentAs<Number>(args[2], "substring")->GetValue();
+    }
+    if (begin < 0 || begin > end || static_cast<size_t>(end) > str->Size()) {
+        throw RuntimeError{"substring: index out of range"};
+    }
+
+    return str->Substring(begin, end);
+}
+
+std::shared_ptr<Object> StringAppend::Call(Arguments args) {
+    if (args.empty()) {
+        return std::make_shared<String>("");
+    }
+
+    std::vector<std::shared_ptr<String>> parts;
+    parts.reserve(args.size());
+    for (const auto& arg : args) {
+        ArgumentAs<String>(arg, "string-append");
+        parts.emplace_back(As<String>(arg));
+    }
+
+    return String::Append(parts);
+}
+
+template <typename F>
+std::shared_ptr<Object> CompareStrings<F>::Call(Arguments args) {
+    F cmp{};
+    bool result = true;
     for (size_t i = 0; i < args.size(); ++i) {
-        auto arg = cell->GetFirst()->Eval(scope);
-        scope.Assign(args[i], arg);
-        cell = As<Cell>(cell->GetSecond());
+        auto curr = ArgumentAs<String>(args[i], "CompareStrings");
+        if (i > 0 && !cmp(ArgumentAs<String>(args[i - 1], "CompareStrings")->GetView(),
+                          curr->GetView())) {
+            result = false;
+        }
     }
 
-    std::shared_ptr<Object> res;
-    LambdaFunction::k_scopes.emplace_back(std::make_shared<Scope>(&scope));
-    auto& new_scope = LambdaFunction::k_scopes.back();
-    new_scope->GetVars() = scope.GetVars();
-    while (body) {
-        res = body->GetFirst()->Eval(*new_scope);
-        body = As<Cell>(body->GetSecond());
+    return std::make_shared<Boolean>(result);
+}
+
+std::shared_ptr<Object> StringToSymbol::Call(Arguments args) {
+    CheckArity(args, 1, 1, "string->symbol");
+
+    return std::make_shared<Symbol>(
+        std::string(ArgumentAs<String>(args[0], "string->symbol")->GetView()));
+}
+
+std::shared_ptr<Object> SymbolToString::Call(Arguments args) {
+    CheckArity(args, 1, 1, "symbol->string");
+
+    return std::make_shared<String>(ArgumentAs<Symbol>(args[0], "symbol->string")->GetName());
+}
+
+std::shared_ptr<Object> NumberToString::Call(Arguments args) {
+    CheckArity(args, 1, 1, "number->string");
+
+    return std::make_shared<String>(
+        std::to_string(ArgumentAs<Number>(args[0], "number->string")->GetValue()));
+}
+
+std::shared_ptr<Object> OpenInputFile::Call(Arguments args) {
+    CheckArity(args, 1, 1, "open-input-file");
+
+    auto path = ArgumentAs<String>(args[0], "open-input-file")->GetView();
+    return std::make_shared<InputPort>(std::string(path));
+}
+
+std::shared_ptr<Object> OpenOutputFile::Call(Arguments args) {
+    CheckArity(args, 1, 1, "open-output-file");
+
+    auto path = ArgumentAs<String>(args[0], "open-output-file")->GetView();
+    return std::make_shared<OutputPort>(std::string(path));
+}
+
+std::shared_ptr<Object> ClosePort::Call(Arguments args) {
+    CheckArity(args, 1, 1, "close-port");
+
+    if (auto port = As<InputPort>(args[0])) {
+        port->Close();
+    } else {
+        ArgumentAs<OutputPort>(args[0], "close-port")->Close();
     }
+    return nullptr;
+}
 
-    return res;
+std::shared_ptr<Object> ReadLine::Call(Arguments args) {
+    CheckArity(args, 1, 1, "read-line");
+
+    return ArgumentAs<InputPort>(args[0], "read-line")->ReadLine();
+}
+
+std::shared_ptr<Object> ReadDatum::Call(Arguments args) {
+    CheckArity(args, 1, 1, "read");
+
+    return ArgumentAs<InputPort>(args[0], "read")->ReadDatum();
+}
+
+template <bool advance>
+std::shared_ptr<Object> ReadCharacter<advance>::Call(Arguments args) {
+    const char* name = advance ? "read-char" : "peek-char";
+    CheckArity(args, 1, 1, name);
+
+    return ArgumentAs<InputPort>(args[0], name)->ReadChar(advance);
+}
+
+template <bool raw>
+std::shared_ptr<Object> WriteValue<raw>::Call(Arguments args) {
+    const char* name = raw ? "display" : "write";
+    CheckArity(args, 1, 2, name);
+    auto& out = args.size() == 2 ? ArgumentAs<OutputPort>(args[1], name)->GetStream()
+                                 : OutputPort::Current();
+
+    auto str = As<String>(args[0]);
+    if (raw && str) {
+        out << str->GetView();
+    } else {
+        Print(args[0], out);
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Object> Newline::Call(Arguments args) {
+    CheckArity(args, 0, 1, "newline");
+
+    auto& out = args.empty() ? OutputPort::Current()
+                             : ArgumentAs<OutputPort>(args[0], "newline")->GetStream();
+    out << '\n';
+    return nullptr;
+}
+
+std::shared_ptr<Object> IsEofObject::Call(Arguments args) {
+    CheckArity(args, 1, 1, "eof-object?");
+
+    return std::make_shared<Boolean>(Is<EofObject>(args[0]));
+}
+
+template <bool continuable>
+std::shared_ptr<Object> RaiseObject<continuable>::Call(Arguments args) {
+    CheckArity(args, 1, 1, continuable ? "raise-continuable" : "raise");
+
+    return RaiseValue(args[0], continuable);
+}
+
+std::shared_ptr<Object> Error::Call(Arguments args) {
+    CheckArity(args, 1, SIZE_MAX, "error");
+    ArgumentAs<String>(args[0], "error");
+
+    std::shared_ptr<Object> irritants;
+    for (size_t i = args.size(); i > 1; --i) {
+        irritants = Cell::Make(args[i - 1], irritants);
+    }
+    return RaiseValue(std::make_shared<ErrorObject>(As<String>(args[0]), irritants), false);
+}
+
+std::shared_ptr<Object> WithExceptionHandler::Call(Arguments args) {
+    CheckArity(args, 2, 2, "with-exception-handler");
+    ArgumentAs<Procedure>(args[0], "with-exception-handler");
+    auto thunk = ArgumentAs<Procedure>(args[1], "with-exception-handler");
+    auto handler = args[0];
+
+    std::shared_ptr<Object> condition;
+    {
+        HandlerScope scope(handler);
+        try {
+            return thunk->Call({});
+        } catch (const std::runtime_error& error) {
+            condition = MakeCondition(error);
+        }
+    }
+    auto result = CallHandler(handler, condition);
+    if (IsRaising(result)) {
+        return result;
+    }
+    return RaiseValue(MakeCondition("handler returned from a non-continuable error"), false);
+}
+
+std::shared_ptr<Object> IsErrorObject::Call(Arguments args) {
+    CheckArity(args, 1, 1, "error-object?");
+
+    return std::make_shared<Boolean>(Is<ErrorObject>(args[0]));
+}
+
+std::shared_ptr<Object> ErrorObjectMessage::Call(Arguments args) {
+    CheckArity(args, 1, 1, "error-object-message");
+
+    return ArgumentAs<ErrorObject>(args[0], "error-object-message")->GetMessage();
+}
+
+std::shared_ptr<Object> ErrorObjectIrritants::Call(Arguments args) {
+    CheckArity(args, 1, 1, "error-object-irritants");
+
+    return ArgumentAs<ErrorObject>(args[0], "error-object-irritants")->GetIrritants();
+}
+
+static size_t HashValue(Object* value) {
+    Task::CheckStack();
+    size_t hash = 0x9e3779b97f4a7c15ull;
+    auto mix = [&hash](size_t part) { hash = (hash ^ part) * 0x100000001b3ull; };
+    for (; auto cell = dynamic_cast<Cell*>(value); value = cell->GetSecond().get()) {
+        mix(HashValue(cell->GetFirst().get()));
+    }
+    if (!value) {
+        mix(0);
+    } else if (auto number = dynamic_cast<Number*>(value)) {
+        mix(std::hash<int64_t>{}(number->GetValue()));
+    } else if (auto boolean = dynamic_cast<Boolean*>(value)) {
+        mix(boolean->GetValue() ? 3 : 2);
+    } else if (auto symb = dynamic_cast<Symbol*>(value)) {
+        mix(std::hash<std::string_view>{}(symb->GetName()) + 1);
+    } else if (auto str = dynamic_cast<String*>(value)) {
+        mix(std::hash<std::string_view>{}(str->GetView()) + 2);
+    } else {
+        mix(std::hash<Object*>{}(value));
+    }
+    return hash;
+}
+
+std::shared_ptr<Object> MemoizedProcedure::Call(Arguments args) {
+    size_t hash = args.size();
+    for (const auto& arg : args) {
+        hash = hash * 31 + HashValue(arg.get());
+    }
+
+    auto [begin, end] = index_.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        auto entry = it->second;
+        if (std::equal(args.begin(), args.end(), entry->args.begin(), entry->args.end(),
+                       [](const auto& lhs, const auto& rhs) {
+                           return AreEqual(lhs.get(), rhs.get());
+                       })) {
+            hits_ += 1;
+            entries_.splice(entries_.begin(), entries_, entry);
+            return entry->result;
+        }
+    }
+
+    misses_ += 1;
+    std::vector<std::shared_ptr<Object>> key(args.begin(), args.end());
+    auto result = proc_->Call(args);
+    if (IsRaising(result)) {
+        return result;
+    }
+    entries_.push_front({hash, std::move(key), result});
+    index_.emplace(hash, entries_.begin());
+
+    if (max_size_ && entries_.size() > max_size_) {
+        auto last = std::prev(entries_.end());
+        auto [first, stop] = index_.equal_range(last->hash);
+        index_.erase(std::find_if(first, stop, [&last](const auto& item) {
+            return item.second == last;
+        }));
+        entries_.pop_back();
+        evictions_ += 1;
+    }
+    return result;
+}
+
+std::shared_ptr<Object> Memoize::Call(Arguments args) {
+    CheckArity(args, 1, 2, "memoize");
+
+    ArgumentAs<Procedure>(args[0], "memoize");
+    int64_t max_size = args.size() == 2 ? ArgumentAs<Number>(args[1], "memoize")->GetValue() : 0;
+    if (max_size < 0) {
+        throw RuntimeError{"memoize: size bound should not be negative"};
+    }
+    return std::make_shared<MemoizedProcedure>(std::static_pointer_cast<Procedure>(args[0]),
+                                               max_size);
+}
+
+std::shared_ptr<Object> MemoizeStats::Call(Arguments args) {
+    CheckArity(args, 1, 1, "memoize-stats");
+
+    auto memoized = ArgumentAs<MemoizedProcedure>(args[0], "memoize-stats");
+    ListBuilder stats;
+    for (size_t value : {memoized->GetHits(), memoized->GetMisses(), memoized->GetEvictions(),
+                         memoized->GetSize()}) {
+        stats.Push(std::make_shared<Number>(value));
+    }
+    return stats.Finish();
 }
 
-std::map<std::string, std::shared_ptr<Function>> Symbol::k_functions =
-    std::map<std::string, std::shared_ptr<Function>>{
-        {"quote", std::make_shared<ReturnItself>()},
-        {"boolean?", std::make_shared<IsBoolean>()},
-        {"number?", std::make_shared<IsNumber>()},
-        {"symbol?", std::make_shared<IsSymbol>()},
-        {"not", std::make_shared<Not>()},
-        {"abs", std::make_shared<Abs>()},
-        {"=", std::make_shared<Equal>()},
-        {"<", std::make_shared<Less>()},
-        {">", std::make_shared<Greater>()},
-        {"<=", std::make_shared<LessEqual>()},
-        {">=", std::make_shared<GreaterEqual>()},
-        {"+", std::make_shared<Plus>()},
-        {"*", std::make_shared<Prod>()},
-        {"-", std::make_shared<Minus>()},
-        {"/", std::make_shared<Divide>()},
-        {"max", std::make_shared<Max>()},
-        {"min", std::make_shared<Min>()},
-        {"pair?", std::make_shared<IsPair>()},
-        {"null?", std::make_shared<IsNull>()},
-        {"list?", std::make_shared<IsList>()},
-        {"cons", std::make_shared<Cons>()},
-        {"car", std::make_shared<Car>()},
-        {"cdr", std::make_shared<Cdr>()},
-        {"list", std::make_shared<List>()},
-        {"list-ref", std::make_shared<ListRef>()},
-        {"list-tail", std::make_shared<ListTail>()},
-        {"and", std::make_shared<And>()},
-        {"or", std::make_shared<Or>()},
-        {"if", std::make_shared<If>()},
-        {"define", std::make_shared<Define>()},
-        {"set!", std::make_shared<Set>()},
-        {"set-car!", std::make_shared<SetCar>()},
-        {"set-cdr!", std::make_shared<SetCdr>()},
-        {"lambda", std::make_shared<CreateLambda>()},
-    };
\ No newline at end of file
+template <class T>
+static Function* BuiltinInstance() {
+    static T instance;
+    return &instance;
+}
+
+struct BuiltinEntry {
+    std::string_view name;
+    Function* (*get)();
+    std::optional<BuiltinSignature> signature{};
+};
+
+static constexpr auto kAny = StaticType::kUnknown;
+static constexpr auto kNumber = StaticType::kNumber;
+static constexpr auto kBoolean = StaticType::kBoolean;
+static constexpr auto kString = StaticType::kString;
+static constexpr size_t kMany = SIZE_MAX;
+
+static constexpr BuiltinSignature Takes(size_t min, size_t max, StaticType args,
+                                        StaticType result) {
+    return {min, max, args, result, false};
+}
+
+static constexpr BuiltinSignature Pure(size_t min, size_t max, StaticType args,
+                                       StaticType result) {
+    return {min, max, args, result, true};
+}
+
+static constexpr BuiltinEntry kBuiltins[] = {
+    {"quote", &BuiltinInstance<ReturnItself>},
+    {"boolean?", &BuiltinInstance<IsBoolean>, Pure(1, 1, kAny, kBoolean)},
+    {"number?", &BuiltinInstance<IsNumber>, Pure(1, 1, kAny, kBoolean)},
+    {"symbol?", &BuiltinInstance<IsSymbol>, Pure(1, 1, kAny, kBoolean)},
+    {"not", &BuiltinInstance<Not>, Pure(1, 1, kAny, kBoolean)},
+    {"abs", &BuiltinInstance<Abs>, Pure(1, 1, kNumber, kNumber)},
+    {"=", &BuiltinInstance<Equal>, Pure(0, kMany, kNumber, kBoolean)},
+    {"<", &BuiltinInstance<Less>, Pure(0, kMany, kNumber, kBoolean)},
+    {">", &BuiltinInstance<Greater>, Pure(0, kMany, kNumber, kBoolean)},
+    {"<=", &BuiltinInstance<LessEqual>, Pure(0, kMany, kNumber, kBoolean)},
+    {">=", &BuiltinInstance<GreaterEqual>, Pure(0, kMany, kNumber, kBoolean)},
+    {"+", &BuiltinInstance<Plus>, Pure(0, kMany, kNumber, kNumber)},
+    {"*", &BuiltinInstance<Prod>, Pure(0, kMany, kNumber, kNumber)},
+    {"-", &BuiltinInstance<Minus>, Pure(1, kMany, kNumber, kNumber)},
+    {"/", &BuiltinInstance<Divide>, Pure(1, kMany, kNumber, kNumber)},
+    {"max", &BuiltinInstance<Max>, Pure(1, kMany, kNumber, kNumber)},
+    {"min", &BuiltinInstance<Min>, Pure(1, kMany, kNumber, kNumber)},
+    {"pair?", &BuiltinInstance<IsPair>, Takes(1, 1, kAny, kBoolean)},
+    {"null?", &BuiltinInstance<IsNull>, Takes(1, 1, kAny, kBoolean)},
+    {"equal?", &BuiltinInstance<IsEqual>, Pure(2, 2, kAny, kBoolean)},
+    {"delay", &BuiltinInstance<Delay>},
+    {"delay-force", &BuiltinInstance<DelayForce>},
+    {"make-promise", &BuiltinInstance<MakePromise>, Takes(1, 1, kAny, kAny)},
+    {"force", &BuiltinInstance<Force>, Takes(1, 1, kAny, kAny)},
+    {"promise?", &BuiltinInstance<IsPromise>, Takes(1, 1, kAny, kBoolean)},
+    {"cons-stream", &BuiltinInstance<ConsStream>},
+    {"stream-car", &BuiltinInstance<StreamCar>, Takes(1, 1, kAny, kAny)},
+    {"stream-cdr", &BuiltinInstance<StreamCdr>, Takes(1, 1, kAny, kAny)},
+    {"stream-pair?", &BuiltinInstance<IsStreamPair>, Takes(1, 1, kAny, kBoolean)},
+    {"stream-null?", &BuiltinInstance<IsNull>, Takes(1, 1, kAny, kBoolean)},
+    {"stream-ref", &BuiltinInstance<StreamRef>, Takes(2, 2, kAny, kAny)},
+    {"stream-tail", &BuiltinInstance<StreamTail>, Takes(2, 2, kAny, kAny)},
+    {"stream-take", &BuiltinInstance<StreamTake>, Takes(2, 2, kAny, kAny)},
+    {"list?", &BuiltinInstance<IsList>, Takes(1, 1, kAny, kBoolean)},
+    {"cons", &BuiltinInstance<Cons>, Takes(2, 2, kAny, kAny)},
+    {"car", &BuiltinInstance<Car>, Takes(1, 1, kAny, kAny)},
+    {"cdr", &BuiltinInstance<Cdr>, Takes(1, 1, kAny, kAny)},
+    {"list", &BuiltinInstance<List>, Takes(0, kMany, kAny, kAny)},
+    {"list-ref", &BuiltinInstance<ListRef>, Takes(2, 2, kAny, kAny)},
+    {"list-tail", &BuiltinInstance<ListTail>, Takes(2, 2, kAny, kAny)},
+    {"length", &BuiltinInstance<Length>, Takes(1, 1, kAny, kNumber)},
+    {"append", &BuiltinInstance<Append>, Takes(0, kMany, kAny, kAny)},
+    {"reverse", &BuiltinInstance<Reverse>, Takes(1, 1, kAny, kAny)},
+    {"list-copy", &BuiltinInstance<ListCopy>, Takes(1, 1, kAny, kAny)},
+    {"map", &BuiltinInstance<Map>, Takes(2, kMany, kAny, kAny)},
+    {"for-each", &BuiltinInstance<ForEach>, Takes(2, kMany, kAny, kAny)},
+    {"filter", &BuiltinInstance<Filter>, Takes(2, 2, kAny, kAny)},
+    {"fold-left", &BuiltinInstance<FoldLeft>, Takes(3, kMany, kAny, kAny)},
+    {"fold-right", &BuiltinInstance<FoldRight>, Takes(3, kMany, kAny, kAny)},
+    {"assoc", &BuiltinInstance<Assoc>, Takes(2, 3, kAny, kAny)},
+    {"assq", &BuiltinInstance<Assq>, Takes(2, 2, kAny, kAny)},
+    {"member", &BuiltinInstance<Member>, Takes(2, 3, kAny, kAny)},
+    {"sort", &BuiltinInstance<Sort>, Takes(2, 2, kAny, kAny)},
+    {"and", &BuiltinInstance<And>},
+    {"or", &BuiltinInstance<Or>},
+    {"if", &BuiltinInstance<If>},
+    {"define", &BuiltinInstance<Define>},
+    {"set!", &BuiltinInstance<Set>},
+    {"set-car!", &BuiltinInstance<SetCar>},
+    {"set-cdr!", &BuiltinInstance<SetCdr>},
+    {"lambda", &BuiltinInstance<CreateLambda>},
+    {"let", &BuiltinInstance<Let>},
+    {"let*", &BuiltinInstance<LetStar>},
+    {"letrec", &BuiltinInstance<LetRec>},
+    {"do", &BuiltinInstance<Do>},
+    {"string?", &BuiltinInstance<IsString>, Pure(1, 1, kAny, kBoolean)},
+    {"string-length", &BuiltinInstance<StringLength>, Pure(1, 1, kString, kNumber)},
+    {"string-ref", &BuiltinInstance<StringRef>, Pure(2, 2, kAny, kString)},
+    {"substring", &BuiltinInstance<Substring>, Pure(2, 3, kAny, kString)},
+    {"string-append", &BuiltinInstance<StringAppend>, Pure(0, kMany, kString, kString)},
+    {"string=?", &BuiltinInstance<StringEqual>, Pure(0, kMany, kString, kBoolean)},
+    {"string<?", &BuiltinInstance<StringLess>, Pure(0, kMany, kString, kBoolean)},
+    {"string->symbol", &BuiltinInstance<StringToSymbol>, Takes(1, 1, kString, kAny)},
+    {"symbol->string", &BuiltinInstance<SymbolToString>, Takes(1, 1, kAny, kString)},
+    {"number->string", &BuiltinInstance<NumberToString>, Pure(1, 1, kNumber, kString)},
+    {"open-input-file", &BuiltinInstance<OpenInputFile>, Takes(1, 1, kString, kAny)},
+    {"open-output-file", &BuiltinInstance<OpenOutputFile>, Takes(1, 1, kString, kAny)},
+    {"close-port", &BuiltinInstance<ClosePort>, Takes(1, 1, kAny, kAny)},
+    {"read-line", &BuiltinInstance<ReadLine>, Takes(1, 1, kAny, kAny)},
+    {"read", &BuiltinInstance<ReadDatum>, Takes(1, 1, kAny, kAny)},
+    {"read-char", &BuiltinInstance<ReadChar>, Takes(1, 1, kAny, kAny)},
+    {"peek-char", &BuiltinInstance<PeekChar>, Takes(1, 1, kAny, kAny)},
+    {"write", &BuiltinInstance<Write>, Takes(1, 2, kAny, kAny)},
+    {"display", &BuiltinInstance<Display>, Takes(1, 2, kAny, kAny)},
+    {"newline", &BuiltinInstance<Newline>, Takes(0, 1, kAny, kAny)},
+    {"eof-object?", &BuiltinInstance<IsEofObject>, Takes(1, 1, kAny, kBoolean)},
+    {"cond", &BuiltinInstance<Cond>},
+    {"guard", &BuiltinInstance<Guard>},
+    {"raise", &BuiltinInstance<Raise>, Takes(1, 1, kAny, kAny)},
+    {"raise-continuable", &BuiltinInstance<RaiseContinuable>, Takes(1, 1, kAny, kAny)},
+    {"error", &BuiltinInstance<Error>, Takes(1, kMany, kAny, kAny)},
+    {"with-exception-handler", &BuiltinInstance<WithExceptionHandler>, Takes(2, 2, kAny, kAny)},
+    {"error-object?", &BuiltinInstance<IsErrorObject>, Takes(1, 1, kAny, kBoolean)},
+    {"error-object-message", &BuiltinInstance<ErrorObjectMessage>, Takes(1, 1, kAny, kAny)},
+    {"error-object-irritants", &BuiltinInstance<ErrorObjectIrritants>, Takes(1, 1, kAny, kAny)},
+    {"memoize", &BuiltinInstance<Memoize>, Takes(1, 2, kAny, kAny)},
+    {"memoize-stats", &BuiltinInstance<MemoizeStats>, Takes(1, 1, kAny, kAny)},
+};
+
+static constexpr size_t kBuiltinCount = std::size(kBuiltins);
+static constexpr size_t kBuiltinSlots = std::bit_ceil(kBuiltinCount * 64);
+static constexpr uint8_t kNoBuiltin = UINT8_MAX;
+static_assert(kBuiltinCount < kNoBuiltin);
+
+static constexpr uint64_t HashName(std::string_view name, uint64_t seed) {
+    uint64_t hash = 14695981039346656037ull ^ seed;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash ^ (hash >> 32);
+}
+
+struct BuiltinTable {
+    uint64_t seed;
+    std::array<uint8_t, kBuiltinSlots> slots;
+};
+
+// Searches for a seed that sends every name to its own slot; a duplicate name never finds one
+// and fails the build.
+static constexpr BuiltinTable MakeBuiltinTable() {
+    for (uint64_t seed = 0; seed < (1 << 16); ++seed) {
+        BuiltinTable table{seed, {}};
+        table.slots.fill(kNoBuiltin);
+        bool perfect = true;
+        for (size_t i = 0; i < kBuiltinCount && perfect; ++i) {
+            auto& slot = table.slots[HashName(kBuiltins[i].name, seed) & (kBuiltinSlots - 1)];
+            perfect = slot == kNoBuiltin;
+            slot = i;
+        }
+        if (perfect) {
+            return table;
+        }
+    }
+    throw "no perfect hash seed for the builtin names";
+}
+
+static constexpr BuiltinTable kBuiltinTable = MakeBuiltinTable();
+
+std::shared_ptr<Function> Symbol::GetBuiltin(std::string_view name) {
+    auto index = kBuiltinTable.slots[HashName(name, kBuiltinTable.seed) & (kBuiltinSlots - 1)];
+    if (index == kNoBuiltin || kBuiltins[index].name != name) {
+        return nullptr;
+    }
+    return std::shared_ptr<Function>(std::shared_ptr<Function>(), kBuiltins[index].get());
+}
+
+std::shared_ptr<Object> Symbol::RaiseUnbound() const {
+    return RaiseError(ErrorKind::kName,
+                      "no variable with name: " + GetLookupName() + " in all parent scopes");
+}
+
+std::shared_ptr<Object> Symbol::ResolveBuiltin(Scope& scope) const {
+    const auto& name = GetLookupName();
+    Scope::RecordRead(name);
+    auto binding = scope.GetRoot()->Find(name).first;
+    return binding ? binding->Get() : builtin_;
+}
+
+const BuiltinSignature* Symbol::GetSignature(std::string_view name) {
+    auto index = kBuiltinTable.slots[HashName(name, kBuiltinTable.seed) & (kBuiltinSlots - 1)];
+    if (index == kNoBuiltin || kBuiltins[index].name != name || !kBuiltins[index].signature) {
+        return nullptr;
+    }
+    return &*kBuiltins[index].signature;
+}
\ No newline at end of file
@@ -5,7 +5,17 @@
 #include <map>
 #include <memory>
 #include "error.h"
+#include "pair_heap.h"
+#include "task.h"
+#include "value_stack.h"
 #include <functional>
+#include <limits>
+#include <list>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 class Scope;
@@ -40,79 +50,250 @@ inline bool Is(const std::shared_ptr<Object>& obj) {
     return dynamic_cast<T*>(obj.get()) != nullptr;
 }
 
+struct Box {
+    std::shared_ptr<Object> value;
+};
+
+struct Binding {
+    std::string name;
+    std::shared_ptr<Object> value;
+    std::shared_ptr<Box> box;
+
+    inline const std::shared_ptr<Object>& Get() const {
+        return box ? box->value : value;
+    }
+
+    inline void Set(const std::shared_ptr<Object>& new_value) {
+        if (box) {
+            box->value = new_value;
+        } else {
+            value = new_value;
+        }
+    }
+};
+
 class Scope {
+    static constexpr size_t kIndexThreshold = 8;
+
 public:
+    // Global names a top-level form read and wrote, and whether it did any I/O.
+    struct Access {
+        std::unordered_set<std::string> reads{};
+        std::unordered_set<std::string> writes{};
+        bool effects = false;
+    };
+
+    // Records global accesses on this thread while alive. Cached callees of the root are dropped
+    // on entry, so every global or builtin the form calls is looked up (and recorded) at least
+    // once.
+    class Tracking {
+    public:
+        Tracking(Access* access, Scope& root) : saved_(k_access) {
+            k_access = access;
+            root.version_ += 1;
+            root.builtin_version_ += 1;
+        }
+        Tracking(const Tracking&) = delete;
+        Tracking& operator=(const Tracking&) = delete;
+
+        ~Tracking() {
+            k_access = saved_;
+        }
+
+    private:
+        Access* saved_;
+    };
+
+    static void RecordEffect() {
+        if (k_access) {
+            k_access->effects = true;
+        }
+    }
+
+    // For lookups of globals that do not go through At, e.g. of a builtin no global shadows.
+    static void RecordRead(const std::string& name) {
+        if (k_access) {
+            k_access->reads.insert(name);
+        }
+    }
+
+    static bool IsTracking() {
+        return k_access;
+    }
+
     Scope() = default;
-    Scope(Scope* anc_scope) : anc_scope_(anc_scope) {
+    Scope(Scope* anc_scope)
+        : anc_scope_(anc_scope), root_(anc_scope ? anc_scope->GetRoot() : nullptr) {
     }
-    Scope(const Scope& other) : anc_scope_(other.anc_scope_), vars_(other.vars_) {
+
+    bool Contains(const std::string& name) const {
+        return Find(name).first != nullptr;
     }
-    Scope& operator=(Scope& other) {
-        anc_scope_ = other.anc_scope_;
-        vars_ = other.vars_;
 
-        return *this;
+    std::pair<const Binding*, const Scope*> Find(const std::string& name) const {
+        for (const Scope* curr = this; curr; curr = curr->anc_scope_) {
+            if (auto binding = curr->FindLocal(name)) {
+                return {binding, curr};
+            }
+        }
+        return {nullptr, nullptr};
     }
 
     Scope* CheckToSet(const std::string& name) {
-        if (vars_.find(name) == vars_.end()) {
-            Scope* anc = anc_scope_;
-            while (true) {
-                if (!anc) {
-                    throw NameError{"no variable with name: " + name + " in all parent scopes"};
-                }
-
-                auto t = anc->vars_.find(name);
-                if (t != anc->vars_.end()) {
-                    return anc;
-                }
-                anc = anc->anc_scope_;
+        for (Scope* curr = this; curr; curr = curr->anc_scope_) {
+            if (curr->FindLocal(name)) {
+                return curr;
             }
         }
-
-        return this;
+        throw NameError{"no variable with name: " + name + " in all parent scopes"};
     }
 
     std::shared_ptr<Object> At(const std::string& name) const {
-        auto it = vars_.find(name);
-
-        if (it == vars_.end()) {
-            Scope* anc = anc_scope_;
-            while (true) {
-                if (!anc) {
-                    throw NameError{"no variable with name: " + name + " in all parent scopes"};
-                }
-
-                auto t = anc->vars_.find(name);
-                if (t != anc->vars_.end()) {
-                    return t->second;
-                }
-                anc = anc->anc_scope_;
+        std::shared_ptr<Object> value;
+        if (!TryAt(name, &value)) {
+            throw NameError{"no variable with name: " + name + " in all parent scopes"};
+        }
+        return value;
+    }
+
+    // Like At, but returns false for an unbound name.
+    bool TryAt(const std::string& name, std::shared_ptr<Object>* value) const {
+        auto [binding, owner] = Find(name);
+        if (!binding) {
+            return false;
+        }
+        if (k_access && owner->IsRoot()) {
+            k_access->reads.insert(name);
+        }
+        *value = binding->Get();
+        return true;
+    }
+
+    void Assign(const std::string& name, const std::shared_ptr<Object>& value);
+
+    void Bind(const std::string& name, const std::shared_ptr<Object>& value,
+              const std::shared_ptr<Box>& box) {
+        vars_.push_back({name, value, box});
+        if (!index_.empty()) {
+            index_.emplace(name, vars_.size() - 1);
+        } else if (vars_.size() == kIndexThreshold) {
+            for (size_t i = 0; i < vars_.size(); ++i) {
+                index_.emplace(vars_[i].name, i);
             }
         }
+    }
+
+    void Reserve(size_t size) {
+        vars_.reserve(size);
+    }
 
-        return it->second;
+    size_t Size() const {
+        return vars_.size();
     }
 
-    void Assign(const std::string& name, const std::shared_ptr<Object>& value) {
-        vars_[name] = value;
+    Binding& GetSlot(size_t index) {
+        return vars_[index];
     }
 
     void Clear() {
         vars_.clear();
+        index_.clear();
+        if (!anc_scope_) {
+            version_ += 1;
+            builtin_version_ += 1;
+        }
+    }
+
+    bool IsRoot() const {
+        return !anc_scope_;
     }
 
-    auto& GetVars() {
-        return vars_;
+    inline Scope* GetRoot() {
+        return root_ ? root_ : this;
+    }
+    inline const Scope* GetRoot() const {
+        return root_ ? root_ : this;
+    }
+
+    // Counts changes of the global bindings of the root; call sites whose head is lexically
+    // global revalidate their cached callee against it. Code is evaluated under the root of the
+    // interpreter that read it only, whichever thread that runs on.
+    inline uint64_t GetVersion() const {
+        return GetRoot()->version_;
+    }
+
+    // Counts changes of global bindings that shadow procedure builtins; call sites and symbols
+    // that resolved to a builtin revalidate against it, so that a global of the same name wins.
+    inline uint64_t GetBuiltinVersion() const {
+        return GetRoot()->builtin_version_;
     }
 
 private:
+    inline const Binding* FindLocal(const std::string& name) const {
+        if (!index_.empty()) {
+            auto it = index_.find(name);
+            return it == index_.end() ? nullptr : &vars_[it->second];
+        }
+        for (const auto& binding : vars_) {
+            if (binding.name == name) {
+                return &binding;
+            }
+        }
+        return nullptr;
+    }
+    inline Binding* FindLocal(const std::string& name) {
+        return const_cast<Binding*>(std::as_const(*this).FindLocal(name));
+    }
+
+    inline static thread_local Access* k_access = nullptr;
+
     Scope* anc_scope_ = nullptr;
-    std::map<std::string, std::shared_ptr<Object>> vars_{};
+    Scope* root_ = nullptr;
+    uint64_t version_ = 0;
+    uint64_t builtin_version_ = 0;
+    std::vector<Binding> vars_{};
+    std::unordered_map<std::string, size_t> index_{};
 };
 
 class Function : public Object {};
 
+// What raised an error object: the error builtin, or the evaluator failing with the error of
+// that name, which the object surfaces as if nothing handles it.
+enum class ErrorKind { kRaised, kRuntime, kName };
+
+// The value of an expression that raised with no handler closer than a guard. Forms return it
+// as soon as a subexpression does, so the raise reaches the guard without unwinding; the raised
+// object waits in the value stack.
+class Raising : public Object {
+public:
+    static const std::shared_ptr<Object>& Get() {
+        static const std::shared_ptr<Object> raising = std::make_shared<Raising>();
+        return raising;
+    }
+};
+
+inline bool IsRaising(const std::shared_ptr<Object>& obj) {
+    return obj == Raising::Get();
+}
+
+// Raises an error the evaluator found as an error object, so that it reaches the nearest handler
+// or guard without unwinding the frames in between.
+std::shared_ptr<Object> RaiseError(ErrorKind kind, std::string_view message);
+
+class Procedure : public Function {
+public:
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& head, Scope& scope) final;
+
+    virtual std::shared_ptr<Object> Call(Arguments args) = 0;
+};
+
+// Builtins on numbers only. Call sites whose arguments the Analyzer proved to be numbers pass
+// their values unboxed and skip the argument checks of Call.
+class FixnumProcedure : public Procedure {
+public:
+    virtual std::shared_ptr<Object> CallFixnums(std::span<const int64_t> args) = 0;
+};
+
 class Boolean : public Object {
 public:
     Boolean(bool value) : value_(value) {
@@ -137,7 +318,7 @@ private:
     bool value_;
 };
 
-class Number : public Object {
+class Number final : public Object {
 public:
     Number(int64_t value) : value_(value) {
     }
@@ -158,21 +339,94 @@ private:
     int64_t value_;
 };
 
-class Symbol : public Object {
-    static std::map<std::string, std::shared_ptr<Function>> k_functions;
+enum class StaticType { kUnknown, kNumber, kBoolean, kString };
+
+// What the analyzer and the optimizer know of a procedure builtin: its arity, the type all its
+// arguments have to be of if they share one and the type of its result. A pure one only
+// computes its result from its arguments, so calls with literal arguments can be folded.
+struct BuiltinSignature {
+    size_t min;
+    size_t max;
+    StaticType args;
+    StaticType result;
+    bool pure;
+};
 
+class Symbol : public Object {
 public:
-    Symbol(const std::string& value) : value_(value) {
+    Symbol(const std::string& value)
+        : value_(value), builtin_(GetBuiltin(value_)), shadowable_(builtin_ && GetSignature(value_)) {
     }
-    Symbol(std::string&& value) : value_(std::move(value)) {
+    Symbol(std::string&& value)
+        : value_(std::move(value)),
+          builtin_(GetBuiltin(value_)),
+          shadowable_(builtin_ && GetSignature(value_)) {
     }
 
     inline std::shared_ptr<Object> Eval(Scope& scope) override {
-        if (auto it = k_functions.find(value_); it != k_functions.end()) {
-            return it->second;
+        if (builtin_) {
+            if (!shadowable_ || (scope.GetBuiltinVersion() == 0 && !Scope::IsTracking())) {
+                return builtin_;
+            }
+            return ResolveBuiltin(scope);
+        }
+        std::shared_ptr<Object> value;
+        if (!GetLookupScope(scope).TryAt(GetLookupName(), &value)) {
+            return RaiseUnbound();
         }
+        return value;
+    }
+
+    // Builtins live in static storage, so the returned pointers own nothing.
+    static std::shared_ptr<Function> GetBuiltin(std::string_view name);
+    // The signature of the procedure builtin of that name, nullptr for other names.
+    static const BuiltinSignature* GetSignature(std::string_view name);
+
+    // A symbol naming a local variable that shadows the builtin of the same name.
+    static std::shared_ptr<Symbol> MakeVariable(const std::string& name) {
+        auto symb = std::make_shared<Symbol>(name);
+        symb->builtin_ = nullptr;
+        symb->shadowable_ = false;
+        return symb;
+    }
 
-        return scope.At(value_);
+    // A reference from macro template code to the global or builtin binding of name. It goes by
+    // a name that can not be read, so local bindings never capture it.
+    static std::shared_ptr<Symbol> MakeGlobal(const std::string& name) {
+        auto symb = std::make_shared<Symbol>("#%" + name);
+        symb->builtin_ = GetBuiltin(name);
+        symb->shadowable_ = symb->builtin_ && GetSignature(name);
+        symb->global_ = name;
+        return symb;
+    }
+
+    inline const std::shared_ptr<Function>& GetBuiltin() const {
+        return builtin_;
+    }
+
+    // Names a procedure builtin, which a global binding of the same name shadows.
+    inline bool IsShadowable() const {
+        return shadowable_;
+    }
+
+    // The global binding of the name if there is one, else the builtin. Either way the name is
+    // recorded as read.
+    std::shared_ptr<Object> ResolveBuiltin(Scope& scope) const;
+
+    // Raises the error of reading the variable while it is unbound.
+    std::shared_ptr<Object> RaiseUnbound() const;
+
+    // The name of the global binding for symbols made by MakeGlobal, empty for the rest.
+    inline const std::string& GetGlobalName() const {
+        return global_;
+    }
+
+    // The scope the variable is looked up and assigned from, and its name there.
+    inline Scope& GetLookupScope(Scope& scope) const {
+        return global_.empty() ? scope : *scope.GetRoot();
+    }
+    inline const std::string& GetLookupName() const {
+        return global_.empty() ? value_ : global_;
     }
 
     inline const std::string& GetName() const {
@@ -185,51 +439,257 @@ public:
 
 private:
     std::string value_;
+    std::shared_ptr<Function> builtin_;
+    bool shadowable_;
+    std::string global_{};
 };
 
-class LambdaFunction : public Object {
-    inline static std::vector<std::shared_ptr<Scope>> k_scopes{};
+inline void Scope::Assign(const std::string& name, const std::shared_ptr<Object>& value) {
+    if (auto binding = FindLocal(name)) {
+        binding->Set(value);
+    } else {
+        Bind(name, value, nullptr);
+    }
+    if (!anc_scope_) {
+        version_ += 1;
+        if (Symbol::GetSignature(name)) {
+            builtin_version_ += 1;
+        }
+        if (k_access) {
+            k_access->writes.insert(name);
+        }
+    }
+}
+
+class String : public Object {
+    static constexpr size_t kInlineCapacity = 15;
+    static constexpr size_t kFlatAppendLimit = 64;
 
 public:
-    LambdaFunction() = default;
-    LambdaFunction(Scope* anc_scope, const std::shared_ptr<Object>& body,
-                   const std::vector<std::string>& args) {
-        k_scopes.emplace_back(std::make_shared<Scope>(anc_scope));
-        scope_ = k_scopes.back();
-        body_ = body;
-        args_ = args;
+    explicit String(std::string_view value);
+    String(std::shared_ptr<const char> data, size_t size);
+    String(std::shared_ptr<String> left, std::shared_ptr<String> right);
+    ~String() override;
+
+    static std::shared_ptr<String> Append(const std::vector<std::shared_ptr<String>>& parts);
+
+    inline size_t Size() const {
+        return size_;
     }
-    LambdaFunction(const LambdaFunction& other)
-        : scope_(other.scope_), body_(other.body_), args_(other.args_) {
+
+    std::string_view GetView();
+
+    std::shared_ptr<String> Substring(size_t begin, size_t end);
+
+    inline std::shared_ptr<Object> Eval(Scope&) override {
+        return shared_from_this();
     }
 
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& head, Scope& scope) override;
+    std::string Stringify() override;
+
+private:
+    void Flatten();
+    void ReleaseChildren();
+
+    size_t size_;
+    char inline_[kInlineCapacity]{};
+    std::shared_ptr<const char> data_{};
+    std::shared_ptr<String> left_{};
+    std::shared_ptr<String> right_{};
+};
+
+struct LambdaInfo {
+    std::vector<std::string> params;
+    std::vector<bool> boxed;
+    std::vector<std::string> locals;
+    std::vector<std::string> free;
+    std::shared_ptr<Object> body;
+    // Name that always holds this lambda where it is created. Calls bind it in their own frame,
+    // so the closure does not capture the binding that holds it.
+    std::string self{};
+};
+
+class LambdaForm : public Object {
+public:
+    explicit LambdaForm(std::shared_ptr<LambdaInfo> info) : info_(std::move(info)) {
+    }
+
+    std::shared_ptr<Object> Eval(Scope& scope) override;
+
+    const std::shared_ptr<LambdaInfo>& GetInfo() const {
+        return info_;
+    }
+
+private:
+    std::shared_ptr<LambdaInfo> info_;
+};
+
+class JitCode;
+
+class LambdaFunction : public Procedure {
+public:
+    LambdaFunction(std::shared_ptr<LambdaInfo> info, std::shared_ptr<Scope> env, Scope* root);
+    ~LambdaFunction() override;
+
+    std::shared_ptr<Object> Call(Arguments args) override;
+
+    const LambdaInfo& GetInfo() const {
+        return *info_;
+    }
+
+private:
+    void BindFrame(Scope& frame, Arguments args);
+    bool EvalTail(Object* expr, Scope& frame, std::shared_ptr<Object>* result);
+    std::shared_ptr<Object> CallJit(Arguments args);
+    std::shared_ptr<Object> CallInterpreted(Arguments args);
+
+    std::shared_ptr<LambdaInfo> info_;
+    std::shared_ptr<Scope> env_;
+    Scope* root_;
+    size_t calls_ = 0;
+    bool jit_failed_ = false;
+    std::unique_ptr<JitCode> jit_{};
+};
+
+// Caches results by the structure of the arguments (numbers, booleans, symbols, strings and
+// lists; anything else by identity). With a max_size the least recently used result is evicted.
+class MemoizedProcedure : public Procedure {
+public:
+    MemoizedProcedure(std::shared_ptr<Procedure> proc, size_t max_size)
+        : proc_(std::move(proc)), max_size_(max_size) {
+    }
+
+    std::shared_ptr<Object> Call(Arguments args) override;
 
-    Scope& GetScope() {
-        return *scope_;
+    size_t GetHits() const {
+        return hits_;
     }
-    const std::vector<std::string>& GetArgs() const {
-        return args_;
+    size_t GetMisses() const {
+        return misses_;
+    }
+    size_t GetEvictions() const {
+        return evictions_;
+    }
+    size_t GetSize() const {
+        return entries_.size();
+    }
+
+private:
+    struct Entry {
+        size_t hash;
+        std::vector<std::shared_ptr<Object>> args;
+        std::shared_ptr<Object> result;
+    };
+
+    std::shared_ptr<Procedure> proc_;
+    size_t max_size_;
+    std::list<Entry> entries_{};
+    std::unordered_multimap<size_t, std::list<Entry>::iterator> index_{};
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    size_t evictions_ = 0;
+};
+
+enum class LetKind { kLet, kLetStar, kLetRec, kDo };
+
+struct LetInfo {
+    LetKind kind;
+    std::vector<std::string> names{};
+    std::vector<bool> boxed{};
+    std::vector<std::string> locals{};
+    std::vector<std::shared_ptr<Object>> inits{};
+    std::vector<std::shared_ptr<Object>> steps{};
+    std::shared_ptr<Object> test{};
+    std::shared_ptr<Object> result{};
+    std::shared_ptr<Object> body{};
+    std::string loop_name{};
+    std::shared_ptr<LambdaForm> loop{};
+};
+
+class LetForm : public Object {
+public:
+    explicit LetForm(std::shared_ptr<LetInfo> info) : info_(std::move(info)) {
+    }
+
+    std::shared_ptr<Object> Eval(Scope& scope) override;
+
+    const std::shared_ptr<LetInfo>& GetInfo() const {
+        return info_;
+    }
+
+private:
+    std::shared_ptr<Object> EvalDo(Scope& frame);
+
+    std::shared_ptr<LetInfo> info_;
+};
+
+// A call of pure builtins folded in code that runs later than it is read, e.g. a lambda body.
+// The value holds while no global shadows one of the builtins; after that the call is evaluated
+// as written.
+class FoldedCall : public Object {
+public:
+    FoldedCall(std::shared_ptr<Object> value, std::shared_ptr<Object> call,
+               std::vector<std::string> names, uint64_t version)
+        : value_(std::move(value)),
+          call_(std::move(call)),
+          names_(std::move(names)),
+          version_(version) {
+    }
+
+    std::shared_ptr<Object> Eval(Scope& scope) override;
+
+    std::string Stringify() override {
+        return value_->Stringify();
+    }
+
+    const std::shared_ptr<Object>& GetValue() const {
+        return value_;
     }
-    std::shared_ptr<Object> GetBody() {
-        return body_;
+
+    // The builtins the value depends on.
+    const std::vector<std::string>& GetNames() const {
+        return names_;
     }
 
 private:
-    std::shared_ptr<Scope> scope_ = nullptr;
-    std::shared_ptr<Object> body_{};
-    std::vector<std::string> args_{};
+    std::shared_ptr<Object> value_;
+    std::shared_ptr<Object> call_;
+    std::vector<std::string> names_;
+    uint64_t version_;
+    bool shadowed_ = false;
+};
+
+struct CallSiteCache {
+    std::shared_ptr<Object> callee{};
+    uint64_t version = 0;
+    bool pinned = false;
+    // The callee is the procedure builtin the head names, valid while no global shadows it.
+    bool builtin = false;
+    bool global = false;
+    bool analyzed = false;
+    bool fixnum = false;
 };
 
 class Cell : public Object {
 public:
+    static constexpr size_t kMaxFixnumArgs = 8;
+
     Cell(std::shared_ptr<Object> first, std::shared_ptr<Object> second)
-        : first_(first), second_(second) {
+        : first_(std::move(first)), second_(std::move(second)) {
+    }
+
+    // Pairs and their control blocks are carved out of the PairHeap.
+    static std::shared_ptr<Cell> Make(std::shared_ptr<Object> first,
+                                      std::shared_ptr<Object> second) {
+        return std::allocate_shared<Cell>(PairAllocator<Cell>{}, std::move(first),
+                                          std::move(second));
     }
 
     Cell(const Cell& other) : first_(other.first_), second_(other.second_) {
     }
 
+    ~Cell() override;
+
     Cell& operator=(const Cell& other) {
         first_ = other.first_;
         second_ = other.second_;
@@ -237,77 +697,249 @@ public:
         return *this;
     }
 
-    inline std::shared_ptr<Object> GetFirst() const {
+    inline const std::shared_ptr<Object>& GetFirst() const {
         return first_;
     }
-    inline std::shared_ptr<Object> GetSecond() const {
+    inline const std::shared_ptr<Object>& GetSecond() const {
         return second_;
     }
 
     inline std::shared_ptr<Object> Eval(Scope& scope) override {
+        Task::Tick();
+        Task::CheckStack();
+        if (IsFixnumCall(scope)) {
+            return EvalFixnums(scope);
+        }
         if (!first_) {
             throw RuntimeError{"empty object in cell"};
         }
-        auto eval = first_->Eval(scope);
+        auto eval = ResolveCallee(scope);
         if (!eval) {
             throw RuntimeError{"apply on empty object in cell"};
         }
-        if (Is<LambdaFunction>(eval) && Is<Cell>(second_) &&
-            Is<Cell>(As<Cell>(second_)->GetFirst()) && As<Cell>(second_)->GetSecond() == nullptr) {
-            auto new_args = As<Cell>(second_)->GetFirst()->Eval(scope);
-            return eval->Apply(std::make_shared<Cell>(new_args, nullptr), scope);
+        if (IsRaising(eval)) {
+            return eval;
         }
         return eval->Apply(second_, scope);
     }
 
-    inline std::string Stringify() override {
-        if (!first_) {
-            return "(())";
+    std::string Stringify() override;
+
+    // Drops the objects, and the uniquely owned pairs and promises they hold, with a worklist
+    // instead of recursing per element.
+    static void Release(std::shared_ptr<Object> first, std::shared_ptr<Object> second = nullptr);
+
+    void MarkGlobalCallSite() {
+        if (!cache_) {
+            cache_ = std::make_unique<CallSiteCache>();
         }
+        cache_->global = true;
+    }
 
-        std::vector<std::shared_ptr<Object>> list;
-        std::shared_ptr<Object> curr = shared_from_this();
-        auto proper = true;
-        while (true) {
-            auto first = As<Cell>(curr)->GetFirst();
-            list.emplace_back(first);
+    // A call can be shared by code analyzed more than once, e.g. a macro argument inserted twice,
+    // so a verdict that its arguments may not be numbers sticks. Returns whether the call stays
+    // marked.
+    bool MarkFixnumCall(bool fixnum) {
+        if (!cache_) {
+            cache_ = std::make_unique<CallSiteCache>();
+        }
+        cache_->fixnum = fixnum && (!cache_->analyzed || cache_->fixnum);
+        cache_->analyzed = true;
+        return cache_->fixnum;
+    }
 
-            auto second = As<Cell>(curr)->GetSecond();
-            if (second && !Is<Cell>(second)) {
-                list.emplace_back(second);
-                proper = false;
-                break;
-            }
+    // Marked as a fixnum call, and its head resolved to the builtin since a global last shadowed
+    // one.
+    inline bool IsFixnumCall(const Scope& scope) const {
+        return cache_ && cache_->fixnum && cache_->builtin &&
+               cache_->version == scope.GetBuiltinVersion();
+    }
 
-            if (!second) {
-                break;
-            }
+    std::shared_ptr<Object> EvalFixnums(Scope& scope);
 
-            curr = As<Cell>(curr)->GetSecond();
+    inline std::shared_ptr<Object> ResolveCallee(Scope& scope) {
+        if (cache_ && cache_->callee &&
+            (cache_->pinned ||
+             cache_->version ==
+                 (cache_->builtin ? scope.GetBuiltinVersion() : scope.GetVersion()))) {
+            return cache_->callee;
         }
 
-        std::string res = "(";
-        for (size_t i = 0; i + 1 < list.size(); ++i) {
-            res += list[i]->Stringify();
-            res += " ";
+        auto symb = As<Symbol>(first_);
+        if (!symb) {
+            return first_->Eval(scope);
         }
-        if (!proper && list.size() > 1) {
-            res += ". ";
+        if (const auto& builtin = symb->GetBuiltin()) {
+            if (!cache_) {
+                cache_ = std::make_unique<CallSiteCache>();
+            }
+            if (!symb->IsShadowable()) {
+                cache_->callee = builtin;
+                cache_->pinned = true;
+                return cache_->callee;
+            }
+            // A global that shadows the builtin is revalidated like any other global.
+            cache_->callee = symb->ResolveBuiltin(scope);
+            cache_->builtin = cache_->callee == builtin;
+            cache_->version = cache_->builtin ? scope.GetBuiltinVersion() : scope.GetVersion();
+            return cache_->callee;
         }
-        res += list.back()->Stringify();
-        res += ")";
 
-        return res;
+        std::shared_ptr<Object> callee;
+        if (!symb->GetLookupScope(scope).TryAt(symb->GetLookupName(), &callee)) {
+            return symb->RaiseUnbound();
+        }
+        if (cache_ && cache_->global) {
+            cache_->callee = callee;
+            cache_->version = scope.GetVersion();
+        }
+        return callee;
     }
 
 private:
+    friend class ListBuilder;
+
+    static void ReleaseAll(std::vector<std::shared_ptr<Object>>* pending);
+
     std::shared_ptr<Object> first_;
     std::shared_ptr<Object> second_;
+    std::unique_ptr<CallSiteCache> cache_{};
 };
 
-size_t GetNumberOfArguments(const std::shared_ptr<Object>&);
-template <class T>
-std::vector<std::shared_ptr<Object>> MakeVector(const std::shared_ptr<Object>&, Scope&);
+// Builds a list front to back. Only the pairs it allocated are ever modified, and only before
+// Finish hands the list out.
+class ListBuilder {
+public:
+    void Push(std::shared_ptr<Object> value) {
+        auto cell = Cell::Make(std::move(value), nullptr);
+        auto next = cell.get();
+        if (last_) {
+            last_->second_ = std::move(cell);
+        } else {
+            head_ = std::move(cell);
+        }
+        last_ = next;
+    }
+
+    std::shared_ptr<Object> Finish(std::shared_ptr<Object> tail = nullptr) {
+        if (!last_) {
+            return tail;
+        }
+        last_->second_ = std::move(tail);
+        last_ = nullptr;
+        return std::move(head_);
+    }
+
+private:
+    std::shared_ptr<Object> head_{};
+    Cell* last_ = nullptr;
+};
+
+// The form is a list headed by the symbol.
+inline bool HeadIs(const std::shared_ptr<Object>& form, std::string_view name) {
+    auto cell = As<Cell>(form);
+    auto head = cell ? As<Symbol>(cell->GetFirst()) : nullptr;
+    return head && head->GetName() == name;
+}
+
+// Appends the elements of the list; false if it is not a proper list.
+inline bool ListToVector(const std::shared_ptr<Object>& list,
+                         std::vector<std::shared_ptr<Object>>* items) {
+    for (auto curr = list; curr;) {
+        auto cell = As<Cell>(curr);
+        if (!cell) {
+            return false;
+        }
+        items->emplace_back(cell->GetFirst());
+        curr = cell->GetSecond();
+    }
+    return true;
+}
+
+// The same for a list walked by raw pointers.
+inline bool ListToVector(Object* list, std::vector<Object*>* items) {
+    for (auto curr = list; curr;) {
+        auto cell = dynamic_cast<Cell*>(curr);
+        if (!cell) {
+            return false;
+        }
+        items->push_back(cell->GetFirst().get());
+        curr = cell->GetSecond().get();
+    }
+    return true;
+}
+
+// Some name occurs more than once.
+inline bool HasDuplicates(const std::vector<std::string>& names) {
+    return std::set<std::string>(names.begin(), names.end()).size() != names.size();
+}
+
+// Lists the items from index from on, ending in tail.
+inline std::shared_ptr<Object> VectorToList(const std::vector<std::shared_ptr<Object>>& items,
+                                            size_t from = 0,
+                                            std::shared_ptr<Object> tail = nullptr) {
+    for (size_t i = items.size(); i > from; --i) {
+        tail = Cell::Make(items[i - 1], std::move(tail));
+    }
+    return tail;
+}
+
+class Promise : public Object {
+public:
+    Promise(std::shared_ptr<Object> value, bool done, bool chained)
+        : state_(std::make_shared<State>(State{done, chained, std::move(value)})) {
+    }
+
+    ~Promise() override;
+
+    std::string Stringify() override {
+        return "#<promise>";
+    }
+
+    static std::shared_ptr<Object> Force(const std::shared_ptr<Object>& obj);
+
+    void Release(std::vector<std::shared_ptr<Object>>* pending);
+
+private:
+    struct State {
+        bool done;
+        bool chained;
+        std::shared_ptr<Object> value;
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+class ErrorObject : public Object {
+public:
+    ErrorObject(std::shared_ptr<String> message, std::shared_ptr<Object> irritants,
+                ErrorKind kind = ErrorKind::kRaised)
+        : message_(std::move(message)), irritants_(std::move(irritants)), kind_(kind) {
+    }
+
+    const std::shared_ptr<String>& GetMessage() const {
+        return message_;
+    }
+    const std::shared_ptr<Object>& GetIrritants() const {
+        return irritants_;
+    }
+    ErrorKind GetKind() const {
+        return kind_;
+    }
+
+    std::string Stringify() override;
+
+private:
+    std::shared_ptr<String> message_;
+    std::shared_ptr<Object> irritants_;
+    ErrorKind kind_;
+};
+
+// Carries an object raised from Scheme to the nearest guard through builtins that call
+// procedures; evaluation itself hands back Raising instead.
+struct RaisedError {
+    std::shared_ptr<Object> value;
+};
 
 class ReturnItself : public Function {
 public:
@@ -315,29 +947,32 @@ public:
 };
 
 template <class T>
-class IsType : public Function {
+class IsType : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
 using IsBoolean = IsType<Boolean>;
 using IsNumber = IsType<Number>;
 using IsSymbol = IsType<Symbol>;
+using IsString = IsType<String>;
 
-class Not : public Function {
+class Not : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class Abs : public Function {
+class Abs : public FixnumProcedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
+    std::shared_ptr<Object> CallFixnums(std::span<const int64_t> args) override;
 };
 
 template <typename F>
-class CompareNumbers : public Function {
+class CompareNumbers : public FixnumProcedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
+    std::shared_ptr<Object> CallFixnums(std::span<const int64_t> args) override;
 
 private:
     F f_{};
@@ -350,9 +985,10 @@ using LessEqual = CompareNumbers<std::less_equal<int64_t>>;
 using GreaterEqual = CompareNumbers<std::greater_equal<int64_t>>;
 
 template <typename F, int64_t init, bool has_one>
-class AccumulateNumbers : public Function {
+class AccumulateNumbers : public FixnumProcedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
+    std::shared_ptr<Object> CallFixnums(std::span<const int64_t> args) override;
 };
 
 template <class T>
@@ -367,57 +1003,206 @@ struct MinClass {
         return std::min<T>(lhs, rhs);
     }
 };
+template <class T>
+struct DivideClass {
+    inline T operator()(const T& lhs, const T& rhs) {
+        if (rhs == 0) {
+            throw RuntimeError{"/: division by zero"};
+        }
+        if (rhs == -1 && lhs == std::numeric_limits<T>::min()) {
+            throw RuntimeError{"/: result does not fit in a number"};
+        }
+        return lhs / rhs;
+    }
+};
+
+// The name a numeric builtin reports in its errors.
+template <class F>
+inline constexpr const char* kNumericName = nullptr;
+template <>
+inline constexpr const char* kNumericName<std::equal_to<int64_t>> = "=";
+template <>
+inline constexpr const char* kNumericName<std::less<int64_t>> = "<";
+template <>
+inline constexpr const char* kNumericName<std::greater<int64_t>> = ">";
+template <>
+inline constexpr const char* kNumericName<std::less_equal<int64_t>> = "<=";
+template <>
+inline constexpr const char* kNumericName<std::greater_equal<int64_t>> = ">=";
+template <>
+inline constexpr const char* kNumericName<std::plus<int64_t>> = "+";
+template <>
+inline constexpr const char* kNumericName<std::multiplies<int64_t>> = "*";
+template <>
+inline constexpr const char* kNumericName<std::minus<int64_t>> = "-";
+template <>
+inline constexpr const char* kNumericName<DivideClass<int64_t>> = "/";
+template <>
+inline constexpr const char* kNumericName<MaxClass<int64_t>> = "max";
+template <>
+inline constexpr const char* kNumericName<MinClass<int64_t>> = "min";
 
 using Plus = AccumulateNumbers<std::plus<int64_t>, 0, true>;
 using Prod = AccumulateNumbers<std::multiplies<int64_t>, 1, true>;
 using Minus = AccumulateNumbers<std::minus<int64_t>, 0, false>;
-using Divide = AccumulateNumbers<std::divides<int64_t>, 0, false>;
+using Divide = AccumulateNumbers<DivideClass<int64_t>, 0, false>;
 using Max = AccumulateNumbers<MaxClass<int64_t>, 0, false>;
 using Min = AccumulateNumbers<MinClass<int64_t>, 0, false>;
 
-class IsNull : public Function {
+class IsNull : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class IsPair : public Function {
+class IsPair : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class IsList : public Function {
+class IsList : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class Cons : public Function {
+class IsEqual : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class Car : public Function {
+class MakePromise : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class Cdr : public Function {
+class Force : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class List : public Function {
+class IsPromise : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class ListRef : public Function {
+class StreamCar : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
-class ListTail : public Function {
+class StreamCdr : public Procedure {
 public:
-    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class IsStreamPair : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+template <bool to_list>
+class StreamWalk : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using StreamTail = StreamWalk<false>;
+using StreamTake = StreamWalk<true>;
+
+class StreamRef : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Cons : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Car : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Cdr : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class List : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ListRef : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ListTail : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Length : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Append : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Reverse : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ListCopy : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+template <bool collect>
+class MapLists : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using Map = MapLists<true>;
+using ForEach = MapLists<false>;
+
+class Filter : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+template <bool left>
+class FoldLists : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using FoldLeft = FoldLists<true>;
+using FoldRight = FoldLists<false>;
+
+template <bool eqv>
+class FindEntry : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using Assoc = FindEntry<false>;
+using Assq = FindEntry<true>;
+
+class Member : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Sort : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
 };
 
 template <bool op>
@@ -434,6 +1219,20 @@ public:
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
 };
 
+class Cond : public Function {
+public:
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& head, Scope& scope) override;
+
+    // Runs the tests and all but the last expression of the chosen clause, which is returned
+    // for the caller to evaluate; nullptr means the value of the form is already in *result.
+    static Object* SelectTail(Object* clauses, Scope& scope, std::shared_ptr<Object>* result);
+};
+
+class Guard : public Function {
+public:
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>& head, Scope& scope) override;
+};
+
 class Define : public Function {
 public:
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
@@ -456,4 +1255,170 @@ using SetCdr = SetPair<false>;
 class CreateLambda : public Function {
 public:
     std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
-};
\ No newline at end of file
+};
+
+template <LetKind kind>
+class BindingForm : public Function {
+public:
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+};
+
+template <bool chained>
+class DelayForm : public Function {
+public:
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+};
+
+using Delay = DelayForm<false>;
+using DelayForce = DelayForm<true>;
+
+class ConsStream : public Function {
+public:
+    std::shared_ptr<Object> Apply(const std::shared_ptr<Object>&, Scope&) override;
+};
+
+using Let = BindingForm<LetKind::kLet>;
+using LetStar = BindingForm<LetKind::kLetStar>;
+using LetRec = BindingForm<LetKind::kLetRec>;
+using Do = BindingForm<LetKind::kDo>;
+
+class StringLength : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class StringRef : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Substring : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class StringAppend : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+template <typename F>
+class CompareStrings : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using StringEqual = CompareStrings<std::equal_to<std::string_view>>;
+using StringLess = CompareStrings<std::less<std::string_view>>;
+
+class StringToSymbol : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class SymbolToString : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class NumberToString : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class OpenInputFile : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class OpenOutputFile : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ClosePort : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ReadLine : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ReadDatum : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+template <bool advance>
+class ReadCharacter : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using ReadChar = ReadCharacter<true>;
+using PeekChar = ReadCharacter<false>;
+
+template <bool raw>
+class WriteValue : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using Write = WriteValue<false>;
+using Display = WriteValue<true>;
+
+class Newline : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class IsEofObject : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+template <bool continuable>
+class RaiseObject : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+using Raise = RaiseObject<false>;
+using RaiseContinuable = RaiseObject<true>;
+
+class Error : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class WithExceptionHandler : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class IsErrorObject : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ErrorObjectMessage : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class ErrorObjectIrritants : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class Memoize : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
+
+class MemoizeStats : public Procedure {
+public:
+    std::shared_ptr<Object> Call(Arguments args) override;
+};
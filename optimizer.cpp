@@ -0,0 +1,294 @@
+#include "optimizer.h"
+
+static bool IsLiteral(const std::shared_ptr<Object>& obj) {
+    return Is<Number>(obj) || Is<Boolean>(obj) || Is<String>(obj) || Is<FoldedCall>(obj);
+}
+
+static bool HasBindingForms(const std::shared_ptr<Object>& expr) {
+    Task::CheckStack();
+    auto cell = As<Cell>(expr);
+    if (!cell) {
+        return false;
+    }
+    if (HeadIs(cell, "quote")) {
+        return false;
+    }
+    for (const auto& name :
+         {"define", "set!", "set-car!", "set-cdr!", "lambda", "let", "let*", "letrec", "do",
+          "guard"}) {
+        if (HeadIs(cell, name)) {
+            return true;
+        }
+    }
+    for (; cell; cell = As<Cell>(cell->GetSecond())) {
+        if (HasBindingForms(cell->GetFirst())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::shared_ptr<Object> Substitute(
+    const std::shared_ptr<Object>& expr,
+    const std::map<std::string, std::shared_ptr<Object>>& values) {
+    Task::CheckStack();
+    if (auto symb = As<Symbol>(expr)) {
+        if (auto it = values.find(symb->GetName()); it != values.end()) {
+            return it->second;
+        }
+        return expr;
+    }
+    auto cell = As<Cell>(expr);
+    if (!cell || HeadIs(cell, "quote")) {
+        return expr;
+    }
+
+    std::vector<std::shared_ptr<Object>> items;
+    bool changed = false;
+    auto tail = expr;
+    for (; Is<Cell>(tail); tail = As<Cell>(tail)->GetSecond()) {
+        const auto& item = As<Cell>(tail)->GetFirst();
+        items.push_back(Substitute(item, values));
+        changed = changed || items.back() != item;
+    }
+    auto last = Substitute(tail, values);
+    if (!changed && last == tail) {
+        return expr;
+    }
+    for (size_t i = items.size(); i > 0; --i) {
+        last = Cell::Make(items[i - 1], last);
+    }
+    return last;
+}
+
+std::shared_ptr<Object> Optimizer::Optimize(const std::shared_ptr<Object>& expr) {
+    rebound_.clear();
+    CollectRebound(expr);
+
+    return OptimizeList(expr);
+}
+
+std::shared_ptr<Object> Optimizer::OptimizeList(const std::shared_ptr<Object>& expr) {
+    Task::CheckStack();
+    std::vector<std::shared_ptr<Object>> items;
+    if (!Is<Cell>(expr) || !ListToVector(expr, &items)) {
+        return expr;
+    }
+
+    if (auto head = As<Symbol>(items.front())) {
+        const auto& name = head->GetName();
+        if (name == "quote") {
+            return expr;
+        }
+        if (name == "lambda" && items.size() >= 3) {
+            auto body = OptimizeBody(items[1], VectorToList(items, 2));
+            return Cell::Make(items[0], Cell::Make(items[1], body));
+        }
+        if (name == "define" && items.size() >= 3 && Is<Cell>(items[1])) {
+            auto body = OptimizeBody(As<Cell>(items[1])->GetSecond(), VectorToList(items, 2));
+            return Cell::Make(items[0], Cell::Make(items[1], body));
+        }
+        if ((name == "define" || name == "set!" || name == "set-car!" || name == "set-cdr!") &&
+            items.size() == 3) {
+            auto value = OptimizeList(items[2]);
+            if (value == items[2]) {
+                return expr;
+            }
+            items[2] = value;
+            return Rebuild(items, expr);
+        }
+    }
+
+    bool defers = HeadIs(expr, "delay") || HeadIs(expr, "delay-force") ||
+                  HeadIs(expr, "cons-stream");
+    deferred_ += defers;
+    bool changed = false;
+    for (auto& item : items) {
+        auto optimized = OptimizeList(item);
+        changed = changed || optimized != item;
+        item = optimized;
+    }
+    deferred_ -= defers;
+    auto call = changed ? As<Cell>(Rebuild(items, expr)) : As<Cell>(expr);
+
+    if (HeadIs(call, "if")) {
+        return PruneIf(call);
+    }
+    if (HeadIs(call->GetFirst(), "lambda")) {
+        return InlineLambda(call);
+    }
+    return FoldCall(call);
+}
+
+std::shared_ptr<Object> Optimizer::OptimizeBody(const std::shared_ptr<Object>& params,
+                                                const std::shared_ptr<Object>& body) {
+    std::vector<std::string> names;
+    for (auto curr = params; Is<Cell>(curr); curr = As<Cell>(curr)->GetSecond()) {
+        if (auto symb = As<Symbol>(As<Cell>(curr)->GetFirst())) {
+            names.emplace_back(symb->GetName());
+        }
+    }
+    for (const auto& name : names) {
+        bound_.insert(name);
+    }
+
+    std::vector<std::shared_ptr<Object>> items;
+    ListToVector(body, &items);
+    deferred_ += 1;
+    for (auto& item : items) {
+        item = OptimizeList(item);
+    }
+    deferred_ -= 1;
+
+    for (const auto& name : names) {
+        bound_.erase(bound_.find(name));
+    }
+    return VectorToList(items);
+}
+
+std::shared_ptr<Object> Optimizer::FoldCall(const std::shared_ptr<Cell>& call) {
+    auto head = As<Symbol>(call->GetFirst());
+    if (!head || !IsBuiltin(head->GetName())) {
+        return call;
+    }
+
+    std::vector<std::shared_ptr<Object>> args;
+    ListToVector(call->GetSecond(), &args);
+    for (const auto& arg : args) {
+        if (!IsLiteral(arg)) {
+            return call;
+        }
+    }
+
+    std::shared_ptr<Object> result;
+    try {
+        result = head->GetBuiltin()->Apply(call->GetSecond(), scope_);
+    } catch (const std::exception&) {
+        return call;
+    }
+    if (IsRaising(result)) {
+        ValueStack::Current().GetRaised() = nullptr;
+        return call;
+    }
+    if (!IsLiteral(result)) {
+        return call;
+    }
+
+    // The result holds only while no global shadows the builtin, so in code that runs later it
+    // is checked again then.
+    Scope::RecordRead(head->GetName());
+    stats_->folded_calls += 1;
+    if (deferred_ == 0) {
+        return result;
+    }
+    std::vector<std::string> names{head->GetName()};
+    for (const auto& arg : args) {
+        if (auto folded = As<FoldedCall>(arg)) {
+            names.insert(names.end(), folded->GetNames().begin(), folded->GetNames().end());
+        }
+    }
+    return std::make_shared<FoldedCall>(result, call, std::move(names),
+                                        scope_.GetBuiltinVersion());
+}
+
+std::shared_ptr<Object> Optimizer::PruneIf(const std::shared_ptr<Cell>& form) {
+    std::vector<std::shared_ptr<Object>> items;
+    // Malformed forms, e.g. from macros, are left for evaluation to reject.
+    if (!ListToVector(form, &items) || items.size() < 3 || items.size() > 4) {
+        return form;
+    }
+
+    auto cond = As<Boolean>(items[1]);
+    if (!cond || (!cond->GetValue() && items.size() < 4)) {
+        return form;
+    }
+
+    stats_->pruned_branches += 1;
+    return cond->GetValue() ? items[2] : items[3];
+}
+
+std::shared_ptr<Object> Optimizer::InlineLambda(const std::shared_ptr<Cell>& call) {
+    std::vector<std::shared_ptr<Object>> lambda;
+    std::vector<std::shared_ptr<Object>> params;
+    std::vector<std::shared_ptr<Object>> args;
+    if (!ListToVector(call->GetFirst(), &lambda) || lambda.size() != 3 ||
+        !ListToVector(lambda[1], &params) || !ListToVector(call->GetSecond(), &args) ||
+        params.size() != args.size() || HasBindingForms(lambda[2])) {
+        return call;
+    }
+
+    std::map<std::string, std::shared_ptr<Object>> values;
+    for (size_t i = 0; i < params.size(); ++i) {
+        auto param = As<Symbol>(params[i]);
+        if (!param || !IsLiteral(args[i])) {
+            return call;
+        }
+        values[param->GetName()] = args[i];
+    }
+
+    stats_->inlined_lambdas += 1;
+    return OptimizeList(Substitute(lambda[2], values));
+}
+
+std::shared_ptr<Object> Optimizer::Rebuild(const std::vector<std::shared_ptr<Object>>& items,
+                                           const std::shared_ptr<Object>& original) {
+    auto list = VectorToList(items);
+    if (positions_) {
+        positions_->Inherit(list, original.get());
+    }
+    return list;
+}
+
+bool Optimizer::IsBuiltin(const std::string& name) const {
+    auto signature = Symbol::GetSignature(name);
+    return signature && signature->pure && !bound_.count(name) && !rebound_.count(name) &&
+           !scope_.Contains(name);
+}
+
+void Optimizer::CollectRebound(const std::shared_ptr<Object>& expr) {
+    Task::CheckStack();
+    auto cell = As<Cell>(expr);
+    if (!cell || HeadIs(cell, "quote")) {
+        return;
+    }
+
+    if (HeadIs(cell, "define") || HeadIs(cell, "set!")) {
+        if (auto rest = As<Cell>(cell->GetSecond())) {
+            auto target = rest->GetFirst();
+            if (auto signature = As<Cell>(target)) {
+                target = signature->GetFirst();
+            }
+            if (auto name = As<Symbol>(target)) {
+                rebound_.insert(name->GetName());
+            }
+        }
+    }
+
+    if (HeadIs(cell, "let") || HeadIs(cell, "let*") || HeadIs(cell, "letrec") ||
+        HeadIs(cell, "do")) {
+        auto rest = As<Cell>(cell->GetSecond());
+        if (rest && Is<Symbol>(rest->GetFirst())) {
+            rebound_.insert(As<Symbol>(rest->GetFirst())->GetName());
+            rest = As<Cell>(rest->GetSecond());
+        }
+        for (auto curr = rest ? As<Cell>(rest->GetFirst()) : nullptr; curr;
+             curr = As<Cell>(curr->GetSecond())) {
+            auto binding = As<Cell>(curr->GetFirst());
+            if (binding && Is<Symbol>(binding->GetFirst())) {
+                rebound_.insert(As<Symbol>(binding->GetFirst())->GetName());
+            }
+        }
+    }
+
+    if (HeadIs(cell, "guard")) {
+        auto rest = As<Cell>(cell->GetSecond());
+        auto spec = rest ? As<Cell>(rest->GetFirst()) : nullptr;
+        if (spec && Is<Symbol>(spec->GetFirst())) {
+            rebound_.insert(As<Symbol>(spec->GetFirst())->GetName());
+        }
+    }
+
+    for (; cell; cell = As<Cell>(cell->GetSecond())) {
+        CollectRebound(cell->GetFirst());
+    }
+}
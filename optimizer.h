@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "object.h"
+#include "parser.h"
+
+struct OptimizerStats {
+    size_t folded_calls = 0;
+    size_t pruned_branches = 0;
+    size_t inlined_lambdas = 0;
+};
+
+class Optimizer {
+public:
+    // Lists rebuilt from lists in positions inherit their positions.
+    Optimizer(Scope& scope, OptimizerStats* stats, SourceMap* positions = nullptr)
+        : scope_(scope), stats_(stats), positions_(positions) {
+    }
+
+    std::shared_ptr<Object> Optimize(const std::shared_ptr<Object>& expr);
+
+private:
+    std::shared_ptr<Object> OptimizeList(const std::shared_ptr<Object>& list);
+    std::shared_ptr<Object> OptimizeBody(const std::shared_ptr<Object>& params,
+                                         const std::shared_ptr<Object>& body);
+    std::shared_ptr<Object> FoldCall(const std::shared_ptr<Cell>& call);
+    std::shared_ptr<Object> PruneIf(const std::shared_ptr<Cell>& form);
+    std::shared_ptr<Object> InlineLambda(const std::shared_ptr<Cell>& call);
+
+    std::shared_ptr<Object> Rebuild(const std::vector<std::shared_ptr<Object>>& items,
+                                    const std::shared_ptr<Object>& original);
+    bool IsBuiltin(const std::string& name) const;
+    void CollectRebound(const std::shared_ptr<Object>& expr);
+
+    Scope& scope_;
+    OptimizerStats* stats_;
+    SourceMap* positions_;
+    std::multiset<std::string> bound_{};
+    std::set<std::string> rebound_{};
+    // Nesting of the code being optimized in bodies that run later than they are read.
+    size_t deferred_ = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+// Fixed-size blocks bump-allocated from 64 KiB pages, so pairs built one after another (a list
+// made by the reader or by a ListBuilder) sit next to each other in memory. Freed blocks go to a
+// per-thread free list and are reused by the next pair allocated on that thread; pages are never
+// returned, which keeps a block valid wherever its last owner happens to release it.
+template <size_t kBlockSize>
+class PairHeap {
+    static constexpr size_t kPageSize = 64 << 10;
+
+    static_assert(kBlockSize >= sizeof(void*) && kBlockSize % alignof(std::max_align_t) == 0);
+
+public:
+    static void* Allocate() {
+        if (auto block = k_free) {
+            k_free = block->next;
+            return block;
+        }
+        if (k_bump == k_end) {
+            k_bump = static_cast<char*>(::operator new(kPageSize));
+            k_end = k_bump + kPageSize / kBlockSize * kBlockSize;
+        }
+        auto block = k_bump;
+        k_bump += kBlockSize;
+        return block;
+    }
+
+    static void Deallocate(void* ptr) {
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = k_free;
+        k_free = block;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    inline static thread_local FreeBlock* k_free = nullptr;
+    inline static thread_local char* k_bump = nullptr;
+    inline static thread_local char* k_end = nullptr;
+};
+
+// Lets std::allocate_shared place a pair and its control block in one PairHeap block.
+template <class T>
+class PairAllocator {
+    static constexpr size_t kAlign = alignof(std::max_align_t);
+    using Heap = PairHeap<(sizeof(T) + kAlign - 1) / kAlign * kAlign>;
+
+public:
+    using value_type = T;
+
+    PairAllocator() = default;
+
+    template <class U>
+    PairAllocator(const PairAllocator<U>&) {
+    }
+
+    T* allocate(size_t count) {
+        if (count != 1) {
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+        return static_cast<T*>(Heap::Allocate());
+    }
+
+    void deallocate(T* ptr, size_t count) {
+        if (count != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        Heap::Deallocate(ptr);
+    }
+
+    template <class U>
+    bool operator==(const PairAllocator<U>&) const {
+        return true;
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Bump-allocates the nodes of one parse. Each node's control block holds a reference to the
+// arena, so code that outlives the parse (a lambda body kept by a closure) stays valid; the
+// chunks are released together once the arena and its last node are gone, on whichever thread
+// drops it.
+class ParseArena {
+    static constexpr size_t kChunkSize = 64 << 10;
+    static constexpr size_t kAlign = alignof(std::max_align_t);
+
+    struct Pool {
+        void* Allocate(size_t size) {
+            size = (size + kAlign - 1) / kAlign * kAlign;
+            if (static_cast<size_t>(end - bump) < size) {
+                size_t chunk_size = std::max(kChunkSize, size);
+                bump = static_cast<char*>(::operator new(chunk_size));
+                end = bump + chunk_size;
+                chunks.push_back(bump);
+            }
+            refs.fetch_add(1, std::memory_order_relaxed);
+            auto result = bump;
+            bump += size;
+            return result;
+        }
+
+        void Unref() {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) > 1) {
+                return;
+            }
+            for (auto chunk : chunks) {
+                ::operator delete(chunk);
+            }
+            delete this;
+        }
+
+        std::vector<char*> chunks{};
+        char* bump = nullptr;
+        char* end = nullptr;
+        std::atomic<size_t> refs = 1;
+    };
+
+public:
+    template <class T>
+    class Allocator {
+    public:
+        using value_type = T;
+
+        explicit Allocator(Pool* pool) : pool_(pool) {
+        }
+
+        template <class U>
+        Allocator(const Allocator<U>& other) : pool_(other.pool_) {
+        }
+
+        T* allocate(size_t count) {
+            return static_cast<T*>(pool_->Allocate(count * sizeof(T)));
+        }
+
+        void deallocate(T*, size_t) {
+            pool_->Unref();
+        }
+
+        template <class U>
+        bool operator==(const Allocator<U>& other) const {
+            return pool_ == other.pool_;
+        }
+
+    private:
+        template <class U>
+        friend class Allocator;
+
+        Pool* pool_;
+    };
+
+    ParseArena() : pool_(new Pool{}) {
+    }
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator=(const ParseArena&) = delete;
+
+    ~ParseArena() {
+        pool_->Unref();
+    }
+
+    template <class T, class... Args>
+    std::shared_ptr<T> Make(Args&&... args) {
+        return std::allocate_shared<T>(Allocator<T>(pool_), std::forward<Args>(args)...);
+    }
+
+private:
+    Pool* pool_;
+};
@@ -1,97 +1,222 @@
 #include "parser.h"
+#include <algorithm>
+#include <span>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 
-std::shared_ptr<Object> Read(Tokenizer* tokenizer) {
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError{"in Read: empty list"};
+template <class Map, class Key, class Make>
+std::shared_ptr<Object> HashConsTable::Lookup(Map& map, const Key& key, Make make) {
+    auto [it, inserted] = map.try_emplace(key);
+    if (!inserted) {
+        if (auto obj = it->second.lock()) {
+            hits_ += 1;
+            return obj;
+        }
     }
 
-    Token token;
-    token = tokenizer->GetToken();
-    tokenizer->Next();
+    std::shared_ptr<Object> obj = make();
+    it->second = obj;
+    if (inserted && ++entries_ >= purge_at_) {
+        Purge();
+    }
+    return obj;
+}
 
-    if (QuoteToken* _ = std::get_if<QuoteToken>(&token)) {
-        if (tokenizer->IsEnd()) {
-            throw SyntaxError{"there should be something after quote"};
+void HashConsTable::Purge() {
+    auto purge = [this](auto& map) {
+        std::erase_if(map, [](const auto& entry) { return entry.second.expired(); });
+        return map.size();
+    };
+    entries_ = purge(numbers_) + purge(symbols_) + purge(strings_) + purge(booleans_) +
+               purge(cells_);
+    purge_at_ = std::max(kMinPurge, 2 * entries_);
+}
+
+std::shared_ptr<Object> HashConsTable::MakeNumber(int64_t value) {
+    return Lookup(numbers_, value, [value] { return std::make_shared<Number>(value); });
+}
+
+std::shared_ptr<Object> HashConsTable::MakeSymbol(const std::string& name) {
+    return Lookup(symbols_, name, [&name] { return std::make_shared<Symbol>(name); });
+}
+
+std::shared_ptr<Object> HashConsTable::InternAtom(const std::shared_ptr<Object>& datum) {
+    if (auto number = As<Number>(datum)) {
+        return MakeNumber(number->GetValue());
+    }
+    if (auto symb = As<Symbol>(datum)) {
+        return MakeSymbol(symb->GetName());
+    }
+    if (auto boolean = As<Boolean>(datum)) {
+        return Lookup(booleans_, boolean->GetValue(), [&datum] { return datum; });
+    }
+    if (auto str = As<String>(datum)) {
+        return Lookup(strings_, std::string(str->GetView()), [&datum] { return datum; });
+    }
+    return datum;
+}
+
+std::shared_ptr<Object> HashConsTable::Intern(const std::shared_ptr<Object>& datum) {
+    if (!Is<Cell>(datum)) {
+        return InternAtom(datum);
+    }
+
+    // Lists are interned from the last cell back, and a list nested as an element is finished
+    // before the cell holding it; each level keeps its cells still to do and the interned rest.
+    struct Level {
+        std::vector<Cell*> spine{};
+        std::shared_ptr<Object> rest{};
+        std::shared_ptr<Object> first{};
+    };
+    std::vector<Level> levels;
+    auto open = [this, &levels](const std::shared_ptr<Object>& list) {
+        auto& level = levels.emplace_back();
+        auto tail = list;
+        while (auto cell = dynamic_cast<Cell*>(tail.get())) {
+            level.spine.push_back(cell);
+            tail = cell->GetSecond();
         }
-        Token next_token = tokenizer->GetToken();
-        if (BracketToken* x = std::get_if<BracketToken>(&next_token)) {
-            if (*x != BracketToken::OPEN) {
-                throw SyntaxError{"there can not be ) after quote"};
-            }
-            tokenizer->Next();
+        level.rest = InternAtom(tail);
+    };
 
-            auto list = ReadList(tokenizer);
-            if (!list) {
-                return std::make_shared<Cell>(std::make_shared<Symbol>("quote"), nullptr);
+    open(datum);
+    while (true) {
+        auto& level = levels.back();
+        if (level.spine.empty()) {
+            auto list = std::move(level.rest);
+            levels.pop_back();
+            if (levels.empty()) {
+                return list;
             }
-            return std::make_shared<Cell>(std::make_shared<Symbol>("quote"),
-                                          std::make_shared<Cell>(list, nullptr));
-        } else {
-            return std::make_shared<Cell>(std::make_shared<Symbol>("quote"), Read(tokenizer));
-        }
-    } else if (ConstantToken* x = std::get_if<ConstantToken>(&token)) {
-        return std::make_shared<Number>(x->value);
-    } else if (BooleanToken* x = std::get_if<BooleanToken>(&token)) {
-        return std::make_shared<Boolean>(x->value);
-    } else if (SymbolToken* x = std::get_if<SymbolToken>(&token)) {
-        return std::make_shared<Symbol>(x->name);
-    } else if (BracketToken* x = std::get_if<BracketToken>(&token)) {
-        if (*x != BracketToken::OPEN) {
-            throw SyntaxError{"in Read: expected ("};
+            levels.back().first = std::move(list);
+            continue;
+        }
+        auto first = std::move(level.first);
+        if (!first) {
+            const auto& element = level.spine.back()->GetFirst();
+            if (Is<Cell>(element)) {
+                open(element);
+                continue;
+            }
+            first = InternAtom(element);
         }
+        auto& rest = level.rest;
+        rest = Lookup(cells_, std::pair{first.get(), rest.get()},
+                      [&first, &rest] { return Cell::Make(first, rest); });
+        level.spine.pop_back();
+    }
+}
 
-        return ReadList(tokenizer);
+template <class T, class... Args>
+static std::shared_ptr<T> MakeNode(ParseArena* arena, Args&&... args) {
+    if (arena) {
+        return arena->Make<T>(std::forward<Args>(args)...);
+    }
+    if constexpr (std::is_same_v<T, Cell>) {
+        return Cell::Make(std::forward<Args>(args)...);
+    } else {
+        return std::make_shared<T>(std::forward<Args>(args)...);
     }
+}
 
-    throw SyntaxError{"in Read: bad pattern"};
+static std::shared_ptr<Object> MakeQuote(HashConsTable* table, ParseArena* arena = nullptr) {
+    return table ? table->MakeSymbol("quote") : MakeNode<Symbol>(arena, "quote");
 }
 
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
-    std::vector<std::shared_ptr<Object>> list;
+void SourceMap::Inherit(const std::shared_ptr<Object>& copy, const Object* original) {
+    auto it = std::find_if(offsets_.begin(), offsets_.end(),
+                           [original](const auto& entry) { return entry.first == original; });
+    if (it == offsets_.end() || copy.get() == original) {
+        return;
+    }
+    auto offset = it->second;
+    offsets_.emplace_back(copy.get(), offset);
+    copies_.push_back(copy);
+}
 
-    size_t number_of_dots = 0;
-    size_t dot_pos;
-    size_t curr_pos = 0;
-    while (true) {
-        if (tokenizer->IsEnd()) {
-            throw SyntaxError{"in ReadList: expected )"};
-        }
+std::string SourceMap::Describe(const Object* list) const {
+    auto it = std::find_if(offsets_.begin(), offsets_.end(),
+                           [list](const auto& entry) { return entry.first == list; });
+    if (it == offsets_.end()) {
+        return {};
+    }
 
-        Token token = tokenizer->GetToken();
+    auto offset = std::min(it->second, source_.size());
+    while (offset < source_.size() && Tokenizer::IsSpace(source_[offset])) {
+        ++offset;
+    }
+    size_t line = 1;
+    size_t line_begin = 0;
+    for (size_t i = 0; i < offset; ++i) {
+        if (source_[i] == '\n') {
+            line += 1;
+            line_begin = i + 1;
+        }
+    }
+    return "line " + std::to_string(line) + ", column " + std::to_string(offset - line_begin + 1);
+}
 
-        if (BracketToken* x = std::get_if<BracketToken>(&token)) {
-            if (*x == BracketToken::CLOSE) {
-                tokenizer->Next();
-                break;
-            }
+static void CheckBindings(const std::shared_ptr<Object>& bindings, size_t min_size,
+                          size_t max_size, const std::string& name) {
+    for (auto curr = bindings; curr;) {
+        auto cell = As<Cell>(curr);
+        if (!cell) {
+            throw SyntaxError{name + " bindings should form a proper list"};
         }
-        if (DotToken* _ = std::get_if<DotToken>(&token)) {
-            number_of_dots += 1;
-            if (number_of_dots > 1) {
-                throw SyntaxError{"in ReadList: incorrect list"};
-            }
-            dot_pos = curr_pos;
-            curr_pos += 1;
-            tokenizer->Next();
-            list.emplace_back(nullptr);
-            continue;
+        size_t size = 0;
+        auto binding = cell->GetFirst();
+        for (; Is<Cell>(binding); binding = As<Cell>(binding)->GetSecond()) {
+            ++size;
+        }
+        if (binding || size < min_size || size > max_size ||
+            !Is<Symbol>(As<Cell>(cell->GetFirst())->GetFirst())) {
+            throw SyntaxError{name + " binding should be a symbol with " +
+                              (min_size == max_size ? "an init" : "an init and a step")};
         }
+        curr = cell->GetSecond();
+    }
+}
 
-        list.emplace_back(Read(tokenizer));
-        curr_pos += 1;
+static void CheckClauses(const std::shared_ptr<Object>& clauses, const std::string& name) {
+    for (auto curr = clauses; curr;) {
+        auto cell = As<Cell>(curr);
+        auto clause = cell ? As<Cell>(cell->GetFirst()) : nullptr;
+        if (!clause) {
+            throw SyntaxError{name + " clauses should be non-empty lists"};
+        }
+        size_t size = 0;
+        auto rest = clause->GetSecond();
+        for (; Is<Cell>(rest); rest = As<Cell>(rest)->GetSecond()) {
+            ++size;
+        }
+        if (rest) {
+            throw SyntaxError{name + " clauses should be proper lists"};
+        }
+        auto test = As<Symbol>(clause->GetFirst());
+        if (test && test->GetName() == "else" && (size == 0 || cell->GetSecond())) {
+            throw SyntaxError{name + " else clause should be last and have a body"};
+        }
+        auto arrow = size > 0 ? As<Symbol>(As<Cell>(clause->GetSecond())->GetFirst()) : nullptr;
+        if (arrow && arrow->GetName() == "=>" && size != 2) {
+            throw SyntaxError{name + " => clause should have one receiver"};
+        }
+        curr = cell->GetSecond();
     }
+}
 
+static std::shared_ptr<Object> MakeList(std::span<const std::shared_ptr<Object>> list,
+                                        size_t number_of_dots, size_t dot_pos,
+                                        ParseArena* arena = nullptr) {
     size_t sz = list.size();
     if (number_of_dots == 0) {
         if (list.empty()) {
             return nullptr;
         }
 
-        std::shared_ptr<Object> cell = std::make_shared<Cell>(list[sz - 1], nullptr);
+        std::shared_ptr<Object> cell = MakeNode<Cell>(arena, list[sz - 1], nullptr);
         for (int i = sz - 2; i >= 0; --i) {
-            cell = std::make_shared<Cell>(list[i], cell);
+            cell = MakeNode<Cell>(arena, list[i], std::move(cell));
         }
 
         if (auto symb = As<Symbol>(list.front())) {
@@ -115,6 +240,39 @@ std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
                     throw SyntaxError{symb->GetName() + " should have at least 2 arguments"};
                 }
             }
+            if (symb->GetName() == "let" || symb->GetName() == "let*" ||
+                symb->GetName() == "letrec") {
+                size_t pos = symb->GetName() == "let" && sz > 1 && Is<Symbol>(list[1]) ? 2 : 1;
+                if (sz < pos + 2) {
+                    throw SyntaxError{symb->GetName() + " should have bindings and a body"};
+                }
+                CheckBindings(list[pos], 2, 2, symb->GetName());
+            }
+            if ((symb->GetName() == "delay" || symb->GetName() == "delay-force") && sz != 2) {
+                throw SyntaxError{symb->GetName() + " should have 1 argument"};
+            }
+            if (symb->GetName() == "cons-stream" && sz != 3) {
+                throw SyntaxError{"cons-stream should have 2 arguments"};
+            }
+            if (symb->GetName() == "define-syntax" && (sz != 3 || !Is<Symbol>(list[1]))) {
+                throw SyntaxError{"define-syntax should have a name and syntax-rules"};
+            }
+            if (symb->GetName() == "do") {
+                if (sz < 3 || !Is<Cell>(list[2])) {
+                    throw SyntaxError{"do should have bindings and a test clause"};
+                }
+                CheckBindings(list[1], 2, 3, "do");
+            }
+            if (symb->GetName() == "cond") {
+                CheckClauses(As<Cell>(cell)->GetSecond(), "cond");
+            }
+            if (symb->GetName() == "guard") {
+                auto spec = sz >= 3 ? As<Cell>(list[1]) : nullptr;
+                if (!spec || !Is<Symbol>(spec->GetFirst())) {
+                    throw SyntaxError{"guard should have a variable with clauses and a body"};
+                }
+                CheckClauses(spec->GetSecond(), "guard");
+            }
         }
 
         return cell;
@@ -129,13 +287,181 @@ std::shared_ptr<Object> ReadList(Tokenizer* tokenizer) {
                               std::to_string(dot_pos) + " and sz = " + std::to_string(sz)};
         }
 
-        std::shared_ptr<Object> cell = std::make_shared<Cell>(list[sz - 3], list[sz - 1]);
+        std::shared_ptr<Object> cell = MakeNode<Cell>(arena, list[sz - 3], list[sz - 1]);
         if (sz > 3) {
             for (int i = sz - 4; i >= 0; --i) {
-                cell = std::make_shared<Cell>(list[i], cell);
+                cell = MakeNode<Cell>(arena, list[i], std::move(cell));
             }
         }
 
         return cell;
     }
-}
\ No newline at end of file
+}
+
+bool DatumBuilder::Add(const Token& token, size_t begin) {
+    bool data = !frames_.empty() && (frames_.back().data || frames_.back().quote);
+    ParseArena* arena = data ? nullptr : arena_;
+
+    if (std::get_if<QuoteToken>(&token)) {
+        frames_.push_back(Frame{true, data, begin});
+        return false;
+    }
+    if (const BracketToken* x = std::get_if<BracketToken>(&token)) {
+        if (*x == BracketToken::OPEN) {
+            frames_.push_back(Frame{false, data, begin, elements_.size()});
+            return false;
+        }
+        if (frames_.empty()) {
+            throw SyntaxError{"in Read: expected ("};
+        }
+        if (frames_.back().quote) {
+            throw SyntaxError{"there can not be ) after quote"};
+        }
+        auto frame = frames_.back();
+        frames_.pop_back();
+        auto list = MakeList(std::span(elements_).subspan(frame.base), frame.number_of_dots,
+                             frame.dot_pos, frame.data ? nullptr : arena_);
+        elements_.resize(frame.base);
+        if (positions_ && list && !frame.data) {
+            positions_->Add(list.get(), frame.begin);
+        }
+        return Complete(std::move(list), true);
+    }
+    if (std::get_if<DotToken>(&token)) {
+        if (frames_.empty() || frames_.back().quote) {
+            throw SyntaxError{"in Read: bad pattern"};
+        }
+        auto& frame = frames_.back();
+        frame.number_of_dots += 1;
+        if (frame.number_of_dots > 1) {
+            throw SyntaxError{"in ReadList: incorrect list"};
+        }
+        frame.dot_pos = elements_.size() - frame.base;
+        elements_.emplace_back(nullptr);
+        return false;
+    }
+
+    if (const ConstantToken* x = std::get_if<ConstantToken>(&token)) {
+        return Complete(table_ ? table_->MakeNumber(x->value) : MakeNode<Number>(arena, x->value),
+                        false);
+    } else if (const BooleanToken* x = std::get_if<BooleanToken>(&token)) {
+        return Complete(MakeNode<Boolean>(arena, x->value), false);
+    } else if (const StringToken* x = std::get_if<StringToken>(&token)) {
+        auto str = MakeNode<String>(table_ ? nullptr : arena, x->value);
+        return Complete(table_ ? table_->Intern(str) : str, false);
+    } else if (const SymbolToken* x = std::get_if<SymbolToken>(&token)) {
+        return Complete(table_ ? table_->MakeSymbol(x->name) : MakeNode<Symbol>(arena, x->name),
+                        false);
+    }
+    throw SyntaxError{"in Read: bad pattern"};
+}
+
+bool DatumBuilder::Complete(std::shared_ptr<Object> datum, bool is_list) {
+    while (!frames_.empty() && frames_.back().quote) {
+        ParseArena* arena = frames_.back().data ? nullptr : arena_;
+        frames_.pop_back();
+        auto quote = MakeQuote(table_, arena);
+        if (is_list && datum) {
+            if (table_) {
+                datum = table_->Intern(datum);
+            }
+            datum = MakeNode<Cell>(arena, quote, MakeNode<Cell>(arena, std::move(datum), nullptr));
+        } else {
+            datum = MakeNode<Cell>(arena, quote, std::move(datum));
+        }
+        is_list = false;
+    }
+
+    if (!frames_.empty()) {
+        elements_.push_back(std::move(datum));
+        return false;
+    }
+    datum_ = std::move(datum);
+    return true;
+}
+
+void DatumBuilder::FailAtEnd() const {
+    if (!frames_.empty() && frames_.back().quote) {
+        throw SyntaxError{"there should be something after quote"};
+    }
+    throw SyntaxError{"in ReadList: expected )"};
+}
+
+std::shared_ptr<Object> Read(Tokenizer* tokenizer, HashConsTable* table, ParseArena* arena,
+                             SourceMap* positions) {
+    if (tokenizer->IsEnd()) {
+        throw SyntaxError{"in Read: empty list"};
+    }
+
+    DatumBuilder builder(table, arena, positions);
+    while (true) {
+        if (tokenizer->IsEnd()) {
+            builder.FailAtEnd();
+        }
+        size_t begin = tokenizer->GetPosition();
+        bool done = builder.Add(tokenizer->GetToken(), begin);
+        tokenizer->Next();
+        if (done) {
+            return builder.Take();
+        }
+    }
+}
+
+void SkipDatum(Tokenizer* tokenizer) {
+    size_t depth = 0;
+    while (true) {
+        if (tokenizer->IsEnd()) {
+            throw SyntaxError{depth ? "in ReadList: expected )" : "in Read: empty list"};
+        }
+        const Token& token = tokenizer->GetToken();
+        bool quote = std::get_if<QuoteToken>(&token);
+        if (const BracketToken* x = std::get_if<BracketToken>(&token)) {
+            if (*x == BracketToken::OPEN) {
+                depth += 1;
+            } else if (depth-- == 0) {
+                throw SyntaxError{"in Read: expected ("};
+            }
+        }
+        tokenizer->Next();
+        if (!quote && depth == 0) {
+            return;
+        }
+    }
+}
+
+void PushParser::Feed(std::string_view chunk) {
+    buffer_.append(chunk);
+    Parse(false);
+}
+
+void PushParser::Finish() {
+    Parse(true);
+    if (!builder_.IsEmpty()) {
+        builder_.FailAtEnd();
+    }
+}
+
+std::shared_ptr<Object> PushParser::PopDatum() {
+    if (ready_.empty()) {
+        throw RuntimeError{"PushParser: no complete datum"};
+    }
+    auto datum = std::move(ready_.front());
+    ready_.pop_front();
+    return datum;
+}
+
+void PushParser::Parse(bool at_end) {
+    Token token;
+    while ((pos_ = Tokenizer::SkipSpaces(buffer_, pos_)) < buffer_.size()) {
+        size_t end = Tokenizer::Lex(buffer_, pos_, !at_end, &token);
+        if (end == Tokenizer::kNeedMore) {
+            break;
+        }
+        if (builder_.Add(token, pos_)) {
+            ready_.push_back(builder_.Take());
+        }
+        pos_ = end;
+    }
+    buffer_.erase(0, pos_);
+    pos_ = 0;
+}
@@ -1,10 +1,153 @@
 #pragma once
 
+#include <deque>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "object.h"
+#include "parse_arena.h"
 #include "tokenizer.h"
 
-std::shared_ptr<Object> Read(Tokenizer* tokenizer);
+// Shares structurally identical immutable data between parses. Entries are weak, so the table
+// never keeps data alive; set-car!/set-cdr! rebind to fresh pairs and never mutate shared ones.
+class HashConsTable {
+    static constexpr size_t kMinPurge = 1024;
 
-std::shared_ptr<Object> ReadList(Tokenizer* tokenizer);
\ No newline at end of file
+public:
+    std::shared_ptr<Object> MakeNumber(int64_t value);
+    std::shared_ptr<Object> MakeSymbol(const std::string& name);
+    std::shared_ptr<Object> Intern(const std::shared_ptr<Object>& datum);
+
+    size_t GetHits() const {
+        return hits_;
+    }
+
+private:
+    struct PairHash {
+        size_t operator()(const std::pair<const Object*, const Object*>& key) const {
+            return std::hash<const Object*>{}(key.first) * 31 +
+                   std::hash<const Object*>{}(key.second);
+        }
+    };
+
+    std::shared_ptr<Object> InternAtom(const std::shared_ptr<Object>& datum);
+    template <class Map, class Key, class Make>
+    std::shared_ptr<Object> Lookup(Map& map, const Key& key, Make make);
+    void Purge();
+
+    std::unordered_map<int64_t, std::weak_ptr<Object>> numbers_{};
+    std::unordered_map<std::string, std::weak_ptr<Object>> symbols_{};
+    std::unordered_map<std::string, std::weak_ptr<Object>> strings_{};
+    std::unordered_map<bool, std::weak_ptr<Object>> booleans_{};
+    std::unordered_map<std::pair<const Object*, const Object*>, std::weak_ptr<Object>, PairHash>
+        cells_{};
+    size_t entries_ = 0;
+    size_t purge_at_ = kMinPurge;
+    size_t hits_ = 0;
+};
+
+// Remembers where the lists of code read from a source start, so that passes running after the
+// parse can point at the form an error is about. Offsets from the tokenizer are relative to the
+// text it reads, which begins at base in the source.
+class SourceMap {
+public:
+    explicit SourceMap(std::string_view source, size_t base = 0) : source_(source), base_(base) {
+    }
+
+    void Add(const Object* list, size_t offset) {
+        offsets_.emplace_back(list, base_ + offset);
+    }
+
+    // Gives a list a pass rebuilt from the original the position of the original. The copy is
+    // kept alive with the map, so its address can not be reused by another list meanwhile.
+    void Inherit(const std::shared_ptr<Object>& copy, const Object* original);
+
+    // "line L, column C" of the list, or an empty string for lists built after the parse.
+    std::string Describe(const Object* list) const;
+
+private:
+    std::string_view source_;
+    size_t base_;
+    std::vector<std::pair<const Object*, size_t>> offsets_{};
+    std::vector<std::shared_ptr<Object>> copies_{};
+};
+
+// Builds data from tokens one at a time, keeping the lists being read on an explicit stack, so
+// nesting is bounded by memory rather than by the native stack.
+class DatumBuilder {
+public:
+    explicit DatumBuilder(HashConsTable* table = nullptr, ParseArena* arena = nullptr,
+                          SourceMap* positions = nullptr)
+        : table_(table), arena_(arena), positions_(positions) {
+    }
+
+    // Takes the token that starts at offset begin of the text; returns true once it completes a
+    // datum, which Take then hands out.
+    bool Add(const Token& token, size_t begin);
+
+    std::shared_ptr<Object> Take() {
+        return std::move(datum_);
+    }
+
+    // Nothing of the next datum has been read yet.
+    bool IsEmpty() const {
+        return frames_.empty();
+    }
+
+    // Fails for text that ends in the middle of a datum.
+    [[noreturn]] void FailAtEnd() const;
+
+private:
+    struct Frame {
+        bool quote = false;
+        bool data = false;
+        size_t begin = 0;
+        size_t base = 0;
+        size_t number_of_dots = 0;
+        size_t dot_pos = 0;
+    };
+
+    bool Complete(std::shared_ptr<Object> datum, bool is_list);
+
+    HashConsTable* table_;
+    ParseArena* arena_;
+    SourceMap* positions_;
+    std::vector<Frame> frames_{};
+    std::vector<std::shared_ptr<Object>> elements_{};
+    std::shared_ptr<Object> datum_{};
+};
+
+// With an arena the code is allocated there; quoted data is always built on the heap since it
+// may be stored and outlive the code. With a source map the lists of code are added to it.
+std::shared_ptr<Object> Read(Tokenizer* tokenizer, HashConsTable* table = nullptr,
+                             ParseArena* arena = nullptr, SourceMap* positions = nullptr);
+
+// Moves past one datum without building it.
+void SkipDatum(Tokenizer* tokenizer);
+
+class PushParser {
+public:
+    explicit PushParser(HashConsTable* table = nullptr) : builder_(table) {
+    }
+
+    void Feed(std::string_view chunk);
+
+    void Finish();
+
+    bool HasDatum() const {
+        return !ready_.empty();
+    }
+
+    std::shared_ptr<Object> PopDatum();
+
+private:
+    void Parse(bool at_end);
+
+    DatumBuilder builder_;
+    std::string buffer_{};
+    size_t pos_ = 0;
+    std::deque<std::shared_ptr<Object>> ready_{};
+};
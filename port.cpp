@@ -0,0 +1,142 @@
+#include "port.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "parser.h"
+
+static std::shared_ptr<String> MapFile(int fd) {
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = info.st_size;
+        void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory != MAP_FAILED) {
+            madvise(memory, size, MADV_SEQUENTIAL);
+            std::shared_ptr<const char> data(static_cast<const char*>(memory),
+                                             [size](const char* ptr) {
+                                                 munmap(const_cast<char*>(ptr), size);
+                                             });
+            return std::make_shared<String>(std::move(data), size);
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Object> EofObject::Get() {
+    static const std::shared_ptr<Object> kEof = std::make_shared<EofObject>();
+    return kEof;
+}
+
+InputPort::InputPort(const std::string& path) {
+    Scope::RecordEffect();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw RuntimeError{"open-input-file: can not open " + path};
+    }
+    contents_ = MapFile(fd);
+
+    if (!contents_) {
+        std::string buffer;
+        ssize_t count;
+        do {
+            size_t size = buffer.size();
+            buffer.resize(size + kReadChunk);
+            count = read(fd, buffer.data() + size, kReadChunk);
+            buffer.resize(size + std::max<ssize_t>(count, 0));
+            Task::Yield();
+        } while (count > 0);
+        if (count < 0) {
+            close(fd);
+            throw RuntimeError{"open-input-file: can not read " + path};
+        }
+        contents_ = std::make_shared<String>(buffer);
+    }
+    close(fd);
+}
+
+std::string_view InputPort::Remaining(const char* name) {
+    Scope::RecordEffect();
+    if (!contents_) {
+        throw RuntimeError{std::string(name) + ": port is closed"};
+    }
+    return contents_->GetView().substr(pos_);
+}
+
+std::shared_ptr<Object> InputPort::ReadLine() {
+    auto view = Remaining("read-line");
+    if (view.empty()) {
+        return EofObject::Get();
+    }
+
+    auto len = view.find('\n');
+    if (len == std::string_view::npos) {
+        len = view.size();
+    }
+    auto line = contents_->Substring(pos_, pos_ + len);
+    pos_ += std::min(len + 1, view.size());
+    return line;
+}
+
+std::shared_ptr<Object> InputPort::ReadChar(bool advance) {
+    auto view = Remaining(advance ? "read-char" : "peek-char");
+    if (view.empty()) {
+        return EofObject::Get();
+    }
+
+    auto result = contents_->Substring(pos_, pos_ + 1);
+    if (advance) {
+        ++pos_;
+    }
+    return result;
+}
+
+// Tokens are lexed only as the datum needs them, so the text after it is never looked at and a
+// syntax error fails the read where it is.
+std::shared_ptr<Object> InputPort::ReadDatum() {
+    auto view = Remaining("read");
+    size_t begin = 0;
+    while (begin < view.size() && Tokenizer::IsSpace(view[begin])) {
+        ++begin;
+    }
+    if (begin == view.size()) {
+        pos_ += begin;
+        return EofObject::Get();
+    }
+
+    Tokenizer tokenizer(view.substr(begin));
+    auto datum = Read(&tokenizer);
+    pos_ += begin + tokenizer.GetTokenEnd();
+    return datum;
+}
+
+OutputPort::OutputPort(const std::string& path) : buffer_(kBufferSize) {
+    Scope::RecordEffect();
+    file_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+    file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        throw RuntimeError{"open-output-file: can not open " + path};
+    }
+}
+
+std::ostream& OutputPort::Current() {
+    Scope::RecordEffect();
+    return k_current ? *k_current : std::cout;
+}
+
+std::ostream& OutputPort::GetStream() {
+    Scope::RecordEffect();
+    if (!file_.is_open()) {
+        throw RuntimeError{"output port is closed"};
+    }
+    return file_;
+}
+
+void OutputPort::Close() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
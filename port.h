@@ -0,0 +1,86 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "object.h"
+
+class EofObject : public Object {
+public:
+    static std::shared_ptr<Object> Get();
+
+    std::string Stringify() override {
+        return "#<eof>";
+    }
+};
+
+// The whole file is mapped (or read in large chunks when it can not be mapped) into one String,
+// so lines and characters are handed out as slices sharing that buffer.
+class InputPort : public Object {
+    static constexpr size_t kReadChunk = 1 << 16;
+
+public:
+    explicit InputPort(const std::string& path);
+
+    std::shared_ptr<Object> ReadLine();
+    std::shared_ptr<Object> ReadChar(bool advance);
+    std::shared_ptr<Object> ReadDatum();
+
+    void Close() {
+        contents_.reset();
+    }
+
+    std::string Stringify() override {
+        return "#<input-port>";
+    }
+
+private:
+    std::string_view Remaining(const char* name);
+
+    std::shared_ptr<String> contents_;
+    size_t pos_ = 0;
+};
+
+class OutputPort : public Object {
+    static constexpr size_t kBufferSize = 1 << 16;
+
+public:
+    class Redirect {
+    public:
+        explicit Redirect(std::ostream* out) : saved_(k_current) {
+            k_current = out;
+        }
+        Redirect(const Redirect&) = delete;
+        Redirect& operator=(const Redirect&) = delete;
+
+        ~Redirect() {
+            k_current = saved_;
+        }
+
+    private:
+        std::ostream* saved_;
+    };
+
+    explicit OutputPort(const std::string& path);
+
+    // The stream display and write use when no port is given.
+    static std::ostream& Current();
+
+    std::ostream& GetStream();
+
+    void Close();
+
+    std::string Stringify() override {
+        return "#<output-port>";
+    }
+
+private:
+    inline static thread_local std::ostream* k_current = nullptr;
+
+    std::vector<char> buffer_;
+    std::ofstream file_;
+};
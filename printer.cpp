@@ -0,0 +1,48 @@
+#include "printer.h"
+
+#include <vector>
+
+struct PrintTask {
+    Object* object;
+    const char* text;
+    bool list_tail;
+};
+
+void Print(const std::shared_ptr<Object>& obj, std::ostream& out) {
+    std::vector<PrintTask> tasks{{obj.get(), nullptr, false}};
+    while (!tasks.empty()) {
+        auto task = tasks.back();
+        tasks.pop_back();
+
+        if (task.text) {
+            out << task.text;
+            continue;
+        }
+
+        auto cell = dynamic_cast<Cell*>(task.object);
+        if (task.list_tail) {
+            if (!task.object) {
+                out << ')';
+            } else if (cell) {
+                out << ' ';
+                tasks.push_back({cell->GetSecond().get(), nullptr, true});
+                tasks.push_back({cell->GetFirst().get(), nullptr, false});
+            } else {
+                out << " . ";
+                tasks.push_back({nullptr, ")", false});
+                tasks.push_back({task.object, nullptr, false});
+            }
+            continue;
+        }
+
+        if (!task.object) {
+            out << "()";
+        } else if (cell) {
+            out << '(';
+            tasks.push_back({cell->GetSecond().get(), nullptr, true});
+            tasks.push_back({cell->GetFirst().get(), nullptr, false});
+        } else {
+            out << task.object->Stringify();
+        }
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+
+#include "object.h"
+
+void Print(const std::shared_ptr<Object>& obj, std::ostream& out);
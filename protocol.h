@@ -0,0 +1,143 @@
+#pragma once
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Wire format of the evaluation server. Every message is a frame: a 4-byte big-endian length
+// and that many bytes. A request carries an 8-byte id chosen by the client and the code; a
+// response carries the id of its request, a status byte and the printed output or the error
+// message. A connection may have many requests in flight, and their responses come back in the
+// order they finish.
+
+enum class ResponseStatus : uint8_t { kOk, kSyntaxError, kRuntimeError, kNameError, kTimeout };
+
+struct Request {
+    uint64_t id = 0;
+    std::string code{};
+};
+
+struct Response {
+    uint64_t id = 0;
+    ResponseStatus status = ResponseStatus::kOk;
+    std::string text{};
+};
+
+inline constexpr size_t kMaxFrameSize = 16 << 20;
+
+inline void PutUint(std::string* out, uint64_t value, size_t bytes) {
+    for (size_t i = bytes; i-- > 0;) {
+        out->push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+inline uint64_t GetUint(std::string_view data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value = value << 8 | static_cast<uint8_t>(data[i]);
+    }
+    return value;
+}
+
+inline std::string EncodeRequest(const Request& request) {
+    std::string frame;
+    PutUint(&frame, 8 + request.code.size(), 4);
+    PutUint(&frame, request.id, 8);
+    frame += request.code;
+    return frame;
+}
+
+inline std::string EncodeResponse(const Response& response) {
+    std::string frame;
+    PutUint(&frame, 9 + response.text.size(), 4);
+    PutUint(&frame, response.id, 8);
+    PutUint(&frame, static_cast<uint8_t>(response.status), 1);
+    frame += response.text;
+    return frame;
+}
+
+inline bool DecodeRequest(std::string_view frame, Request* request) {
+    if (frame.size() < 8) {
+        return false;
+    }
+    request->id = GetUint(frame, 8);
+    request->code = frame.substr(8);
+    return true;
+}
+
+inline bool DecodeResponse(std::string_view frame, Response* response) {
+    if (frame.size() < 9 || frame[8] > static_cast<char>(ResponseStatus::kTimeout)) {
+        return false;
+    }
+    response->id = GetUint(frame, 8);
+    response->status = static_cast<ResponseStatus>(frame[8]);
+    response->text = frame.substr(9);
+    return true;
+}
+
+// Returns false if the peer is gone.
+inline bool SendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        auto count = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        data.remove_prefix(count);
+    }
+    return true;
+}
+
+// Splits the bytes of a connection into frames, reading them in large chunks.
+class FrameReader {
+    static constexpr size_t kReadChunk = 64 << 10;
+
+public:
+    // Reads what is available, or waits for more unless nonblocking. Returns false once the
+    // peer has closed the connection or the read failed.
+    bool Fill(int fd, bool nonblocking = false) {
+        if (pos_ > 0) {
+            buffer_.erase(0, pos_);
+            pos_ = 0;
+        }
+        size_t size = buffer_.size();
+        buffer_.resize(size + kReadChunk);
+        ssize_t count;
+        do {
+            count = recv(fd, buffer_.data() + size, kReadChunk, nonblocking ? MSG_DONTWAIT : 0);
+        } while (count < 0 && errno == EINTR);
+        buffer_.resize(size + std::max<ssize_t>(count, 0));
+        return count > 0 || (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+
+    // Takes the next complete frame; the view stays valid until the next Fill.
+    bool Next(std::string_view* frame) {
+        std::string_view rest(buffer_.data() + pos_, buffer_.size() - pos_);
+        if (rest.size() < 4) {
+            return false;
+        }
+        size_t size = GetUint(rest, 4);
+        if (rest.size() < 4 + size) {
+            return false;
+        }
+        *frame = rest.substr(4, size);
+        pos_ += 4 + size;
+        return true;
+    }
+
+    // The frame being received is longer than kMaxFrameSize.
+    bool IsOversized() const {
+        return buffer_.size() - pos_ >= 4 &&
+               GetUint(std::string_view(buffer_).substr(pos_), 4) > kMaxFrameSize;
+    }
+
+private:
+    std::string buffer_{};
+    size_t pos_ = 0;
+};
@@ -1,20 +1,181 @@
 #include "scheme.h"
 
 std::string Interpreter::Run(const std::string& code) {
-    std::stringstream code_stream(code);
-    Tokenizer tokenizer(&code_stream);
+    std::ostringstream out;
+    RunTo(code, out);
+    return out.str();
+}
 
-    auto result = Read(&tokenizer);
+RunResult Interpreter::TryRun(const std::string& code) {
+    RunResult result;
+    std::ostringstream out;
+    try {
+        RunTo(code, out);
+    } catch (const SyntaxError& error) {
+        result.status = RunResult::Status::kSyntaxError;
+        result.error = error.what();
+    } catch (const NameError& error) {
+        result.status = RunResult::Status::kNameError;
+        result.error = error.what();
+    } catch (const std::exception& error) {
+        result.status = RunResult::Status::kRuntimeError;
+        result.error = error.what();
+    }
+    result.output = out.str();
+    return result;
+}
+
+void Interpreter::RunTo(const std::string& code, std::ostream& out) {
+    Execute(code, out, &value_stack_);
+}
+
+std::unique_ptr<Task> Interpreter::RunAsync(const std::string& code, size_t slice) {
+    return std::make_unique<Task>(
+        [this, code](ValueStack* stack, std::ostream& out) { Execute(code, out, stack); }, slice);
+}
+
+void Interpreter::Execute(const std::string& code, std::ostream& out, ValueStack* stack) {
+    ValueStack::Activation activation(stack);
+    OutputPort::Redirect redirect(&out);
+    Tokenizer tokenizer(code);
+
+    ParseArena arena;
+    SourceMap positions(code);
+    auto result = Read(&tokenizer, hash_cons_.get(), &arena, &positions);
     if (!tokenizer.IsEnd()) {
         throw SyntaxError{"code can not be parsed"};
     }
     if (!result) {
         throw RuntimeError{"null expression can not be evaluated"};
     }
+    Print(Evaluate(result, &positions), out);
+}
+
+// The parsed form has to stay alive while it is evaluated, so that the lists the source map
+// points at are not freed and reused by the passes.
+std::shared_ptr<Object> Interpreter::Evaluate(std::shared_ptr<Object> form,
+                                              SourceMap* positions) {
+    form = expander_.Expand(form);
+    if (!form) {
+        return nullptr;
+    }
+    form = Optimizer(global_scope_, &optimizer_stats_, positions).Optimize(form);
+    form = ClosureConverter(true, &global_scope_, positions).Convert(form);
+    Analyzer(positions, &analyzer_stats_).Analyze(form);
+
+    std::shared_ptr<Object> raised;
+    try {
+        auto result = form->Eval(global_scope_);
+        if (!IsRaising(result)) {
+            return result;
+        }
+        raised = std::move(ValueStack::Current().GetRaised());
+    } catch (RaisedError& error) {
+        raised = std::move(error.value);
+    }
+    if (auto error = As<ErrorObject>(raised); error && error->GetKind() == ErrorKind::kName) {
+        throw NameError{std::string(error->GetMessage()->GetView())};
+    } else if (error && error->GetKind() == ErrorKind::kRuntime) {
+        throw RuntimeError{std::string(error->GetMessage()->GetView())};
+    }
+    std::ostringstream value;
+    Print(raised, value);
+    throw RuntimeError{"uncaught raise: " + value.str()};
+}
+
+std::optional<Interpreter::FormRecord> Interpreter::TakeRecord(std::string_view source) {
+    auto [begin, end] = records_.equal_range(std::hash<std::string_view>{}(source));
+    for (auto it = begin; it != end; ++it) {
+        if (it->second.source == source) {
+            auto record = std::move(it->second);
+            records_.erase(it);
+            return record;
+        }
+    }
+    return std::nullopt;
+}
+
+static bool IsDirty(const std::vector<std::string>& names,
+                    const std::unordered_set<std::string>& dirty) {
+    return std::any_of(names.begin(), names.end(),
+                       [&dirty](const std::string& name) { return dirty.count(name); });
+}
+
+std::string Interpreter::RunIncremental(const std::string& script) {
+    struct Form {
+        std::string_view source;
+        std::optional<FormRecord> previous;
+    };
+
+    // Only the boundaries are found up front; forms are parsed when they have to run.
+    ValueStack::Activation activation(&value_stack_);
+    Tokenizer tokenizer(script);
+    std::vector<Form> forms;
+    while (!tokenizer.IsEnd()) {
+        size_t begin = tokenizer.GetPosition();
+        SkipDatum(&tokenizer);
+        size_t end = tokenizer.GetPosition();
+        while (end > begin && Tokenizer::IsSpace(script[end - 1])) {
+            --end;
+        }
+        std::string_view source(script.data() + begin, end - begin);
+        forms.push_back({source, TakeRecord(source)});
+    }
+
+    // Bindings of forms that were edited or removed keep their old values until redefined, so
+    // everything that used them has to run again. So do the bindings written by forms that run
+    // every time: a cached define would otherwise leave them as the previous run did.
+    std::unordered_set<std::string> dirty;
+    bool rerun_all = false;
+    for (const auto& [_, record] : records_) {
+        dirty.insert(record.writes.begin(), record.writes.end());
+        rerun_all = rerun_all || record.is_syntax;
+    }
+    for (const auto& form : forms) {
+        if (form.previous && !form.previous->cacheable) {
+            dirty.insert(form.previous->writes.begin(), form.previous->writes.end());
+        }
+    }
+    records_.clear();
+    records_.reserve(forms.size());
+
+    std::string output;
+    for (auto& form : forms) {
+        auto& previous = form.previous;
+        FormRecord record;
+        if (previous && previous->cacheable && !rerun_all && !IsDirty(previous->reads, dirty) &&
+            !IsDirty(previous->writes, dirty)) {
+            record = std::move(*previous);
+        } else {
+            ParseArena arena;
+            Tokenizer form_tokenizer(form.source);
+            SourceMap positions(script, form.source.data() - script.data());
+            auto datum = Read(&form_tokenizer, hash_cons_.get(), &arena, &positions);
+            if (!datum) {
+                throw RuntimeError{"null expression can not be evaluated"};
+            }
+            std::ostringstream out;
+            Scope::Access access;
+            {
+                OutputPort::Redirect redirect(&out);
+                Scope::Tracking tracking(&access, global_scope_);
+                Print(Evaluate(datum, &positions), out);
+            }
+
+            record.source = form.source;
+            record.reads.assign(access.reads.begin(), access.reads.end());
+            record.writes.assign(access.writes.begin(), access.writes.end());
+            record.output = std::move(out).str();
+            record.cacheable =
+                HeadIs(datum, "define") && !access.effects && access.writes.size() <= 1;
+            record.is_syntax = HeadIs(datum, "define-syntax");
+            dirty.insert(record.writes.begin(), record.writes.end());
+            rerun_all = rerun_all || (record.is_syntax && !previous);
+        }
 
-    auto to_string = result->Eval(global_scope_);
-    if (!to_string) {
-        return "()";
+        output += record.output;
+        output += '\n';
+        records_.emplace(std::hash<std::string_view>{}(form.source), std::move(record));
     }
-    return to_string->Stringify();
-}
\ No newline at end of file
+    return output;
+}
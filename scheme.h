@@ -2,12 +2,92 @@
 
 #include "parser.h"
 #include "object.h"
+#include "analyzer.h"
+#include "closure.h"
+#include "macro.h"
+#include "native.h"
+#include "optimizer.h"
+#include "port.h"
+#include "printer.h"
+#include <optional>
+#include <ostream>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+struct RunResult {
+    enum class Status { kOk, kSyntaxError, kRuntimeError, kNameError };
+
+    Status status = Status::kOk;
+    std::string output{};
+    std::string error{};
+};
+
+// May move between threads, but is used by one thread at a time.
 class Interpreter {
 public:
     std::string Run(const std::string&);
 
+    // Reports errors in the result instead of throwing; output printed before an error is kept.
+    RunResult TryRun(const std::string& code);
+
+    void RunTo(const std::string&, std::ostream&);
+
+    // Runs every top-level form of the script and returns their results, one per line. A
+    // define whose source is unchanged since the previous call is skipped, and its old result
+    // reused, unless a global it read or wrote has been written by a form evaluated in this
+    // run. Other forms, and defines that did I/O or wrote other globals, always run.
+    std::string RunIncremental(const std::string& script);
+
+    // The task evaluates in this interpreter, which has to outlive it.
+    std::unique_ptr<Task> RunAsync(const std::string& code, size_t slice = Task::kDefaultSlice);
+
+    // Binds a C++ function in the global scope; arity and argument conversions are derived from
+    // its signature. Like a global define, it shadows a builtin procedure of the same name.
+    template <class F>
+    void Register(const std::string& name, F callable) {
+        if (Symbol::GetBuiltin(name) && !Symbol::GetSignature(name)) {
+            throw RuntimeError{"can not register " + name + ": it is a syntax keyword"};
+        }
+        global_scope_.Assign(name, MakeNativeProcedure(name, std::move(callable)));
+    }
+
+    const OptimizerStats& GetOptimizerStats() const {
+        return optimizer_stats_;
+    }
+
+    void SetHashConsing(bool enabled) {
+        hash_cons_ = enabled ? std::make_unique<HashConsTable>() : nullptr;
+    }
+
+    const MacroStats& GetMacroStats() const {
+        return expander_.GetStats();
+    }
+
+    const AnalyzerStats& GetAnalyzerStats() const {
+        return analyzer_stats_;
+    }
+
 private:
+    struct FormRecord {
+        std::string source;
+        std::vector<std::string> reads;
+        std::vector<std::string> writes;
+        std::string output;
+        bool cacheable = false;
+        bool is_syntax = false;
+    };
+
+    void Execute(const std::string& code, std::ostream& out, ValueStack* stack);
+    std::shared_ptr<Object> Evaluate(std::shared_ptr<Object> form, SourceMap* positions = nullptr);
+    std::optional<FormRecord> TakeRecord(std::string_view source);
+
     Scope global_scope_{};
+    ValueStack value_stack_{};
+    OptimizerStats optimizer_stats_{};
+    AnalyzerStats analyzer_stats_{};
+    MacroExpander expander_{};
+    std::unique_ptr<HashConsTable> hash_cons_{};
+    std::unordered_multimap<size_t, FormRecord> records_{};
 };
\ No newline at end of file
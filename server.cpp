@@ -0,0 +1,454 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "protocol.h"
+#include "scheme.h"
+
+// Evaluates requests of local clients on a pool of interpreters:
+//
+//     scheme_server SOCKET [--workers N] [--prelude FILE] [--timeout MS] [--queue N]
+//
+// Every worker thread owns an interpreter that has run the prelude. A request goes to whichever
+// worker is free, so the globals it defines are seen only by later requests of that worker. The timeout
+// counts from when a request is read: code still running then is cancelled at the next slice
+// boundary and answered with kTimeout, and the globals it has already changed stay changed.
+// Compiled code and the builtins that call procedures count their steps too, and recursion too
+// deep for the task stack fails with a runtime error. Responses wait on their connection until
+// its socket takes them, so a client slow to read its responses holds up no worker. On SIGINT or
+// SIGTERM the server stops reading, answers every request it has read, and exits once the clients
+// have taken the responses or gone.
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socket_path{};
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    std::string prelude{};
+    std::chrono::milliseconds timeout{1000};
+    size_t queue = 4096;
+};
+
+// A client socket with the responses queued for it. Workers queue the responses; the serving
+// loop reads the requests and sends the responses as the socket takes them.
+class Connection {
+public:
+    explicit Connection(int fd) : fd_(fd) {
+    }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    ~Connection() {
+        close(fd_);
+    }
+
+    int GetFd() const {
+        return fd_;
+    }
+
+    FrameReader& GetReader() {
+        return reader_;
+    }
+
+    // Counts a request that has been read until its response is queued.
+    void AddRequest() {
+        std::lock_guard lock(mutex_);
+        ++pending_;
+    }
+
+    void Queue(const Response& response) {
+        auto frame = EncodeResponse(response);
+        std::lock_guard lock(mutex_);
+        --pending_;
+        if (!broken_) {
+            outgoing_ += frame;
+        }
+    }
+
+    bool HasOutgoing() {
+        std::lock_guard lock(mutex_);
+        return !outgoing_.empty();
+    }
+
+    // Sends as much of the queued responses as the socket takes without waiting.
+    void Flush() {
+        std::lock_guard lock(mutex_);
+        size_t sent = 0;
+        while (sent < outgoing_.size()) {
+            auto count = send(fd_, outgoing_.data() + sent, outgoing_.size() - sent,
+                              MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (count <= 0) {
+                BreakLocked();
+                return;
+            }
+            sent += count;
+        }
+        outgoing_.erase(0, sent);
+    }
+
+    void StopReading() {
+        std::lock_guard lock(mutex_);
+        reading_ = false;
+    }
+
+    bool IsReading() {
+        std::lock_guard lock(mutex_);
+        return reading_;
+    }
+
+    // The client is gone: responses still to come are dropped.
+    void Break() {
+        std::lock_guard lock(mutex_);
+        BreakLocked();
+    }
+
+    // Nothing is left to read or send.
+    bool IsDone() {
+        std::lock_guard lock(mutex_);
+        return broken_ || (!reading_ && pending_ == 0 && outgoing_.empty());
+    }
+
+private:
+    void BreakLocked() {
+        broken_ = true;
+        reading_ = false;
+        outgoing_.clear();
+    }
+
+    int fd_;
+    FrameReader reader_{};
+    std::mutex mutex_{};
+    std::string outgoing_{};
+    size_t pending_ = 0;
+    bool reading_ = true;
+    bool broken_ = false;
+};
+
+struct Job {
+    std::shared_ptr<Connection> connection;
+    Request request;
+    Clock::time_point deadline;
+};
+
+class JobQueue {
+public:
+    void Push(Job job) {
+        {
+            std::lock_guard lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        ready_.notify_one();
+    }
+
+    // Returns nothing once the queue is closed and drained.
+    std::optional<Job> Pop() {
+        std::unique_lock lock(mutex_);
+        ready_.wait(lock, [this] { return closed_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            return std::nullopt;
+        }
+        auto job = std::move(jobs_.front());
+        jobs_.pop_front();
+        return job;
+    }
+
+    size_t GetSize() {
+        std::lock_guard lock(mutex_);
+        return jobs_.size();
+    }
+
+    void Close() {
+        {
+            std::lock_guard lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+private:
+    std::mutex mutex_{};
+    std::condition_variable ready_{};
+    std::deque<Job> jobs_{};
+    bool closed_ = false;
+};
+
+static int k_stop_pipe[2] = {-1, -1};
+// Written by workers when they queue a response, so that the serving loop polls for sending.
+static int k_wake_pipe[2] = {-1, -1};
+
+static void OnStopSignal(int) {
+    char byte = 0;
+    [[maybe_unused]] auto written = write(k_stop_pipe[1], &byte, 1);
+}
+
+static void WakeServer() {
+    char byte = 0;
+    [[maybe_unused]] auto written = write(k_wake_pipe[1], &byte, 1);
+}
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error{"can not open " + path};
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+static Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg[0] != '-' && options.socket_path.empty()) {
+            options.socket_path = arg;
+            continue;
+        }
+        if (i + 1 == argc) {
+            throw std::runtime_error{"bad argument " + arg};
+        }
+        std::string value = argv[++i];
+        if (arg == "--workers") {
+            options.workers = std::max(1ul, std::stoul(value));
+        } else if (arg == "--prelude") {
+            options.prelude = ReadFile(value);
+        } else if (arg == "--timeout") {
+            options.timeout = std::chrono::milliseconds(std::stoul(value));
+        } else if (arg == "--queue") {
+            options.queue = std::max(1ul, std::stoul(value));
+        } else {
+            throw std::runtime_error{"bad argument " + arg};
+        }
+    }
+    if (options.socket_path.empty()) {
+        throw std::runtime_error{
+            "usage: scheme_server SOCKET [--workers N] [--prelude FILE] [--timeout MS] "
+            "[--queue N]"};
+    }
+    return options;
+}
+
+static int Listen(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error{"socket path is too long: " + path};
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(fd, SOMAXCONN) < 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "bind " + path);
+    }
+    return fd;
+}
+
+// Runs the code as a task, so that it can be stopped between slices once its time is up.
+static Response Evaluate(Interpreter* interpreter, const Job& job) {
+    Response response{job.request.id, ResponseStatus::kTimeout, "evaluation timed out"};
+    if (Clock::now() >= job.deadline) {
+        return response;
+    }
+    auto task = interpreter->RunAsync(job.request.code);
+    while (!task->Resume()) {
+        if (Clock::now() >= job.deadline) {
+            task->Cancel();
+            return response;
+        }
+    }
+
+    try {
+        response.text = task->GetResult();
+        response.status = ResponseStatus::kOk;
+    } catch (const SyntaxError& error) {
+        response.status = ResponseStatus::kSyntaxError;
+        response.text = error.what();
+    } catch (const NameError& error) {
+        response.status = ResponseStatus::kNameError;
+        response.text = error.what();
+    } catch (const std::exception& error) {
+        response.status = ResponseStatus::kRuntimeError;
+        response.text = error.what();
+    }
+    return response;
+}
+
+static void RunWorker(const Options& options, JobQueue* queue, std::promise<void> ready) {
+    Interpreter interpreter;
+    try {
+        if (!options.prelude.empty()) {
+            interpreter.RunIncremental(options.prelude);
+        }
+    } catch (...) {
+        ready.set_exception(std::current_exception());
+        return;
+    }
+    ready.set_value();
+
+    while (auto job = queue->Pop()) {
+        job->connection->Queue(Evaluate(&interpreter, *job));
+        WakeServer();
+    }
+}
+
+// Reads what the client has sent and queues its complete requests. Returns false once the
+// connection should no longer be read.
+static bool ReadRequests(const std::shared_ptr<Connection>& connection, const Options& options,
+                         JobQueue* queue) {
+    auto& reader = connection->GetReader();
+    bool open = reader.Fill(connection->GetFd(), true);
+
+    auto deadline = options.timeout.count() > 0 ? Clock::now() + options.timeout
+                                                : Clock::time_point::max();
+    std::string_view frame;
+    while (reader.Next(&frame)) {
+        Job job{connection, {}, deadline};
+        if (!DecodeRequest(frame, &job.request)) {
+            return false;
+        }
+        connection->AddRequest();
+        queue->Push(std::move(job));
+    }
+    return open && !reader.IsOversized();
+}
+
+// Accepts clients, reads their requests and sends the responses. Reading pauses while the queue
+// is full, so a client that sends faster than the workers evaluate is held back by its socket
+// buffer. After a stop signal it only sends, until every connection is done.
+static void Serve(const Options& options, int listen_fd, JobQueue* queue) {
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::vector<pollfd> fds;
+    bool stopping = false;
+    while (!stopping || !connections.empty()) {
+        bool paused = queue->GetSize() >= options.queue;
+        fds.assign({{stopping ? -1 : k_stop_pipe[0], POLLIN, 0},
+                    {k_wake_pipe[0], POLLIN, 0},
+                    {stopping ? -1 : listen_fd, POLLIN, 0}});
+        for (const auto& connection : connections) {
+            short events = (!paused && connection->IsReading() ? POLLIN : 0) |
+                           (connection->HasOutgoing() ? POLLOUT : 0);
+            fds.push_back({connection->GetFd(), events, 0});
+        }
+        if (poll(fds.data(), fds.size(), paused && !stopping ? 1 : -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+        if (fds[0].revents) {
+            stopping = true;
+            for (const auto& connection : connections) {
+                connection->StopReading();
+            }
+        }
+        if (fds[1].revents) {
+            char bytes[256];
+            while (read(k_wake_pipe[0], bytes, sizeof(bytes)) > 0) {
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < connections.size(); ++i) {
+            auto& connection = connections[i];
+            auto events = fds[i + 3].revents;
+            if ((events & POLLIN) && connection->IsReading() &&
+                !ReadRequests(connection, options, queue)) {
+                connection->StopReading();
+            }
+            if (events & POLLOUT) {
+                connection->Flush();
+            }
+            if ((events & POLLERR) || ((events & POLLHUP) && !(events & POLLIN))) {
+                connection->Break();
+            }
+            if (!connection->IsDone()) {
+                connections[kept++] = std::move(connection);
+            }
+        }
+        connections.resize(kept);
+
+        if (fds[2].revents & POLLIN) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                connections.push_back(std::make_shared<Connection>(fd));
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        auto options = ParseOptions(argc, argv);
+
+        if (pipe2(k_stop_pipe, O_CLOEXEC) < 0 || pipe2(k_wake_pipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+            throw std::system_error(errno, std::generic_category(), "pipe");
+        }
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGINT, OnStopSignal);
+        signal(SIGTERM, OnStopSignal);
+
+        JobQueue queue;
+        std::vector<std::thread> workers;
+        std::vector<std::future<void>> started;
+        for (size_t i = 0; i < options.workers; ++i) {
+            std::promise<void> ready;
+            started.push_back(ready.get_future());
+            workers.emplace_back(RunWorker, std::cref(options), &queue, std::move(ready));
+        }
+        auto join = [&] {
+            queue.Close();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        };
+        try {
+            for (auto& ready : started) {
+                ready.get();
+            }
+            int listen_fd = Listen(options.socket_path);
+            std::cerr << "scheme_server: listening on " << options.socket_path << " with "
+                      << options.workers << " workers\n";
+            Serve(options, listen_fd, &queue);
+            close(listen_fd);
+            unlink(options.socket_path.c_str());
+        } catch (...) {
+            join();
+            throw;
+        }
+        join();
+    } catch (const std::exception& error) {
+        std::cerr << "scheme_server: " << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "task.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "port.h"
+
+struct Task::Context {
+    ucontext_t task;
+    ucontext_t caller;
+    void* stack;
+};
+
+// Thrown from the yield point of a cancelled task to unwind its stack.
+struct TaskCancelled {};
+
+// The stack of the last finished task is kept for the next one, so a thread that runs many short
+// tasks maps a stack and faults its pages in only once.
+struct SpareStack {
+    SpareStack() = default;
+    SpareStack(const SpareStack&) = delete;
+    SpareStack& operator=(const SpareStack&) = delete;
+
+    ~SpareStack() {
+        if (stack) {
+            munmap(stack, size);
+        }
+    }
+
+    void* stack = nullptr;
+    size_t size = 0;
+};
+
+static thread_local SpareStack k_spare_stack;
+
+Task::Task(std::function<void(ValueStack*, std::ostream&)> body, size_t slice)
+    : body_(std::move(body)), slice_(std::max<size_t>(slice, 1)), context_(new Context{}) {
+    if (k_spare_stack.stack) {
+        context_->stack = std::exchange(k_spare_stack.stack, nullptr);
+        return;
+    }
+    context_->stack = mmap(nullptr, kStackSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (context_->stack == MAP_FAILED) {
+        throw RuntimeError{"task: can not allocate a stack"};
+    }
+    mprotect(context_->stack, sysconf(_SC_PAGESIZE), PROT_NONE);
+}
+
+Task::~Task() {
+    Cancel();
+    if (!k_spare_stack.stack) {
+        k_spare_stack.stack = context_->stack;
+        k_spare_stack.size = kStackSize;
+    } else {
+        munmap(context_->stack, kStackSize);
+    }
+}
+
+bool Task::Resume() {
+    if (IsDone()) {
+        return true;
+    }
+    if (k_current) {
+        throw RuntimeError{"a task can not be resumed from another task"};
+    }
+
+    if (!started_) {
+        getcontext(&context_->task);
+        context_->task.uc_stack.ss_sp = context_->stack;
+        context_->task.uc_stack.ss_size = kStackSize;
+        context_->task.uc_link = &context_->caller;
+        auto address = reinterpret_cast<uintptr_t>(this);
+        makecontext(&context_->task, reinterpret_cast<void (*)()>(Entry), 2,
+                    static_cast<uint32_t>(address), static_cast<uint32_t>(address >> 32));
+        started_ = true;
+    }
+    SwitchIn();
+    return IsDone();
+}
+
+void Task::Cancel() {
+    if (IsDone()) {
+        return;
+    }
+    if (k_current) {
+        throw RuntimeError{"a task can not be cancelled from another task"};
+    }
+    if (!started_) {
+        state_ = State::kCancelled;
+        return;
+    }
+
+    cancelling_ = true;
+    while (!IsDone()) {
+        SwitchIn();
+    }
+}
+
+std::string Task::GetResult() const {
+    if (state_ == State::kFailed) {
+        std::rethrow_exception(error_);
+    }
+    return out_.str();
+}
+
+void Task::Yield() {
+    auto task = k_current;
+    if (!task) {
+        k_steps_left = SIZE_MAX;
+        return;
+    }
+
+    swapcontext(&task->context_->task, &task->context_->caller);
+    if (task->cancelling_) {
+        throw TaskCancelled{};
+    }
+}
+
+void Task::Entry(uint32_t low, uint32_t high) {
+    auto task = reinterpret_cast<Task*>(static_cast<uintptr_t>(high) << 32 | low);
+    try {
+        task->body_(&task->value_stack_, task->out_);
+        task->state_ = State::kDone;
+    } catch (const TaskCancelled&) {
+        task->state_ = State::kCancelled;
+    } catch (...) {
+        task->error_ = std::current_exception();
+        task->state_ = State::kFailed;
+    }
+}
+
+// The thread-local evaluation state of the caller is put aside while the task runs.
+void Task::SwitchIn() {
+    ValueStack::Activation activation(&value_stack_);
+    OutputPort::Redirect redirect(&out_);
+    auto saved_steps = k_steps_left;
+    auto saved_limit = k_stack_limit;
+    k_current = this;
+    k_steps_left = slice_;
+    k_stack_limit = reinterpret_cast<uintptr_t>(context_->stack) + kStackReserve;
+
+    swapcontext(&context_->caller, &context_->task);
+
+    k_current = nullptr;
+    k_steps_left = saved_steps;
+    k_stack_limit = saved_limit;
+}
+
+// Outside of tasks the limit is found on the first check of the thread. A thread whose stack
+// can not be found is not checked.
+void Task::FindThreadStack() {
+    pthread_attr_t attr;
+    void* stack = nullptr;
+    size_t size = 0;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        pthread_attr_getstack(&attr, &stack, &size);
+        pthread_attr_destroy(&attr);
+    }
+    k_stack_limit = stack ? reinterpret_cast<uintptr_t>(stack) + kStackReserve : 1;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "error.h"
+#include "value_stack.h"
+
+// A script running on its own machine stack. Evaluation counts steps and switches back to the
+// caller of Resume once the slice is used up, so many tasks can be interleaved on one thread.
+class Task {
+    static constexpr size_t kStackSize = 8 << 20;
+    static constexpr size_t kStackReserve = 256 << 10;
+
+public:
+    enum class State { kSuspended, kDone, kFailed, kCancelled };
+
+    static constexpr size_t kDefaultSlice = 10000;
+
+    Task(std::function<void(ValueStack*, std::ostream&)> body, size_t slice);
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task();
+
+    // Runs the next slice and returns true once the task has finished.
+    bool Resume();
+
+    // Unwinds a suspended task; its stack objects are destroyed before this returns.
+    void Cancel();
+
+    State GetState() const {
+        return state_;
+    }
+
+    bool IsDone() const {
+        return state_ != State::kSuspended;
+    }
+
+    // Returns everything printed so far and rethrows the error of a failed task.
+    std::string GetResult() const;
+
+    static inline void Tick() {
+        if (--k_steps_left == 0) {
+            Yield();
+        }
+    }
+
+    // Gives up the rest of the slice; does nothing outside of a task.
+    static void Yield();
+
+    // Throws a RuntimeError once the machine stack of the task, or of the thread outside of a
+    // task, is nearly used up, so that deep recursion fails instead of crashing.
+    static inline void CheckStack() {
+        char marker;
+        if (reinterpret_cast<uintptr_t>(&marker) < k_stack_limit) {
+            throw RuntimeError{"recursion is too deep"};
+        }
+        if (!k_stack_limit) {
+            FindThreadStack();
+        }
+    }
+
+    // The lowest address the machine stack of the task, or of the thread outside of a task, may
+    // reach; it keeps the reserve that CheckStack leaves. Code that checks the stack on its own
+    // stops above it.
+    static uintptr_t GetStackLimit() {
+        if (!k_stack_limit) {
+            FindThreadStack();
+        }
+        return k_stack_limit;
+    }
+
+    // Code that counts steps on its own takes the steps left and hands back what it did not use.
+    static size_t GetStepsLeft() {
+        return k_steps_left;
+    }
+    static void SetStepsLeft(size_t steps) {
+        k_steps_left = steps;
+    }
+
+private:
+    struct Context;
+
+    static void Entry(uint32_t low, uint32_t high);
+    static void FindThreadStack();
+
+    void SwitchIn();
+
+    inline static thread_local Task* k_current = nullptr;
+    inline static thread_local size_t k_steps_left = SIZE_MAX;
+    inline static thread_local uintptr_t k_stack_limit = 0;
+
+    std::function<void(ValueStack*, std::ostream&)> body_;
+    size_t slice_;
+    State state_ = State::kSuspended;
+    bool started_ = false;
+    bool cancelling_ = false;
+    std::unique_ptr<Context> context_;
+    ValueStack value_stack_{};
+    std::ostringstream out_{};
+    std::exception_ptr error_{};
+};
@@ -0,0 +1,3 @@
+// The entry point of the test binary; every tests/test_*.cpp file only adds test cases.
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
@@ -0,0 +1,59 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+TEST_CASE("Arity errors in code that surely runs abort at define time") {
+    Interpreter interpreter;
+    REQUIRE_THROWS_AS(interpreter.Run("(define (f x) (car x x))"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("(define (g) ((lambda (x) x)))"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("(define (h x) (if (car x 1) 1 2))"), SyntaxError);
+}
+
+TEST_CASE("Arity errors name the position of the call") {
+    Interpreter interpreter;
+    REQUIRE_THROWS_WITH(interpreter.Run("(define (f x)\n  (car x x))"),
+                        "line 2, column 3: car: wrong number of arguments");
+    REQUIRE_THROWS_WITH(interpreter.Run("(define (g)\n  ((lambda (x) x)))"),
+                        "line 2, column 3: lambda: wrong number of arguments");
+    REQUIRE_THROWS_WITH(interpreter.Run("(define (g)\n  ((lambda (x) (+ x 1)) (* 2 3) 4))"),
+                        "line 2, column 3: lambda: wrong number of arguments");
+
+    interpreter.Run("(define (length l) 0)");
+    REQUIRE_THROWS_WITH(interpreter.Run("(define (h l)\n  (car (length l) 1))"),
+                        "line 2, column 3: car: wrong number of arguments");
+}
+
+TEST_CASE("Errors in handled or skipped code are raised at run time") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(guard (e (#t 'caught)) (+ 1 \"a\"))") == "caught");
+    REQUIRE(interpreter.Run("(guard (e (#t 'caught)) (car 1 2))") == "caught");
+    REQUIRE(interpreter.Run("(guard (e (#t 'handled)) (with-exception-handler"
+                            " (lambda (e) (raise 'handled))"
+                            " (lambda () (abs 1 2))))") == "handled");
+
+    interpreter.Run("(define (f x) (if (> x 0) (car x x) x))");
+    REQUIRE(interpreter.Run("(f 0)") == "0");
+    REQUIRE_THROWS_AS(interpreter.Run("(f 1)"), RuntimeError);
+    REQUIRE(interpreter.Run("(cond (#t 1) (else (cdr)))") == "1");
+    REQUIRE(interpreter.Run("(do ((i 0 (+ i 1))) ((= i 0) 'none) (car))") == "none");
+}
+
+TEST_CASE("Arguments of a wrong type are left to run time") {
+    Interpreter interpreter;
+    interpreter.Run("(define (s) (string-length 5))");
+    REQUIRE_THROWS_AS(interpreter.Run("(s)"), RuntimeError);
+    REQUIRE(interpreter.Run("(if #f (+ 1 \"a\") 2)") == "2");
+}
+
+TEST_CASE("Fixnum calls check arguments typed by builtins shadowed since") {
+    Interpreter interpreter;
+    interpreter.Run("(define (f l) (+ (length l) 1))");
+    interpreter.Run("(define (g l) (let ((n (length l))) (* n 2)))");
+    REQUIRE(interpreter.Run("(list (f '(1 2)) (g '(1 2)))") == "(3 4)");
+
+    interpreter.Run("(define (length l) (if (null? l) 'none l))");
+    REQUIRE_THROWS_WITH(interpreter.Run("(f '())"), "+: unexpected argument type");
+    REQUIRE_THROWS_WITH(interpreter.Run("(g '(1))"), "*: unexpected argument type");
+    interpreter.Run("(define (length l) 10)");
+    REQUIRE(interpreter.Run("(list (f '()) (g '()))") == "(11 20)");
+}
@@ -0,0 +1,90 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+TEST_CASE("Local bindings shadow builtins") {
+    Interpreter interpreter;
+    interpreter.Run("(define (g length) (+ length 1))");
+    REQUIRE(interpreter.Run("(g 5)") == "6");
+    REQUIRE(interpreter.Run("(let ((abs 7)) abs)") == "7");
+    REQUIRE(interpreter.Run("(let loop ((list 3)) (if (= list 0) 'done (loop (- list 1))))") ==
+            "done");
+
+    interpreter.Run("(define (h l) (define (length l) 42) (length l))");
+    REQUIRE(interpreter.Run("(h '(1 2))") == "42");
+    REQUIRE(interpreter.Run("(length '(1 2))") == "2");
+}
+
+TEST_CASE("Globals shadow builtins") {
+    Interpreter interpreter;
+    interpreter.Run("(define (count l) (length l))");
+    REQUIRE(interpreter.Run("(count '(1 2))") == "2");
+
+    interpreter.Run("(define (length l) (if (null? l) 100 (+ 1 (length (cdr l)))))");
+    REQUIRE(interpreter.Run("(length '(1 2))") == "102");
+    REQUIRE(interpreter.Run("(count '(1 2))") == "102");
+    REQUIRE(interpreter.Run("(map length '((1) ()))") == "(101 100)");
+
+    interpreter.Run("(define (list a b) (cons 'list (cons a (cons b '()))))");
+    REQUIRE(interpreter.Run("(list 1 2)") == "(list 1 2)");
+    interpreter.Run("(define (map f l) (if (null? l) '() (cons (f (car l)) (map f (cdr l)))))");
+    REQUIRE(interpreter.Run("(map abs '(-1 2))") == "(1 2)");
+    interpreter.Run("(define display 1)");
+    REQUIRE(interpreter.Run("display") == "1");
+    interpreter.Run("(set! display 2)");
+    REQUIRE(interpreter.Run("display") == "2");
+
+    interpreter.Run("(define (add a b) (+ a b))");
+    interpreter.Run("(define (two) (let ((x 1)) (+ x 1)))");
+    interpreter.Run("(define (three) (let loop ((x 1)) (if (= x 0) 0 (+ x 2))))");
+    REQUIRE(interpreter.Run("(two)") == "2");
+    REQUIRE(interpreter.Run("(three)") == "3");
+    for (int i = 0; i < 2000; ++i) {
+        REQUIRE(interpreter.Run("(add 1 2)") == "3");
+    }
+    interpreter.Run("(define (+ a b) (* a b))");
+    REQUIRE(interpreter.Run("(add 5 7)") == "35");
+    REQUIRE(interpreter.Run("(two)") == "1");
+    REQUIRE(interpreter.Run("(three)") == "2");
+    REQUIRE(interpreter.Run("(let loop ((i 0)) (if (= i 3) (+ i 2) (loop (- i -1))))") == "6");
+
+    REQUIRE_THROWS_AS(interpreter.Run("(define if 1)"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("(set! lambda 1)"), SyntaxError);
+}
+
+TEST_CASE("Syntax keywords can not be bound") {
+    Interpreter interpreter;
+    REQUIRE_THROWS_AS(interpreter.Run("(lambda (if) if)"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("(let ((define 1)) define)"), SyntaxError);
+}
+
+static const std::vector<std::string> kBuiltinNames = {
+    "quote", "boolean?", "number?", "symbol?", "not", "abs", "=", "<", ">", "<=", ">=", "+", "*",
+    "-", "/", "max", "min", "pair?", "null?", "equal?", "delay", "delay-force", "make-promise",
+    "force", "promise?", "cons-stream", "stream-car", "stream-cdr", "stream-pair?", "stream-null?",
+    "stream-ref", "stream-tail", "stream-take", "list?", "cons", "car", "cdr", "list", "list-ref",
+    "list-tail", "length", "append", "reverse", "list-copy", "map", "for-each", "filter",
+    "fold-left", "fold-right", "assoc", "assq", "member", "sort", "and", "or", "if", "define",
+    "set!", "set-car!", "set-cdr!", "lambda", "let", "let*", "letrec", "do", "string?",
+    "string-length", "string-ref", "substring", "string-append", "string=?", "string<?",
+    "string->symbol", "symbol->string", "number->string", "open-input-file", "open-output-file",
+    "close-port", "read-line", "read", "read-char", "peek-char", "write", "display", "newline",
+    "eof-object?", "cond", "guard", "raise", "raise-continuable", "error", "with-exception-handler",
+    "error-object?", "error-object-message", "error-object-irritants", "memoize", "memoize-stats"
+};
+
+TEST_CASE("Every builtin name resolves and other names do not") {
+    for (const auto& name : kBuiltinNames) {
+        auto builtin = Symbol::GetBuiltin(name);
+        REQUIRE(builtin);
+        bool procedure = dynamic_cast<Procedure*>(builtin.get());
+        REQUIRE(procedure == (Symbol::GetSignature(name) != nullptr));
+        REQUIRE(Symbol::GetBuiltin(name + "x") == nullptr);
+        REQUIRE(Symbol::GetBuiltin("%" + name) == nullptr);
+    }
+    REQUIRE(Symbol::GetBuiltin("car") != Symbol::GetBuiltin("cdr"));
+    for (const auto& name : {"", "cadr", "Car", "#%car", "lambda*", "x", "stream", "list!"}) {
+        REQUIRE(Symbol::GetBuiltin(name) == nullptr);
+        REQUIRE(Symbol::GetSignature(name) == nullptr);
+    }
+}
@@ -0,0 +1,65 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+#include <string>
+#include <thread>
+
+TEST_CASE("Cached call sites see a global procedure redefined") {
+    Interpreter interpreter;
+    interpreter.Run("(define (f) 1)");
+    interpreter.Run("(define (g) (f))");
+    REQUIRE(interpreter.Run("(g)") == "1");
+    REQUIRE(interpreter.Run("(g)") == "1");
+
+    interpreter.Run("(define (f) 2)");
+    REQUIRE(interpreter.Run("(g)") == "2");
+    interpreter.Run("(set! f (lambda () 3))");
+    REQUIRE(interpreter.Run("(g)") == "3");
+}
+
+TEST_CASE("Cached call sites see a procedure rebound while they run") {
+    Interpreter interpreter;
+    interpreter.Run("(define (f) 1)");
+    interpreter.Run("(define g (lambda () (define a (f)) (set! f (lambda () 10)) (+ a (f))))");
+    REQUIRE(interpreter.Run("(g)") == "11");
+    REQUIRE(interpreter.Run("(g)") == "20");
+
+    interpreter.Run("(define loop (lambda (n acc) (set! f (lambda () n)) "
+                    "(if (= n 0) acc (loop (- n 1) (+ acc (f))))))");
+    REQUIRE(interpreter.Run("(loop 4 0)") == "10");
+}
+
+TEST_CASE("Cached call sites see a local procedure rebound") {
+    Interpreter interpreter;
+    interpreter.Run("(define h (lambda () (define (k) 1) (define first (k)) "
+                    "(set! k (lambda () 2)) (list first (k))))");
+    REQUIRE(interpreter.Run("(h)") == "(1 2)");
+    REQUIRE(interpreter.Run("(h)") == "(1 2)");
+
+    interpreter.Run("(define twice (lambda (f) (define a (f)) (set! f (lambda () 5)) (+ a (f))))");
+    REQUIRE(interpreter.Run("(twice (lambda () 1))") == "6");
+    REQUIRE(interpreter.Run("(twice (lambda () 2))") == "7");
+}
+
+TEST_CASE("Cached call sites see rebinding done on another thread") {
+    Interpreter interpreter;
+    auto run_on_thread = [&interpreter](const std::string& code) {
+        std::string result;
+        std::thread([&] { result = interpreter.Run(code); }).join();
+        return result;
+    };
+    interpreter.Run("(define (f) 1)");
+    interpreter.Run("(define (g) (f))");
+    REQUIRE(interpreter.Run("(g)") == "1");
+    run_on_thread("(define (f) 2)");
+    REQUIRE(interpreter.Run("(g)") == "2");
+    REQUIRE(run_on_thread("(g)") == "2");
+
+    interpreter.Run("(define (count l) (length l))");
+    interpreter.Run("(define (h) (let ((a 3)) (+ a 2)))");
+    REQUIRE(interpreter.Run("(list (count '(1)) (h))") == "(1 5)");
+    run_on_thread("(define (length l) 7)");
+    run_on_thread("(define (+ a b) (* a b))");
+    REQUIRE(interpreter.Run("(list (count '(1)) (h))") == "(7 6)");
+}
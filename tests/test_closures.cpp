@@ -0,0 +1,38 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+TEST_CASE("Named let loops call themselves by their name") {
+    Interpreter interpreter;
+    interpreter.Run("(define (count n) (let lp ((i 0)) (if (< i n) (lp (+ i 1)) i)))");
+    REQUIRE(interpreter.Run("(count 100000)") == "100000");
+    REQUIRE(interpreter.Run("(let lp ((lp 2)) lp)") == "2");
+    REQUIRE(interpreter.Run("((let lp ((i 0)) (if (number? i)"
+                            " (if (< i 3) (lp (+ i 1)) (lambda (j) (lp (list j))))"
+                            " (car i))) 7)") == "7");
+    REQUIRE(interpreter.Run("(let lp ((i 0) (fs '()))"
+                            " (if (< i 2) (lp (+ i 1) (cons (lambda (j) (lp j '())) fs))"
+                            " (if (null? fs) i ((car fs) 5))))") == "5");
+}
+
+TEST_CASE("Named let loops whose name is assigned") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(let lp ((i 0)) (set! lp (lambda (j) (* j 10))) (lp 7))") == "70");
+}
+
+TEST_CASE("Recursive internal defines call themselves by their name") {
+    Interpreter interpreter;
+    interpreter.Run("(define (outer) (define (lp n) (if (= n 0) 'done (lp (- n 1)))) (lp 5))");
+    REQUIRE(interpreter.Run("(outer)") == "done");
+    interpreter.Run("(define (make) (define (lp n) (if (= n 0) 'made (lp (- n 1)))) lp)");
+    REQUIRE(interpreter.Run("((make) 3)") == "made");
+    REQUIRE(interpreter.Run("(letrec ((f (lambda (n) (if (= n 0) 1 (* n (f (- n 1))))))) (f 5))") ==
+            "120");
+}
+
+TEST_CASE("Internal defines that are rebound or assigned") {
+    Interpreter interpreter;
+    interpreter.Run("(define twice (lambda () (define (f n) (if (= n 0) 'first (f 0)))"
+                    " (define g f) (set! f (lambda (n) 'second)) (g 1)))");
+    REQUIRE(interpreter.Run("(twice)") == "second");
+}
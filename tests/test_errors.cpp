@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+static std::string Guarded(const std::string& body) {
+    return "(guard (e (#t (list 'caught e))) " + body + ")";
+}
+
+TEST_CASE("Raises reach the guard through every form") {
+    Interpreter interpreter;
+    interpreter.Run("(define (f x) (define y (raise x)) (car 1))");
+    interpreter.Run("(define (down n) (if (= n 0) (raise 'bottom) (+ 1 (down (- n 1)))))");
+    interpreter.Run("(define z 1)");
+
+    REQUIRE(interpreter.Run(Guarded("(+ 1 (+ 2 (raise 'a)))")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(if (raise 'a) 1 2)")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(and #t (raise 'a) (car 1))")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(cond (#t (raise 'a) (car 1)))")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(let* ((x 1) (y (raise 'a))) (car 1))")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(do ((i 0 (+ i 1))) ((= i 3) 1) (raise 'a))")) ==
+            "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(f 'a)")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(down 1000)")) == "(caught bottom)");
+    REQUIRE(interpreter.Run(Guarded("(set! z (raise 'a))")) == "(caught a)");
+    REQUIRE(interpreter.Run("z") == "1");
+}
+
+TEST_CASE("Raises from procedures called by builtins reach the guard") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run(Guarded("(map (lambda (x) (raise x)) '(a))")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(sort '(2 1) (lambda (a b) (raise 'a)))")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(force (delay (raise 'a)))")) == "(caught a)");
+
+    interpreter.Run("(define m (memoize (lambda (x) (if (= x 0) (raise 'a) x))))");
+    REQUIRE(interpreter.Run(Guarded("(m 0)")) == "(caught a)");
+    REQUIRE(interpreter.Run(Guarded("(m 0)")) == "(caught a)");
+}
+
+TEST_CASE("Raises nobody handles fail the run") {
+    Interpreter interpreter;
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 (raise 'a))"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(map (lambda (x) (raise x)) '(a))"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(guard (e ((string? e) 'no)) (raise 'a))"), RuntimeError);
+    REQUIRE(interpreter.TryRun("(raise 'a)").status == RunResult::Status::kRuntimeError);
+    REQUIRE(interpreter.Run("(guard (e (#t (list 'outer e))) (with-exception-handler"
+                            " (lambda (e) (raise (list 'inner e))) (lambda () (raise 'a))))") ==
+            "(outer (inner a))");
+}
+
+TEST_CASE("Bad division, set-car! and if forms fail with errors") {
+    Interpreter interpreter;
+    REQUIRE_THROWS_AS(interpreter.Run("(/ 1 0)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(/ (- -9223372036854775807 1) -1)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(let ((a 7) (b 0)) (/ a b))"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(set-car! 1 2)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(set-cdr! 1)"), RuntimeError);
+    REQUIRE_THROWS(interpreter.Run("(if #t . 1)"));
+    REQUIRE_THROWS(interpreter.Run("((lambda () (if #t . 1)))"));
+
+    interpreter.Run("(define p (cons 1 2))");
+    interpreter.Run("(set-car! p 3)");
+    REQUIRE(interpreter.Run("p") == "(3 . 2)");
+    REQUIRE(interpreter.Run("(/ 12 3 -1)") == "-4");
+}
+
+TEST_CASE("Unbound variables and builtin errors are raised as error objects") {
+    Interpreter interpreter;
+    auto message = [](const std::string& body) {
+        return "(guard (e ((error-object? e) (error-object-message e))) " + body + ")";
+    };
+    REQUIRE(interpreter.Run(message("(+ 1 nope)")) ==
+            "\"no variable with name: nope in all parent scopes\"");
+    REQUIRE(interpreter.Run(message("(nope 1)")) ==
+            "\"no variable with name: nope in all parent scopes\"");
+    REQUIRE(interpreter.Run(message("(list 1 (car 1))")) == "\"car: unexpected argument type\"");
+    REQUIRE(interpreter.Run(message("(+ 1 (/ 1 0))")) == "\"/: division by zero\"");
+
+    interpreter.Run("(define (probe n found) (if (= n 0) found"
+                    " (probe (- n 1) (+ found (guard (e (#t 0)) (car (list missing)))))))");
+    REQUIRE(interpreter.Run("(probe 10000 0)") == "0");
+    interpreter.Run("(define (down n) (if (= n 0) (car 1) (+ 1 (down (- n 1)))))");
+    REQUIRE(interpreter.Run("(guard (e (#t 'bottom)) (down 1000))") == "bottom");
+    REQUIRE(interpreter.Run("(with-exception-handler (lambda (e) 5)"
+                            " (lambda () (+ 1 (raise-continuable 'a))))") == "6");
+
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 nope)"), NameError);
+    REQUIRE_THROWS_WITH(interpreter.Run("(list (car 1))"), "car: unexpected argument type");
+    REQUIRE(interpreter.TryRun("(down 3)").status == RunResult::Status::kRuntimeError);
+    REQUIRE(interpreter.TryRun("(guard (e ((string? e) 'no)) nope)").status ==
+            RunResult::Status::kNameError);
+}
@@ -0,0 +1,67 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+// Re-running a script, edited or not, has to give what a fresh interpreter gives.
+static void RequireLikeFresh(Interpreter* interpreter, const std::string& script) {
+    Interpreter fresh;
+    auto expected = fresh.RunIncremental(script);
+    REQUIRE(interpreter->RunIncremental(script) == expected);
+}
+
+TEST_CASE("Unchanged script that assigns a cached define") {
+    const std::string script =
+        "(define counter 0)\n"
+        "(define (bump!) (set! counter (+ counter 1)))\n"
+        "(bump!)\n"
+        "counter\n";
+    Interpreter interpreter;
+    for (int i = 0; i < 3; ++i) {
+        RequireLikeFresh(&interpreter, script);
+    }
+}
+
+TEST_CASE("Edited define whose binding is reassigned") {
+    std::string script =
+        "(define items '(1 2 3))\n"
+        "(define (total) (+ (car items) (length items)))\n"
+        "(set! items (cons 0 items))\n"
+        "(total)\n";
+    Interpreter interpreter;
+    RequireLikeFresh(&interpreter, script);
+    RequireLikeFresh(&interpreter, script);
+    script.replace(script.find("'(1 2 3)"), 8, "'(4 5)");
+    RequireLikeFresh(&interpreter, script);
+    RequireLikeFresh(&interpreter, script);
+}
+
+TEST_CASE("Redefined function used by a cached define") {
+    std::string script =
+        "(define (square x) (* x x))\n"
+        "(define nine (square 3))\n"
+        "(display nine)\n"
+        "(define (square x) (+ x x))\n"
+        "(square nine)\n";
+    Interpreter interpreter;
+    RequireLikeFresh(&interpreter, script);
+    RequireLikeFresh(&interpreter, script);
+    script.replace(script.find("(* x x)"), 7, "(* x 10)");
+    RequireLikeFresh(&interpreter, script);
+}
+
+TEST_CASE("Cached defines that used a builtin a global now shadows") {
+    std::string script =
+        "(define g (length '(1 2)))\n"
+        "(define (count l) (length l))\n"
+        "(define h (count '(1 2 3)))\n"
+        "(define s (let ((a 1)) (+ a 2)))\n"
+        "(define (sum n) (if (= n 0) 0 (+ n (sum (- n 1)))))\n"
+        "(define total (sum 2000))\n"
+        "(list g h s total)\n";
+    Interpreter interpreter;
+    RequireLikeFresh(&interpreter, script);
+    RequireLikeFresh(&interpreter, script);
+    script = "(define (length l) 100)\n(define (+ a b) (* a b))\n" + script;
+    RequireLikeFresh(&interpreter, script);
+    RequireLikeFresh(&interpreter, script);
+}
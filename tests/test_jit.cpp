@@ -0,0 +1,72 @@
+#include <catch2/catch.hpp>
+
+#include "jit.h"
+#include "scheme.h"
+
+// Runs every line of the script after calling the function in warm-up enough times to compile it,
+// once with the compiler and once without, and compares the results.
+static void RequireLikeInterpreted(const std::string& define, const std::string& warm_up,
+                                   const std::vector<std::string>& lines) {
+    std::vector<std::string> results[2];
+    for (bool enabled : {false, true}) {
+        JitCode::SetEnabled(enabled);
+        Interpreter interpreter;
+        interpreter.Run(define);
+        for (size_t i = 0; i < JitCode::kThreshold + 1; ++i) {
+            interpreter.Run(warm_up);
+        }
+        for (const auto& line : lines) {
+            auto result = interpreter.TryRun(line);
+            results[enabled].push_back(result.output + result.error);
+        }
+    }
+    JitCode::SetEnabled(true);
+    REQUIRE(results[1] == results[0]);
+}
+
+TEST_CASE("Compiled tail self calls run in constant stack") {
+    RequireLikeInterpreted("(define (spin n) (if (= n 0) 0 (spin (- n 1))))", "(spin 3)",
+                           {"(spin 300000)", "(spin 1000000)"});
+    RequireLikeInterpreted("(define (swap n a b) (if (= n 0) (- a b) (swap (- n 1) b (+ a 1))))",
+                           "(swap 3 0 0)", {"(swap 7 1 100)", "(swap 1000001 1 100)"});
+    RequireLikeInterpreted("(define (count n) (let lp ((i 0) (k n))"
+                           " (if (= k 0) i (lp (+ i 1) (- k 1)))))",
+                           "(count 3)", {"(count 300000)"});
+}
+
+TEST_CASE("Compiled calls deeper than the stack budget are interpreted") {
+    RequireLikeInterpreted("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))",
+                           "(fib 3)", {"(fib 20)"});
+    RequireLikeInterpreted("(define (sum n a b c d e f g)"
+                           " (if (= n 0) (+ a b c d e f g) (+ 1 (sum (- n 1) a b c d e f g))))",
+                           "(sum 3 1 1 1 1 1 1 1)",
+                           {"(sum 4000 1 1 1 1 1 1 1)", "(sum 9000 1 1 1 1 1 1 1)",
+                            "(sum 10 1 1 1 1 1 1 1)"});
+}
+
+TEST_CASE("Parameters named like operators are not compiled as operators") {
+    RequireLikeInterpreted("(define (f + n) (if (= n 0) 0 (+ n 1)))", "(f 1 0)",
+                           {"(f 1 5)", "(f 1 0)"});
+    RequireLikeInterpreted("(define (g = n) (if (< n 1) 0 (if (= n 1) 5 7)))", "(g 1 0)",
+                           {"(g 1 1)", "(g 1 0)"});
+    RequireLikeInterpreted("(define (h max n) (if (= n 0) max (h (- max 1) (- n 1))))",
+                           "(h 1 2)", {"(h 10 3)"});
+}
+
+TEST_CASE("Compiled calls stop short of the end of the stack") {
+    Interpreter interpreter;
+    interpreter.Run("(define (sum n) (if (= n 0) 0 (+ 1 (sum (- n 1)))))");
+    interpreter.Run("(define (deep n k) (if (= n 0) (sum k) (car (list (deep (- n 1) k)))))");
+    for (size_t i = 0; i < JitCode::kThreshold + 1; ++i) {
+        interpreter.Run("(sum 3)");
+    }
+    for (int depth : {1000, 4000, 7400, 9000, 12000}) {
+        auto result = interpreter.TryRun("(deep " + std::to_string(depth) + " 12000)");
+        INFO(depth << " " << result.error);
+        if (result.status == RunResult::Status::kOk) {
+            REQUIRE(result.output == "12000");
+        } else {
+            REQUIRE(result.error == "recursion is too deep");
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+TEST_CASE("let binds its values in the enclosing scope") {
+    Interpreter interpreter;
+    interpreter.Run("(define x 1)");
+    REQUIRE(interpreter.Run("(let ((x 2) (y x)) (list x y))") == "(2 1)");
+    REQUIRE(interpreter.Run("(let ((x 5)) (set! x (+ x 1)) x)") == "6");
+    REQUIRE(interpreter.Run("x") == "1");
+    REQUIRE(interpreter.Run("(let () 7)") == "7");
+    REQUIRE(interpreter.Run("((let ((n 3)) (lambda (m) (+ n m))) 4)") == "7");
+}
+
+TEST_CASE("let* binds its values one after another") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(let* ((x 1) (y (+ x 1)) (z (* y 10))) (list x y z))") ==
+            "(1 2 20)");
+    REQUIRE(interpreter.Run("(let* ((x 1) (x (+ x 1))) x)") == "2");
+    REQUIRE(interpreter.Run("(let* () 3)") == "3");
+}
+
+TEST_CASE("letrec binds mutually recursive procedures") {
+    Interpreter interpreter;
+    interpreter.Run("(define (parity n) (letrec ((even? (lambda (n) (if (= n 0) #t (odd? (- n 1)))))"
+                    " (odd? (lambda (n) (if (= n 0) #f (even? (- n 1))))))"
+                    " (if (even? n) 'even 'odd)))");
+    REQUIRE(interpreter.Run("(parity 10)") == "even");
+    REQUIRE(interpreter.Run("(parity 1001)") == "odd");
+    REQUIRE(interpreter.Run("(letrec ((f (lambda () g)) (g 5)) (f))") == "5");
+}
+
+TEST_CASE("do steps its variables until the test holds") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(do ((i 0 (+ i 1)) (acc '() (cons i acc))) ((= i 3) acc))") ==
+            "(2 1 0)");
+    REQUIRE(interpreter.Run("(do ((i 0 (+ i 1)) (sum 0)) ((= i 5) sum) (set! sum (+ sum i)))") ==
+            "10");
+    REQUIRE(interpreter.Run("(do ((l '(1 2 3))) ((null? l) 'done) (set! l (cdr l)))") == "done");
+    REQUIRE(interpreter.Run("(do ((i 0 (+ i 1))) ((= i 100000) i))") == "100000");
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+TEST_CASE("Ellipsis patterns match any number of items") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax my-list (syntax-rules () ((_ x ...) (list x ...))))");
+    REQUIRE(interpreter.Run("(my-list)") == "()");
+    REQUIRE(interpreter.Run("(my-list 1 (+ 1 1) 3)") == "(1 2 3)");
+
+    interpreter.Run("(define-syntax last (syntax-rules () ((_ a ... z) 'z)))");
+    REQUIRE(interpreter.Run("(last 1 2 3)") == "3");
+    REQUIRE(interpreter.Run("(last 1)") == "1");
+
+    interpreter.Run("(define-syntax split (syntax-rules () ((_ a . rest) '(a rest))))");
+    REQUIRE(interpreter.Run("(split 1 2 3)") == "(1 (2 3))");
+
+    interpreter.Run("(define-syntax my-let* (syntax-rules ()"
+                    " ((_ () body ...) (let () body ...))"
+                    " ((_ ((n v) rest ...) body ...)"
+                    "  (let ((n v)) (my-let* (rest ...) body ...)))))");
+    REQUIRE(interpreter.Run("(my-let* ((a 1) (b (+ a 1))) (* a b))") == "2");
+}
+
+TEST_CASE("Nested patterns bind inside sublists") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax nested (syntax-rules () ((_ ((a b) c)) (list a b c))))");
+    REQUIRE(interpreter.Run("(nested ((1 2) 3))") == "(1 2 3)");
+
+    interpreter.Run(
+        "(define-syntax pairs (syntax-rules () ((_ (a b) ...) (list (cons a b) ...))))");
+    REQUIRE(interpreter.Run("(pairs (1 2) (3 4))") == "((1 . 2) (3 . 4))");
+
+    interpreter.Run("(define-syntax rests (syntax-rules () ((_ (a b ...) ...) '((b ...) ...))))");
+    REQUIRE(interpreter.Run("(rests (1 2 3) (4) (5 6))") == "((2 3) () (6))");
+}
+
+TEST_CASE("Long ellipsis sequences expand item by item") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax sum-pairs (syntax-rules ()"
+                    " ((_ (a b) ...) (+ (* a b) ...))))");
+    std::string call = "(sum-pairs";
+    for (int i = 1; i <= 20000; ++i) {
+        call += " (" + std::to_string(i) + " 2)";
+    }
+    REQUIRE(interpreter.Run(call + ")") == "400020000");
+    REQUIRE(interpreter.Run("(sum-pairs (1 2) (3 4))") == "14");
+}
+
+TEST_CASE("Literals match only themselves") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax arrow (syntax-rules (=>)"
+                    " ((_ a => b) (list 'arrow a b)) ((_ a b c) (list 'plain a b c))))");
+    REQUIRE(interpreter.Run("(arrow 1 => 2)") == "(arrow 1 2)");
+    REQUIRE(interpreter.Run("(arrow 1 2 3)") == "(plain 1 2 3)");
+    REQUIRE(interpreter.Run("(arrow 1 'x 3)") == "(plain 1 x 3)");
+    REQUIRE_THROWS_AS(interpreter.Run("(arrow 1 2)"), SyntaxError);
+}
+
+TEST_CASE("Bindings a macro introduces do not capture the caller's variables") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax my-or (syntax-rules () ((_) #f) ((_ e) e)"
+                    " ((_ e r ...) (let ((t e)) (if t t (my-or r ...))))))");
+    interpreter.Run("(define t 5)");
+    REQUIRE(interpreter.Run("(my-or #f t)") == "5");
+    REQUIRE(interpreter.Run("(let ((t 7)) (my-or #f t))") == "7");
+
+    interpreter.Run("(define-syntax swap! (syntax-rules ()"
+                    " ((_ a b) (let ((tmp a)) (set! a b) (set! b tmp)))))");
+    interpreter.Run("(define tmp 1)");
+    interpreter.Run("(define other 2)");
+    interpreter.Run("(swap! tmp other)");
+    REQUIRE(interpreter.Run("(list tmp other)") == "(2 1)");
+
+    interpreter.Run("(define-syntax add-ten (syntax-rules () ((_ e) (let ((x 10)) (+ x e)))))");
+    interpreter.Run("(define x 1)");
+    REQUIRE(interpreter.Run("(add-ten x)") == "11");
+}
+
+TEST_CASE("Local bindings hide macros of the same name") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax ten (syntax-rules () ((_) 10)))");
+    interpreter.Run("(define (f ten) (ten))");
+    REQUIRE(interpreter.Run("(f (lambda () 3))") == "3");
+    REQUIRE(interpreter.Run("(let ((ten (lambda () 4))) (ten))") == "4");
+    REQUIRE(interpreter.Run("(do ((ten (lambda () 5))) (#t (ten)))") == "5");
+    REQUIRE(interpreter.Run("(let () (define (ten) 6) (ten))") == "6");
+    REQUIRE(interpreter.Run("(ten)") == "10");
+}
+
+TEST_CASE("Free template identifiers refer to the bindings at the definition") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax kons (syntax-rules () ((_ a b) (cons a b))))");
+    REQUIRE(interpreter.Run("(let ((cons list)) (kons 1 2))") == "(1 . 2)");
+    interpreter.Run("(define (g cons) (kons cons 2))");
+    REQUIRE(interpreter.Run("(g 1)") == "(1 . 2)");
+
+    interpreter.Run("(define (double x) (* x 2))");
+    interpreter.Run("(define-syntax twice (syntax-rules () ((_ e) (double e))))");
+    REQUIRE(interpreter.Run("(let ((double 0)) (twice 3))") == "6");
+
+    interpreter.Run("(define counter 0)");
+    interpreter.Run("(define-syntax bump! (syntax-rules () ((_) (set! counter (+ counter 1)))))");
+    REQUIRE(interpreter.Run("(let ((counter 100)) (bump!) counter)") == "100");
+    REQUIRE(interpreter.Run("counter") == "1");
+    REQUIRE(interpreter.Run("'(kons x y)") == "(kons x y)");
+}
+
+TEST_CASE("Malformed templates fail with a syntax error") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax bad (syntax-rules () ((_ x) (list x ...))))");
+    REQUIRE_THROWS_AS(interpreter.Run("(bad 1)"), SyntaxError);
+
+    interpreter.Run("(define-syntax zip (syntax-rules () ((_ (a ...) (b ...)) '((a b) ...))))");
+    REQUIRE(interpreter.Run("(zip (1 2) (3 4))") == "((1 3) (2 4))");
+    REQUIRE_THROWS_AS(interpreter.Run("(zip (1 2) (3))"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("(define-syntax 1 (syntax-rules ()))"), SyntaxError);
+}
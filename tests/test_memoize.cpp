@@ -0,0 +1,66 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+static void DefineCounted(Interpreter& interpreter) {
+    interpreter.Run("(define calls 0)");
+    interpreter.Run("(define (square x) (set! calls (+ calls 1)) (* x x))");
+}
+
+TEST_CASE("Memoize counts hits, misses and evictions") {
+    Interpreter interpreter;
+    DefineCounted(interpreter);
+    interpreter.Run("(define m (memoize square 2))");
+    for (const auto& [arg, result] : {std::pair{"1", "1"}, {"2", "4"}, {"1", "1"}, {"3", "9"},
+                                      {"2", "4"}, {"1", "1"}}) {
+        REQUIRE(interpreter.Run(std::string("(m ") + arg + ")") == result);
+    }
+    REQUIRE(interpreter.Run("(memoize-stats m)") == "(1 5 3 2)");
+    REQUIRE(interpreter.Run("calls") == "5");
+
+    interpreter.Run("(define unbounded (memoize length))");
+    interpreter.Run("(unbounded '(1 2))");
+    REQUIRE(interpreter.Run("(unbounded (list 1 2))") == "2");
+    interpreter.Run("(unbounded '(2 1))");
+    REQUIRE(interpreter.Run("(memoize-stats unbounded)") == "(1 2 0 2)");
+}
+
+TEST_CASE("A bound of 1 keeps only the last result") {
+    Interpreter interpreter;
+    DefineCounted(interpreter);
+    interpreter.Run("(define m (memoize square 1))");
+    interpreter.Run("(m 1)");
+    interpreter.Run("(m 1)");
+    REQUIRE(interpreter.Run("(memoize-stats m)") == "(1 1 0 1)");
+    interpreter.Run("(m 2)");
+    REQUIRE(interpreter.Run("(m 1)") == "1");
+    REQUIRE(interpreter.Run("(memoize-stats m)") == "(1 3 2 1)");
+    REQUIRE(interpreter.Run("(m 1)") == "1");
+    REQUIRE(interpreter.Run("calls") == "3");
+}
+
+TEST_CASE("Raising calls are not cached") {
+    Interpreter interpreter;
+    DefineCounted(interpreter);
+    interpreter.Run("(define m (memoize (lambda (x) (if (= x 0) (raise 'zero) (square x)))))");
+    for (int i = 0; i < 2; ++i) {
+        REQUIRE(interpreter.Run("(guard (e (#t (list 'caught e))) (m 0))") == "(caught zero)");
+    }
+    REQUIRE(interpreter.Run("(memoize-stats m)") == "(0 2 0 0)");
+    interpreter.Run("(m 3)");
+    interpreter.Run("(m 3)");
+    REQUIRE(interpreter.Run("(memoize-stats m)") == "(1 3 0 1)");
+    REQUIRE(interpreter.Run("calls") == "1");
+
+    interpreter.Run("(define failing (memoize (lambda (x) (car x))))");
+    REQUIRE_THROWS_AS(interpreter.Run("(failing 1)"), RuntimeError);
+    REQUIRE(interpreter.Run("(memoize-stats failing)") == "(0 1 0 0)");
+}
+
+TEST_CASE("Memoize checks its arguments") {
+    Interpreter interpreter;
+    DefineCounted(interpreter);
+    REQUIRE_THROWS_AS(interpreter.Run("(memoize square -1)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(memoize 1)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(memoize-stats square)"), RuntimeError);
+}
@@ -0,0 +1,67 @@
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+
+#include "scheme.h"
+
+TEST_CASE("Registered functions convert their arguments and results") {
+    Interpreter interpreter;
+    interpreter.Register("add3", [](int64_t a, int64_t b, int64_t c) { return a + b + c; });
+    interpreter.Register("negate", [](bool value) { return !value; });
+    interpreter.Register("shout", [](std::string_view text) { return std::string(text) + "!"; });
+    interpreter.Register("first", [](std::shared_ptr<Cell> cell) { return cell->GetFirst(); });
+    interpreter.Register("same", [](std::shared_ptr<Object> obj) { return obj; });
+
+    REQUIRE(interpreter.Run("(add3 1 2 3)") == "6");
+    REQUIRE(interpreter.Run("(negate #f)") == "#t");
+    REQUIRE(interpreter.Run("(shout \"hi\")") == "\"hi!\"");
+    REQUIRE(interpreter.Run("(first '(a b))") == "a");
+    REQUIRE(interpreter.Run("(same '(1 . 2))") == "(1 . 2)");
+    REQUIRE(interpreter.Run("(map (lambda (x) (add3 x x x)) '(1 2))") == "(3 6)");
+}
+
+TEST_CASE("Calls with the wrong number of arguments fail") {
+    Interpreter interpreter;
+    interpreter.Register("add3", [](int64_t a, int64_t b, int64_t c) { return a + b + c; });
+    REQUIRE_THROWS_AS(interpreter.Run("(add3 1 2)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(add3 1 2 3 4)"), RuntimeError);
+}
+
+TEST_CASE("Arguments of the wrong type fail") {
+    Interpreter interpreter;
+    interpreter.Register("inc", [](int64_t a) { return a + 1; });
+    interpreter.Register("negate", [](bool value) { return !value; });
+    interpreter.Register("size", [](std::string text) { return text.size(); });
+    interpreter.Register("first", [](std::shared_ptr<Cell> cell) { return cell->GetFirst(); });
+    REQUIRE_THROWS_AS(interpreter.Run("(inc \"1\")"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(negate 0)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(size 'a)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(first 1)"), RuntimeError);
+    REQUIRE(interpreter.Run("(size \"abc\")") == "3");
+}
+
+TEST_CASE("Numbers that do not fit the parameter or the result fail") {
+    Interpreter interpreter;
+    interpreter.Register("byte", [](uint8_t value) { return value; });
+    interpreter.Register("half", [](int32_t value) { return value / 2; });
+    interpreter.Register("huge", []() { return UINT64_MAX; });
+    REQUIRE(interpreter.Run("(byte 255)") == "255");
+    REQUIRE_THROWS_AS(interpreter.Run("(byte 256)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(byte -1)"), RuntimeError);
+    REQUIRE(interpreter.Run("(half -2147483648)") == "-1073741824");
+    REQUIRE_THROWS_AS(interpreter.Run("(half 2147483648)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(huge)"), RuntimeError);
+}
+
+TEST_CASE("Registered functions shadow builtin procedures but not syntax keywords") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(define (first xs) (car xs))") == "()");
+    REQUIRE(interpreter.Run("(first '(1 2))") == "1");
+    interpreter.Register("car", [](int64_t a) { return a * 10; });
+    REQUIRE(interpreter.Run("(car 4)") == "40");
+    REQUIRE(interpreter.Run("(first 4)") == "40");
+    REQUIRE(interpreter.Run("(map car '(1 2))") == "(10 20)");
+    REQUIRE_THROWS_AS(interpreter.Register("if", [](int64_t a) { return a; }), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Register("lambda", [](int64_t a) { return a; }), RuntimeError);
+    REQUIRE(interpreter.Run("(if #t 1 2)") == "1");
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+
+#include "jit.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "scheme.h"
+
+// The form as the optimizer leaves it, printed.
+static std::string Optimized(const std::string& code, OptimizerStats* stats) {
+    Scope root;
+    Tokenizer tokenizer(code);
+    return Optimizer(root, stats).Optimize(Read(&tokenizer))->Stringify();
+}
+
+TEST_CASE("Calls of pure builtins with literal arguments are folded") {
+    OptimizerStats stats;
+    REQUIRE(Optimized("(+ 1 (* 2 3))", &stats) == "7");
+    REQUIRE(stats.folded_calls == 2);
+    REQUIRE(Optimized("(define (f x) (+ x (* 2 3)))", &stats) == "(define (f x) (+ x 6))");
+    REQUIRE(stats.folded_calls == 3);
+    REQUIRE(Optimized("(list 1 2)", &stats) == "(list 1 2)");
+    REQUIRE(stats.folded_calls == 3);
+}
+
+TEST_CASE("Branches of if with a literal test are pruned") {
+    OptimizerStats stats;
+    REQUIRE(Optimized("(if #t a b)", &stats) == "a");
+    REQUIRE(Optimized("(if #f a b)", &stats) == "b");
+    REQUIRE(Optimized("(if (< 1 2) (f 1) (g 2))", &stats) == "(f 1)");
+    REQUIRE(stats.pruned_branches == 3);
+    REQUIRE(Optimized("(if x a b)", &stats) == "(if x a b)");
+    REQUIRE(stats.pruned_branches == 3);
+}
+
+TEST_CASE("Malformed if forms from macros are not pruned") {
+    Interpreter interpreter;
+    interpreter.Run("(define-syntax m (syntax-rules () ((_ x ...) (if x ...))))");
+    REQUIRE_THROWS_AS(interpreter.Run("(m #t)"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("(m #f 1 2 3)"), SyntaxError);
+    REQUIRE(interpreter.GetOptimizerStats().pruned_branches == 0);
+    REQUIRE(interpreter.Run("(m #f 1 2)") == "2");
+    REQUIRE(interpreter.GetOptimizerStats().pruned_branches == 1);
+}
+
+TEST_CASE("Literal lambdas called with literals are inlined") {
+    OptimizerStats stats;
+    REQUIRE(Optimized("((lambda (x) (* x x)) 5)", &stats) == "25");
+    REQUIRE(stats.inlined_lambdas == 1);
+    REQUIRE(Optimized("((lambda (x) (* x x)) y)", &stats) == "((lambda (x) (* x x)) y)");
+    REQUIRE(stats.inlined_lambdas == 1);
+}
+
+TEST_CASE("Shadowed builtins are not folded") {
+    OptimizerStats stats;
+    REQUIRE(Optimized("(define (g +) (+ 1 2))", &stats) == "(define (g +) (+ 1 2))");
+    REQUIRE(Optimized("(let ((* -)) (* 5 2))", &stats) == "(let ((* -)) (* 5 2))");
+    REQUIRE(stats.folded_calls == 0);
+
+    Interpreter interpreter;
+    interpreter.Run("(define (g +) (+ 1 2))");
+    REQUIRE(interpreter.Run("(g -)") == "-1");
+    REQUIRE(interpreter.GetOptimizerStats().folded_calls == 0);
+}
+
+TEST_CASE("Calls that fail are left for run time") {
+    Interpreter interpreter;
+    interpreter.Run("(define (f) (/ 1 0))");
+    interpreter.Run("(define (g) (/ (- -9223372036854775807 1) -1))");
+    REQUIRE(interpreter.GetOptimizerStats().folded_calls == 1);
+    REQUIRE_THROWS_AS(interpreter.Run("(f)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(g)"), RuntimeError);
+
+    interpreter.Run("(define (h) (/ 12 3 -1))");
+    REQUIRE(interpreter.GetOptimizerStats().folded_calls == 2);
+    REQUIRE(interpreter.Run("(h)") == "-4");
+}
+
+TEST_CASE("Builtins folded in bodies follow later shadowing") {
+    Interpreter interpreter;
+    interpreter.Run("(define (f) (* 2 3))");
+    interpreter.Run("(define (g) (+ 1 (* 2 3)))");
+    interpreter.Run("(define p (delay (* 2 3)))");
+    interpreter.Run("(define (h n) (if (= n 0) (* 2 3) (h (- n 1))))");
+    for (size_t i = 0; i < JitCode::kThreshold + 1; ++i) {
+        REQUIRE(interpreter.Run("(h 2)") == "6");
+    }
+    REQUIRE(interpreter.Run("(list (f) (g))") == "(6 7)");
+    REQUIRE(interpreter.GetOptimizerStats().folded_calls == 5);
+
+    interpreter.Run("(define (* a b) (+ a b))");
+    REQUIRE(interpreter.Run("(list (f) (g) (force p) (h 2))") == "(5 6 5 5)");
+    interpreter.Run("(set! * -)");
+    REQUIRE(interpreter.Run("(list (f) (g))") == "(-1 0)");
+}
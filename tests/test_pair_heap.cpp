@@ -0,0 +1,56 @@
+#include <catch2/catch.hpp>
+
+#include <thread>
+
+#include "scheme.h"
+
+static std::shared_ptr<Object> Range(int64_t size) {
+    std::shared_ptr<Object> list;
+    for (int64_t i = size; i > 0; --i) {
+        list = Cell::Make(std::make_shared<Number>(i), std::move(list));
+    }
+    return list;
+}
+
+static int64_t Sum(const std::shared_ptr<Object>& list) {
+    int64_t sum = 0;
+    for (auto cell = As<Cell>(list); cell; cell = As<Cell>(cell->GetSecond())) {
+        sum += As<Number>(cell->GetFirst())->GetValue();
+    }
+    return sum;
+}
+
+TEST_CASE("Freed pair blocks are reused by the next pair") {
+    using Heap = PairHeap<64>;
+    void* first = Heap::Allocate();
+    void* second = Heap::Allocate();
+    REQUIRE(first != second);
+    Heap::Deallocate(first);
+    REQUIRE(Heap::Allocate() == first);
+    Heap::Deallocate(second);
+    Heap::Deallocate(first);
+
+    auto cell = Cell::Make(nullptr, nullptr);
+    Cell* freed = cell.get();
+    cell.reset();
+    REQUIRE(Cell::Make(nullptr, nullptr).get() == freed);
+}
+
+TEST_CASE("Lists survive being released on another thread") {
+    const int64_t size = 100000;
+    auto list = Range(size);
+    std::shared_ptr<Object> rebuilt;
+    int64_t sum = 0;
+    std::thread([&list, &rebuilt, &sum] {
+        sum = Sum(list);
+        list.reset();
+        rebuilt = Range(size);
+    }).join();
+    REQUIRE(sum == size * (size + 1) / 2);
+    REQUIRE(Sum(rebuilt) == size * (size + 1) / 2);
+
+    auto again = Range(size);
+    rebuilt.reset();
+    REQUIRE(Sum(again) == size * (size + 1) / 2);
+    REQUIRE(Sum(Range(size)) == size * (size + 1) / 2);
+}
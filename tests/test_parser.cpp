@@ -0,0 +1,131 @@
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+#include "parser.h"
+#include "printer.h"
+#include "scheme.h"
+
+static std::string Nested(size_t depth, const std::string& inner) {
+    return std::string(depth, '(') + inner + std::string(depth, ')');
+}
+
+TEST_CASE("Deeply nested data is read without recursion") {
+    for (bool hash_consing : {false, true}) {
+        Interpreter interpreter;
+        interpreter.SetHashConsing(hash_consing);
+        REQUIRE(interpreter.Run("(car '" + Nested(100000, "1") + ")") == Nested(99999, "1"));
+        REQUIRE(interpreter.Run("(length '" + Nested(100000, "") + ")") == "1");
+    }
+
+    PushParser parser;
+    auto text = "'" + Nested(100000, "a . b") + " 7";
+    for (size_t i = 0; i < text.size(); i += 4096) {
+        parser.Feed(std::string_view(text).substr(i, 4096));
+    }
+    parser.Finish();
+    REQUIRE(parser.HasDatum());
+    parser.PopDatum();
+    std::ostringstream out;
+    Print(parser.PopDatum(), out);
+    REQUIRE(out.str() == "7");
+}
+
+TEST_CASE("Malformed data fails with a syntax error") {
+    Interpreter interpreter;
+    for (const auto& text : {"'", "(1 2", "')", ")", "(1 . 2 . 3)", "(. 1)", "(if)"}) {
+        REQUIRE_THROWS_AS(interpreter.Run(text), SyntaxError);
+    }
+    REQUIRE_THROWS_AS(interpreter.Run("'" + Nested(100000, "1") + ")"), SyntaxError);
+    REQUIRE(interpreter.Run("'(1 . 2)") == "(1 . 2)");
+}
+
+TEST_CASE("Chunks may split tokens anywhere") {
+    std::string text = "(define (f x) (+ x -12)) #t #f \"a \\\"b\\\" c\" ... (1 . 2) '(s) +";
+    std::ostringstream whole;
+    {
+        PushParser parser;
+        parser.Feed(text);
+        parser.Finish();
+        while (parser.HasDatum()) {
+            Print(parser.PopDatum(), whole);
+            whole << ' ';
+        }
+    }
+    REQUIRE(whole.str() ==
+            "(define (f x) (+ x -12)) #t #f \"a \\\"b\\\" c\" ... (1 . 2) (quote (s)) + ");
+
+    for (size_t split = 0; split <= text.size(); ++split) {
+        PushParser parser;
+        parser.Feed(std::string_view(text).substr(0, split));
+        parser.Feed(std::string_view(text).substr(split));
+        parser.Finish();
+        std::ostringstream out;
+        while (parser.HasDatum()) {
+            Print(parser.PopDatum(), out);
+            out << ' ';
+        }
+        REQUIRE(out.str() == whole.str());
+    }
+
+    PushParser parser;
+    parser.Feed("\"abc");
+    REQUIRE_THROWS_AS(parser.Finish(), SyntaxError);
+}
+
+// The datum quoted by the form read from the text.
+static std::shared_ptr<Object> ReadQuoted(const std::string& text, HashConsTable* table) {
+    Tokenizer tokenizer(text);
+    auto form = As<Cell>(Read(&tokenizer, table));
+    return As<Cell>(form->GetSecond())->GetFirst();
+}
+
+TEST_CASE("Hash-consing shares equal quoted subtrees") {
+    HashConsTable table;
+    auto first = As<Cell>(ReadQuoted("'(x (b c) \"s\")", &table));
+    auto second = As<Cell>(ReadQuoted("'(y (b c) \"s\")", &table));
+    auto first_rest = As<Cell>(first->GetSecond());
+    auto second_rest = As<Cell>(second->GetSecond());
+    REQUIRE(first_rest->GetFirst() == second_rest->GetFirst());
+    REQUIRE(first_rest->GetSecond() == second_rest->GetSecond());
+    REQUIRE(first->GetFirst() != second->GetFirst());
+    REQUIRE(table.GetHits() > 0);
+
+    Tokenizer plain("'(b c) '(b c)");
+    auto lhs = Read(&plain);
+    auto rhs = Read(&plain);
+    REQUIRE(rhs->Stringify() == "(quote (b c))");
+    REQUIRE(As<Cell>(lhs)->GetSecond() != As<Cell>(rhs)->GetSecond());
+
+    Interpreter interpreter;
+    interpreter.SetHashConsing(true);
+    interpreter.Run("(define a '(1 (2 3) (4 . 5)))");
+    interpreter.Run("(define b '(0 (2 3) (4 . 5)))");
+    REQUIRE(interpreter.Run("(equal? (cdr a) (cdr b))") == "#t");
+    REQUIRE(interpreter.Run("(equal? a b)") == "#f");
+    interpreter.Run("(set-car! a 0)");
+    REQUIRE(interpreter.Run("(equal? a b)") == "#t");
+    REQUIRE(interpreter.Run("b") == "(0 (2 3) (4 . 5))");
+}
+
+TEST_CASE("Code read into an arena outlives the parse") {
+    std::shared_ptr<Object> body;
+    {
+        ParseArena arena;
+        Tokenizer tokenizer("(lambda (x) (+ x (* 2 3)))");
+        auto form = As<Cell>(Read(&tokenizer, nullptr, &arena));
+        body = As<Cell>(As<Cell>(form->GetSecond())->GetSecond())->GetFirst();
+    }
+    REQUIRE(body->Stringify() == "(+ x (* 2 3))");
+
+    Interpreter interpreter;
+    interpreter.Run("(define (make-adder n) (lambda (x) (+ x n)))");
+    interpreter.Run("(define add5 (make-adder 5))");
+    interpreter.Run("(define data '(a (b c)))");
+    for (int i = 0; i < 100; ++i) {
+        interpreter.Run("(define other (make-adder " + std::to_string(i) + "))");
+    }
+    REQUIRE(interpreter.Run("(add5 1)") == "6");
+    REQUIRE(interpreter.Run("((make-adder 2) 3)") == "5");
+    REQUIRE(interpreter.Run("data") == "(a (b c))");
+}
@@ -0,0 +1,119 @@
+#include <catch2/catch.hpp>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "scheme.h"
+
+// A file with the given contents that is removed at the end of the test.
+class TempFile {
+public:
+    explicit TempFile(const std::string& contents)
+        : path_("/tmp/scheme_ports_" + std::to_string(getpid()) + "_" +
+                std::to_string(k_count++)) {
+        std::ofstream(path_, std::ios::binary) << contents;
+    }
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    ~TempFile() {
+        std::remove(path_.c_str());
+    }
+
+    const std::string& GetPath() const {
+        return path_;
+    }
+
+private:
+    inline static size_t k_count = 0;
+
+    std::string path_;
+};
+
+static std::string Open(Interpreter* interpreter, const TempFile& file) {
+    return interpreter->Run("(define p (open-input-file \"" + file.GetPath() + "\"))");
+}
+
+TEST_CASE("Lines are read up to the end of the file") {
+    TempFile file("first\n\nlast");
+    Interpreter interpreter;
+    Open(&interpreter, file);
+    REQUIRE(interpreter.Run("(read-line p)") == "\"first\"");
+    REQUIRE(interpreter.Run("(read-line p)") == "\"\"");
+    REQUIRE(interpreter.Run("(read-line p)") == "\"last\"");
+    REQUIRE(interpreter.Run("(eof-object? (read-line p))") == "#t");
+    REQUIRE(interpreter.Run("(eof-object? (read-line p))") == "#t");
+}
+
+TEST_CASE("Characters are peeked and read one at a time") {
+    TempFile file("ab");
+    Interpreter interpreter;
+    Open(&interpreter, file);
+    REQUIRE(interpreter.Run("(peek-char p)") == "\"a\"");
+    REQUIRE(interpreter.Run("(read-char p)") == "\"a\"");
+    REQUIRE(interpreter.Run("(peek-char p)") == "\"b\"");
+    REQUIRE(interpreter.Run("(read-char p)") == "\"b\"");
+    REQUIRE(interpreter.Run("(eof-object? (peek-char p))") == "#t");
+    REQUIRE(interpreter.Run("(eof-object? (read-char p))") == "#t");
+    REQUIRE(interpreter.Run("(eof-object? (read p))") == "#t");
+}
+
+TEST_CASE("Data are read one at a time, across lines") {
+    TempFile file("(1 2) foo \"s\"\n(a\n (b\n  c))\n  '(x . y)\n");
+    Interpreter interpreter;
+    Open(&interpreter, file);
+    REQUIRE(interpreter.Run("(read p)") == "(1 2)");
+    REQUIRE(interpreter.Run("(read p)") == "foo");
+    REQUIRE(interpreter.Run("(read p)") == "\"s\"");
+    REQUIRE(interpreter.Run("(read p)") == "(a (b c))");
+    REQUIRE(interpreter.Run("(read p)") == "(quote (x . y))");
+    REQUIRE(interpreter.Run("(eof-object? (read p))") == "#t");
+
+    TempFile mixed("(1\n2) rest\n");
+    Open(&interpreter, mixed);
+    REQUIRE(interpreter.Run("(read p)") == "(1 2)");
+    REQUIRE(interpreter.Run("(read-char p)") == "\" \"");
+    REQUIRE(interpreter.Run("(read-line p)") == "\"rest\"");
+}
+
+TEST_CASE("A datum is read whatever the lines after it hold") {
+    TempFile file("(aaaaaaaa\nb)\nx: y\n");
+    Interpreter interpreter;
+    Open(&interpreter, file);
+    REQUIRE(interpreter.Run("(read p)") == "(aaaaaaaa b)");
+    REQUIRE(interpreter.Run("(read p)") == "x");
+    REQUIRE_THROWS_AS(interpreter.Run("(read p)"), SyntaxError);
+
+    TempFile unfinished("(1 2\n");
+    Open(&interpreter, unfinished);
+    REQUIRE_THROWS_AS(interpreter.Run("(read p)"), SyntaxError);
+}
+
+TEST_CASE("A syntax error fails the read where it is") {
+    std::string lines;
+    for (int i = 0; i < 100000; ++i) {
+        lines += " " + std::to_string(i) + "\n";
+    }
+    TempFile file("(1 ]\n" + lines + ")\n");
+    Interpreter interpreter;
+    Open(&interpreter, file);
+    REQUIRE_THROWS_WITH(interpreter.Run("(read p)"), Catch::Contains("]"));
+
+    TempFile unfinished("(1\n" + lines);
+    Open(&interpreter, unfinished);
+    REQUIRE_THROWS_WITH(interpreter.Run("(read p)"), "in ReadList: expected )");
+}
+
+TEST_CASE("Closed ports can not be read") {
+    TempFile file("1 2");
+    Interpreter interpreter;
+    Open(&interpreter, file);
+    REQUIRE(interpreter.Run("(read p)") == "1");
+    interpreter.Run("(close-port p)");
+    for (const auto& code : {"(read p)", "(read-line p)", "(read-char p)", "(peek-char p)"}) {
+        REQUIRE_THROWS_AS(interpreter.Run(code), RuntimeError);
+    }
+    REQUIRE_THROWS_AS(interpreter.Run("(open-input-file \"/nonexistent/file\")"), RuntimeError);
+}
@@ -0,0 +1,41 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+#include "scheme.h"
+
+static std::string RunToString(Interpreter* interpreter, const std::string& code) {
+    std::ostringstream out;
+    interpreter->RunTo(code, out);
+    return out.str();
+}
+
+TEST_CASE("Long lists are printed whole") {
+    Interpreter interpreter;
+    interpreter.Run("(define (range n)"
+                    " (let lp ((i n) (l '())) (if (= i 0) l (lp (- i 1) (cons i l)))))");
+    auto text = RunToString(&interpreter, "(range 1000000)");
+    REQUIRE(text.rfind("(1 2 3 ", 0) == 0);
+    const std::string end = " 999999 1000000)";
+    REQUIRE(text.size() > end.size());
+    REQUIRE(text.substr(text.size() - end.size()) == end);
+    REQUIRE(std::count(text.begin(), text.end(), ' ') == 999999);
+}
+
+TEST_CASE("Deeply nested lists are printed without recursion") {
+    Interpreter interpreter;
+    interpreter.Run("(define (nest n)"
+                    " (let lp ((i 0) (x '())) (if (= i n) x (lp (+ i 1) (list x)))))");
+    const size_t depth = 100000;
+    auto text = RunToString(&interpreter, "(nest 100000)");
+    REQUIRE(text == std::string(depth, '(') + "()" + std::string(depth, ')'));
+}
+
+TEST_CASE("Improper lists are printed with a dot") {
+    Interpreter interpreter;
+    REQUIRE(RunToString(&interpreter, "(cons 1 2)") == "(1 . 2)");
+    REQUIRE(RunToString(&interpreter, "'(1 2 . 3)") == "(1 2 . 3)");
+    REQUIRE(RunToString(&interpreter, "(cons (cons 1 2) (cons 3 '()))") == "((1 . 2) 3)");
+    REQUIRE(RunToString(&interpreter, "'((a . b) . (c . d))") == "((a . b) c . d)");
+}
@@ -0,0 +1,39 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+TEST_CASE("A promise runs its body once") {
+    Interpreter interpreter;
+    interpreter.Run("(define count 0)");
+    interpreter.Run("(define p (delay (let () (set! count (+ count 1)) (* count 10))))");
+    REQUIRE(interpreter.Run("count") == "0");
+    REQUIRE(interpreter.Run("(force p)") == "10");
+    REQUIRE(interpreter.Run("(force p)") == "10");
+    REQUIRE(interpreter.Run("count") == "1");
+}
+
+TEST_CASE("Long delay-force chains are forced without recursion") {
+    Interpreter interpreter;
+    interpreter.Run("(define (chain n)"
+                    " (if (= n 0) (make-promise 'done) (delay-force (chain (- n 1)))))");
+    REQUIRE(interpreter.Run("(force (chain 1000000))") == "done");
+}
+
+TEST_CASE("Infinite streams are walked lazily") {
+    Interpreter interpreter;
+    interpreter.Run("(define (from n) (cons-stream n (from (+ n 1))))");
+    interpreter.Run("(define naturals (from 0))");
+    REQUIRE(interpreter.Run("(stream-take naturals 5)") == "(0 1 2 3 4)");
+    REQUIRE(interpreter.Run("(stream-ref naturals 100000)") == "100000");
+    REQUIRE(interpreter.Run("(stream-car (stream-cdr naturals))") == "1");
+    REQUIRE(interpreter.Run("(stream-pair? naturals)") == "#t");
+}
+
+TEST_CASE("make-promise wraps values that are not promises") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(promise? (make-promise 1))") == "#t");
+    REQUIRE(interpreter.Run("(force (make-promise 1))") == "1");
+    REQUIRE(interpreter.Run("(promise? (delay 1))") == "#t");
+    REQUIRE(interpreter.Run("(promise? 1)") == "#f");
+    REQUIRE(interpreter.Run("(force (make-promise (delay (+ 1 2))))") == "3");
+}
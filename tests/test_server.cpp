@@ -0,0 +1,312 @@
+#include <catch2/catch.hpp>
+
+#include <signal.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "protocol.h"
+
+// Runs the server binary named by SCHEME_SERVER, or ./scheme_server, on a socket of its own
+// with one worker and the given timeout in milliseconds.
+class ServerProcess {
+public:
+    explicit ServerProcess(const std::string& binary, const std::string& timeout = "1000")
+        : path_("/tmp/scheme_test_" + std::to_string(getpid()) + ".sock") {
+        pid_ = fork();
+        if (pid_ == 0) {
+            execl(binary.c_str(), binary.c_str(), path_.c_str(), "--workers", "1", "--timeout",
+                  timeout.c_str(), nullptr);
+            _exit(127);
+        }
+    }
+    ServerProcess(const ServerProcess&) = delete;
+    ServerProcess& operator=(const ServerProcess&) = delete;
+
+    ~ServerProcess() {
+        for (int fd : {fd_, other_fd_}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        if (pid_ > 0 && Stop() < 0) {
+            waitpid(pid_, nullptr, 0);
+        }
+    }
+
+    // Connects once the server listens; -1 if it never does.
+    int Connect() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path_.c_str());
+        for (int attempt = 0; attempt < 500 && fd_ < 0; ++attempt) {
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+                fd_ = fd;
+            } else {
+                close(fd);
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        return fd_;
+    }
+
+    // Opens a second connection once the first is open; -1 if it fails.
+    int ConnectOther() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path_.c_str());
+        other_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connect(other_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return -1;
+        }
+        return other_fd_;
+    }
+
+    // Sends the requests in one write without waiting for their responses.
+    bool Send(int fd, const std::vector<Request>& requests) {
+        std::string data;
+        for (const auto& request : requests) {
+            data += EncodeRequest(request);
+        }
+        return SendAll(fd, data);
+    }
+
+    // Sends the code and waits for its response.
+    Response Ask(uint64_t id, const std::string& code) {
+        if (!Send(fd_, {{id, code}})) {
+            Response response;
+            response.status = ResponseStatus::kTimeout;
+            return response;
+        }
+        return Receive();
+    }
+
+    // Waits for the next response on the first connection.
+    Response Receive() {
+        Response response;
+        response.status = ResponseStatus::kTimeout;
+        std::string_view frame;
+        while (!reader_.Next(&frame)) {
+            if (!reader_.Fill(fd_)) {
+                return response;
+            }
+        }
+        DecodeResponse(frame, &response);
+        return response;
+    }
+
+    // Asks the server to exit and returns its wait status, or -1 if it is already gone.
+    int Stop() {
+        int status = -1;
+        if (kill(pid_, SIGTERM) == 0 && waitpid(pid_, &status, 0) == pid_) {
+            pid_ = -1;
+            return status;
+        }
+        return -1;
+    }
+
+private:
+    std::string path_;
+    pid_t pid_ = -1;
+    int fd_ = -1;
+    int other_fd_ = -1;
+    FrameReader reader_{};
+};
+
+TEST_CASE("A failing request leaves the server answering the next one") {
+    const char* binary = std::getenv("SCHEME_SERVER");
+    std::string server = binary ? binary : "./scheme_server";
+    if (access(server.c_str(), X_OK) != 0) {
+        WARN("no server binary at " + server + "; build scheme_server to run this test");
+        return;
+    }
+
+    ServerProcess process(server);
+    REQUIRE(process.Connect() >= 0);
+    uint64_t id = 0;
+    for (const auto& code : {"(/ 1 0)", "(/ (- -9223372036854775807 1) -1)",
+                             "(let ((a 7) (b 0)) (/ a b))", "(set-car! 1 2)", "(and 1 . 2)",
+                             "(if #t . 1)"}) {
+        auto failed = process.Ask(id++, code);
+        REQUIRE(failed.id == id - 1);
+        REQUIRE(failed.status != ResponseStatus::kOk);
+        REQUIRE(failed.status != ResponseStatus::kTimeout);
+
+        auto next = process.Ask(id++, "(+ 1 2)");
+        REQUIRE(next.status == ResponseStatus::kOk);
+        REQUIRE(next.text == "3");
+    }
+
+    int status = process.Stop();
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
+
+// Nested so deep that evaluating it, or any pass over it, would run off the end of the stack.
+static std::string NestedSum(size_t depth) {
+    std::string code;
+    for (size_t i = 0; i < depth; ++i) {
+        code += "(+ 1 ";
+    }
+    return code + "0" + std::string(depth, ')');
+}
+
+TEST_CASE("A request nested too deep fails and the server keeps running") {
+    const char* binary = std::getenv("SCHEME_SERVER");
+    std::string server = binary ? binary : "./scheme_server";
+    if (access(server.c_str(), X_OK) != 0) {
+        WARN("no server binary at " + server + "; build scheme_server to run this test");
+        return;
+    }
+
+    ServerProcess process(server);
+    REQUIRE(process.Connect() >= 0);
+    auto deep = process.Ask(0, NestedSum(50000));
+    REQUIRE(deep.status == ResponseStatus::kRuntimeError);
+    REQUIRE(deep.text == "recursion is too deep");
+
+    auto shallow = process.Ask(1, NestedSum(1000));
+    REQUIRE(shallow.status == ResponseStatus::kOk);
+    REQUIRE(shallow.text == "1000");
+
+    int status = process.Stop();
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+}
+
+// A list of n numbers, printed in about 6n bytes.
+static const char* kDefineIota =
+    "(define (iota n acc) (if (= n 0) acc (iota (- n 1) (cons n acc))))";
+
+TEST_CASE("Pipelined requests are all answered") {
+    const char* binary = std::getenv("SCHEME_SERVER");
+    std::string server = binary ? binary : "./scheme_server";
+    if (access(server.c_str(), X_OK) != 0) {
+        WARN("no server binary at " + server + "; build scheme_server to run this test");
+        return;
+    }
+
+    ServerProcess process(server, "10000");
+    int fd = process.Connect();
+    REQUIRE(fd >= 0);
+    REQUIRE(process.Ask(0, kDefineIota).status == ResponseStatus::kOk);
+
+    // The big responses fill the socket while the later requests are still being evaluated.
+    std::vector<Request> requests;
+    for (uint64_t id = 1; id <= 200; ++id) {
+        requests.push_back({id, id % 50 == 0 ? "(length (iota 100000 '()))"
+                                              : "(+ " + std::to_string(id) + " 1)"});
+    }
+    requests.push_back({201, "(iota 100000 '())"});
+    requests.push_back({202, "(iota 100000 '())"});
+    REQUIRE(process.Send(fd, requests));
+    for (uint64_t id = 1; id <= 202; ++id) {
+        auto response = process.Receive();
+        REQUIRE(response.id == id);
+        REQUIRE(response.status == ResponseStatus::kOk);
+        if (id <= 200) {
+            REQUIRE(response.text == (id % 50 == 0 ? "100000" : std::to_string(id + 1)));
+        } else {
+            REQUIRE(response.text.size() > 500000);
+        }
+    }
+}
+
+TEST_CASE("A client that does not read its responses holds up no other client") {
+    const char* binary = std::getenv("SCHEME_SERVER");
+    std::string server = binary ? binary : "./scheme_server";
+    if (access(server.c_str(), X_OK) != 0) {
+        WARN("no server binary at " + server + "; build scheme_server to run this test");
+        return;
+    }
+
+    // The worker first evaluates what the idle client asked for.
+    ServerProcess process(server, "10000");
+    REQUIRE(process.Connect() >= 0);
+    REQUIRE(process.Ask(0, kDefineIota).status == ResponseStatus::kOk);
+    int idle = process.ConnectOther();
+    REQUIRE(idle >= 0);
+    std::vector<Request> requests;
+    for (uint64_t id = 0; id < 5; ++id) {
+        requests.push_back({id, "(iota 100000 '())"});
+    }
+    REQUIRE(process.Send(idle, requests));
+
+    for (uint64_t id = 1; id <= 3; ++id) {
+        auto response = process.Ask(id, "(+ 1 2)");
+        REQUIRE(response.id == id);
+        REQUIRE(response.status == ResponseStatus::kOk);
+        REQUIRE(response.text == "3");
+    }
+}
+
+TEST_CASE("Every request has its own deadline from when it is read") {
+    const char* binary = std::getenv("SCHEME_SERVER");
+    std::string server = binary ? binary : "./scheme_server";
+    if (access(server.c_str(), X_OK) != 0) {
+        WARN("no server binary at " + server + "; build scheme_server to run this test");
+        return;
+    }
+
+    ServerProcess process(server, "300");
+    int fd = process.Connect();
+    REQUIRE(fd >= 0);
+    REQUIRE(process.Ask(0, "(define (spin) (spin))").status == ResponseStatus::kOk);
+
+    auto start = std::chrono::steady_clock::now();
+    auto spun = process.Ask(1, "(spin)");
+    REQUIRE(spun.status == ResponseStatus::kTimeout);
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(300));
+
+    // The second request waits for the single worker past its own deadline.
+    REQUIRE(process.Send(fd, {{2, "(spin)"}, {3, "(+ 1 2)"}}));
+    auto first = process.Receive();
+    auto second = process.Receive();
+    REQUIRE(first.id == 2);
+    REQUIRE(first.status == ResponseStatus::kTimeout);
+    REQUIRE(second.id == 3);
+    REQUIRE(second.status == ResponseStatus::kTimeout);
+
+    auto next = process.Ask(4, "(+ 1 2)");
+    REQUIRE(next.status == ResponseStatus::kOk);
+    REQUIRE(next.text == "3");
+}
+
+TEST_CASE("A stopped server answers the requests it has read before it exits") {
+    const char* binary = std::getenv("SCHEME_SERVER");
+    std::string server = binary ? binary : "./scheme_server";
+    if (access(server.c_str(), X_OK) != 0) {
+        WARN("no server binary at " + server + "; build scheme_server to run this test");
+        return;
+    }
+
+    // Long enough for the worker to get through every request.
+    ServerProcess process(server, "10000");
+    int fd = process.Connect();
+    REQUIRE(fd >= 0);
+    REQUIRE(process.Ask(0, "(define (count n) (if (= n 0) 'done (count (- n 1))))").status ==
+            ResponseStatus::kOk);
+    std::vector<Request> requests;
+    for (uint64_t id = 1; id <= 20; ++id) {
+        requests.push_back({id, "(count 20000)"});
+    }
+    REQUIRE(process.Send(fd, requests));
+    REQUIRE(process.Receive().id == 1);
+
+    int status = process.Stop();
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+    for (uint64_t id = 2; id <= 20; ++id) {
+        auto response = process.Receive();
+        REQUIRE(response.id == id);
+        REQUIRE(response.status == ResponseStatus::kOk);
+        REQUIRE(response.text == "done");
+    }
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+TEST_CASE("Strings are indexed, cut and joined") {
+    Interpreter interpreter;
+    interpreter.Run("(define s \"hello\")");
+    REQUIRE(interpreter.Run("(string-length s)") == "5");
+    REQUIRE(interpreter.Run("(string-ref s 1)") == "\"e\"");
+    REQUIRE(interpreter.Run("(substring s 1 3)") == "\"el\"");
+    REQUIRE(interpreter.Run("(substring s 2)") == "\"llo\"");
+    REQUIRE(interpreter.Run("(substring s 5 5)") == "\"\"");
+    REQUIRE(interpreter.Run("(string-append \"ab\" \"\" \"cd\")") == "\"abcd\"");
+    REQUIRE(interpreter.Run("(string-append)") == "\"\"");
+    REQUIRE(interpreter.Run("(string-append s \" \" s)") == "\"hello hello\"");
+}
+
+TEST_CASE("Indices out of range fail with a runtime error") {
+    Interpreter interpreter;
+    for (const auto& code : {"(string-ref \"abc\" 3)", "(string-ref \"abc\" -1)",
+                             "(string-ref \"\" 0)", "(substring \"hello\" 3 2)",
+                             "(substring \"hello\" 0 6)", "(substring \"hello\" -1 2)",
+                             "(string-append \"a\" 1)"}) {
+        REQUIRE_THROWS_AS(interpreter.Run(code), RuntimeError);
+    }
+}
+
+TEST_CASE("Strings are compared") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(string=? \"a\" \"a\" \"a\")") == "#t");
+    REQUIRE(interpreter.Run("(string=? \"a\" \"b\")") == "#f");
+    REQUIRE(interpreter.Run("(string<? \"a\" \"b\")") == "#t");
+    REQUIRE(interpreter.Run("(string<? \"b\" \"a\")") == "#f");
+    REQUIRE(interpreter.Run("(string<? \"ab\" \"abc\")") == "#t");
+    REQUIRE(interpreter.Run("(string=? (string-append \"a\" \"b\") \"ab\")") == "#t");
+}
+
+TEST_CASE("Escapes in string literals") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(string-length \"a\\nb\\t\\\"c\\\\\")") == "7");
+    REQUIRE(interpreter.Run("\"a\\nb\\t\\\"c\\\\\"") == "\"a\\nb\\t\\\"c\\\\\"");
+    REQUIRE(interpreter.Run("(string=? (string-ref \"\\n\" 0) \"\\n\")") == "#t");
+    REQUIRE_THROWS_AS(interpreter.Run("\"abc"), SyntaxError);
+}
+
+TEST_CASE("Unknown escapes in string literals are rejected") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(string=? \"\\x41;\\x62;\" \"Ab\")") == "#t");
+    REQUIRE(interpreter.Run("(string-length \"\\r\\a\\b\\|\\x0;\")") == "5");
+    for (const auto& code : {"\"\\q\"", "\"\\x41\"", "\"\\x;\"", "\"\\x123;\"", "\"\\xg;\""}) {
+        REQUIRE_THROWS_AS(interpreter.Run(code), SyntaxError);
+    }
+}
@@ -0,0 +1,131 @@
+#include <catch2/catch.hpp>
+
+#include "jit.h"
+#include "scheme.h"
+
+// Resumes the task until it is done and returns how many slices it took.
+static size_t RunToEnd(Task* task) {
+    size_t slices = 1;
+    while (!task->Resume()) {
+        ++slices;
+    }
+    return slices;
+}
+
+TEST_CASE("Tasks of different lengths interleave slice by slice") {
+    Interpreter interpreter;
+    interpreter.Run("(define (spin n) (if (= n 0) 'done (spin (- n 1))))");
+    interpreter.Run("(define (total n) (do ((i 0 (+ i 1)) (s 0 (+ s i))) ((= i n) s)))");
+
+    size_t slice = 1000;
+    auto long_task = interpreter.RunAsync("(spin 200000)", slice);
+    auto short_task = interpreter.RunAsync("(total 3000)", slice);
+
+    size_t long_slices = 0;
+    size_t short_slices = 0;
+    while (!long_task->IsDone() || !short_task->IsDone()) {
+        long_slices += !long_task->IsDone();
+        long_task->Resume();
+        short_slices += !short_task->IsDone();
+        short_task->Resume();
+    }
+    REQUIRE(long_slices >= 200000 / slice);
+    REQUIRE(short_slices < long_slices / 10);
+    REQUIRE(long_task->GetState() == Task::State::kDone);
+    REQUIRE(long_task->GetResult() == "done");
+    REQUIRE(short_task->GetResult() == "4498500");
+}
+
+TEST_CASE("Compiled code takes its steps from the slice") {
+    Interpreter interpreter;
+    interpreter.Run("(define (spin n) (if (= n 0) 0 (spin (- n 1))))");
+    interpreter.Run("(define (deep n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))");
+    for (size_t i = 0; i < JitCode::kThreshold + 1; ++i) {
+        interpreter.Run("(spin 3)");
+        interpreter.Run("(deep 3)");
+    }
+
+    size_t slice = 1000;
+    auto spin = interpreter.RunAsync("(spin 300000)", slice);
+    REQUIRE(RunToEnd(spin.get()) >= 300000 / slice);
+    REQUIRE(spin->GetResult() == "0");
+    auto deep = interpreter.RunAsync("(deep 5000)", slice);
+    REQUIRE(RunToEnd(deep.get()) >= 5000 / slice);
+    REQUIRE(deep->GetResult() == "5000");
+    REQUIRE(interpreter.Run("(spin 10)") == "0");
+}
+
+TEST_CASE("Cancelled tasks leave the interpreter usable") {
+    Interpreter interpreter;
+    interpreter.Run("(define (spin n) (if (= n 0) 0 (spin (- n 1))))");
+    auto task = interpreter.RunAsync("(spin 1000000)", 1000);
+    REQUIRE_FALSE(task->Resume());
+    task->Cancel();
+    REQUIRE(task->GetState() == Task::State::kCancelled);
+    REQUIRE(task->IsDone());
+    REQUIRE(interpreter.Run("(spin 10)") == "0");
+}
+
+TEST_CASE("Recursion too deep for the stack fails with a runtime error") {
+    Interpreter interpreter;
+    interpreter.Run("(define (deep n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))");
+    REQUIRE_THROWS_AS(interpreter.Run("(deep 1000000)"), RuntimeError);
+    REQUIRE(interpreter.Run("(guard (e (#t 'caught)) (deep 1000000))") == "caught");
+
+    auto task = interpreter.RunAsync("(deep 1000000)");
+    while (!task->Resume()) {
+    }
+    REQUIRE(task->GetState() == Task::State::kFailed);
+    REQUIRE_THROWS_AS(task->GetResult(), RuntimeError);
+    REQUIRE(interpreter.Run("(deep 1000)") == "1000");
+
+    std::string nested;
+    for (size_t i = 0; i < 50000; ++i) {
+        nested += "(+ 1 ";
+    }
+    nested += "0" + std::string(50000, ')');
+    REQUIRE_THROWS_AS(interpreter.Run(nested), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(define (f) " + nested + ")"), RuntimeError);
+    REQUIRE(interpreter.Run("(deep 1000)") == "1000");
+}
+
+TEST_CASE("Builtins that call procedures take steps from the slice") {
+    Interpreter interpreter;
+    interpreter.Run("(define (range n)"
+                    " (let lp ((i 0) (l '())) (if (= i n) l (lp (+ i 1) (cons i l)))))");
+    interpreter.Run("(define big (range 20000))");
+    auto task = interpreter.RunAsync("(length (sort big <))", 1000);
+    size_t slices = RunToEnd(task.get());
+    REQUIRE(slices >= 20000 / 1000);
+    REQUIRE(task->GetResult() == "20000");
+}
+
+TEST_CASE("Compiled code yields where it is and stays compiled") {
+    auto slices = [](bool compiled) {
+        JitCode::SetEnabled(compiled);
+        Interpreter interpreter;
+        interpreter.Run("(define (spin n) (if (= n 0) 0 (spin (- n 1))))");
+        for (size_t i = 0; i < JitCode::kThreshold + 1; ++i) {
+            interpreter.Run("(spin 3)");
+        }
+        std::vector<size_t> counts;
+        for (int run = 0; run < 2; ++run) {
+            auto task = interpreter.RunAsync("(spin 20000)", 1000);
+            counts.push_back(RunToEnd(task.get()));
+            REQUIRE(task->GetResult() == "0");
+        }
+
+        auto cancelled = interpreter.RunAsync("(spin 1000000)", 1000);
+        REQUIRE_FALSE(cancelled->Resume());
+        cancelled->Cancel();
+        REQUIRE(cancelled->GetState() == Task::State::kCancelled);
+        REQUIRE(interpreter.Run("(spin 10)") == "0");
+        JitCode::SetEnabled(true);
+        return counts;
+    };
+    auto compiled = slices(true);
+    auto interpreted = slices(false);
+    REQUIRE(compiled[0] >= 20000 / 1000);
+    REQUIRE(compiled[1] == compiled[0]);
+    REQUIRE(compiled[1] < interpreted[1]);
+}
@@ -0,0 +1,59 @@
+#include <catch2/catch.hpp>
+
+#include "tokenizer.h"
+
+// The vector scans decide only common bytes; these are left to the table or end a run.
+static const std::string kSymbolChars = "aZ9-<=>?!*#/_q0";
+static const std::string kSpaceChars = " \t\n\r\v\f";
+static const std::string kStops = std::string("()'\" +.") + "\x01\x7f\x80\xc1\xe1\xfa\xff";
+
+// End of the run of bytes from pos that pass the scalar classification.
+template <class F>
+static size_t ScalarRun(const std::string& input, size_t pos, F in_run) {
+    while (pos < input.size() && in_run(input[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+TEST_CASE("Vector and scalar classification agree across 16-byte blocks") {
+    for (size_t offset = 0; offset < 16; ++offset) {
+        for (size_t length = 0; length < 48; ++length) {
+            std::string spaces;
+            for (size_t i = 0; i < offset + length; ++i) {
+                spaces.push_back(kSpaceChars[i % kSpaceChars.size()]);
+            }
+            spaces.push_back('x');
+            REQUIRE(Tokenizer(spaces).GetPosition() == ScalarRun(spaces, 0, Tokenizer::IsSpace));
+
+            for (char stop : kStops) {
+                std::string symbol(1, 'a');
+                for (size_t i = 1; i < length + 1; ++i) {
+                    symbol.push_back(kSymbolChars[(i + offset) % kSymbolChars.size()]);
+                }
+                auto text = std::string(offset, ' ') + symbol + stop;
+                size_t end = ScalarRun(text, offset + 1, Tokenizer::AvailableCharsInSymbol);
+                REQUIRE(end == offset + symbol.size());
+                Token token;
+                REQUIRE(Tokenizer::Lex(text, offset, false, &token) == end);
+                REQUIRE(token == Token{SymbolToken{symbol}});
+
+                auto digits = std::string(offset, ' ') + std::string(length % 18 + 1, '7') + stop;
+                end = ScalarRun(digits, offset, Tokenizer::IsDigit);
+                REQUIRE(Tokenizer::Lex(digits, offset, false, &token) == end);
+            }
+        }
+    }
+}
+
+TEST_CASE("Bytes the reader does not accept fail only once they are reached") {
+    for (char bad : {'\x01', '\x7f', '\x80', '\xc1', '\xe1', '\xff', ':', '['}) {
+        for (size_t length = 1; length < 40; ++length) {
+            auto text = std::string(length, 'k') + bad + "tail";
+            Tokenizer tokenizer(text);
+            REQUIRE(tokenizer.GetToken() == Token{SymbolToken{std::string(length, 'k')}});
+            tokenizer.Next();
+            REQUIRE_THROWS_AS(tokenizer.GetToken(), SyntaxError);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch.hpp>
+
+#include "scheme.h"
+
+#include <string>
+
+static std::string Call(const std::string& op, const std::string& arg, size_t count) {
+    std::string code = "(" + op;
+    for (size_t i = 0; i < count; ++i) {
+        code += " " + arg;
+    }
+    return code + ")";
+}
+
+TEST_CASE("Nested calls keep their arguments apart") {
+    Interpreter interpreter;
+    std::string code = "0";
+    for (int i = 0; i < 2000; ++i) {
+        code = "(+ 1 " + code + " (* 1 0))";
+    }
+    REQUIRE(interpreter.Run(code) == "2000");
+    REQUIRE(interpreter.Run("(list 1 (list 2 (+ 3 4) (list)) (- 10 (+ 1 2) 3))") ==
+            "(1 (2 7 ()) 4)");
+}
+
+TEST_CASE("Variadic calls take any number of arguments") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run(Call("+", "1", 10000)) == "10000");
+    REQUIRE(interpreter.Run(Call("max", "7", 5000)) == "7");
+    REQUIRE(interpreter.Run(Call("<", "1", 5000)) == "#f");
+
+    // Every inner call spills over the chunk its outer frame started in.
+    auto inner = Call("+", "1", 5000);
+    REQUIRE(interpreter.Run("(list " + inner + " " + inner + " " + inner + ")") ==
+            "(5000 5000 5000)");
+    REQUIRE(interpreter.Run(Call("+", inner, 10)) == "50000");
+}
+
+TEST_CASE("A callee failing with arguments on the stack leaves it balanced") {
+    Interpreter interpreter;
+    interpreter.Run("(define (f x) (car x))");
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 2 (f 5) 4)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(list 1 (list 2 (+ 3 (f '()))) 4)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(list " + Call("+", "1", 5000) + " (f 1))"), RuntimeError);
+    REQUIRE(interpreter.Run("(+ 1 2 (f '(3)) 4)") == "10");
+    REQUIRE(interpreter.Run(Call("+", "(f '(1))", 5000)) == "5000");
+}
+
+TEST_CASE("Numeric builtins report their Scheme names") {
+    Interpreter interpreter;
+    interpreter.Run("(define x 'a)");
+    REQUIRE_THROWS_WITH(interpreter.Run("(+ 1 x)"), "+: unexpected argument type");
+    REQUIRE_THROWS_WITH(interpreter.Run("(< 1 x)"), "<: unexpected argument type");
+    REQUIRE_THROWS_WITH(interpreter.Run("(max x 1)"), "max: unexpected argument type");
+
+    interpreter.Run("(define op -)");
+    REQUIRE_THROWS_WITH(interpreter.Run("(op)"), "-: wrong number of arguments");
+    interpreter.Run("(define op /)");
+    REQUIRE_THROWS_WITH(interpreter.Run("(op)"), "/: wrong number of arguments");
+}
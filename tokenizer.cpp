@@ -1,5 +1,12 @@
 #include "tokenizer.h"
 
+#include <algorithm>
+#include <bit>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 bool SymbolToken::operator==(const SymbolToken& other) const {
     return name == other.name;
 }
@@ -20,110 +27,225 @@ bool BooleanToken::operator==(const BooleanToken& other) const {
     return value == other.value;
 }
 
-bool Tokenizer::IsEnd() {
-    return in_->eof() || in_->peek() == EOF;
+bool StringToken::operator==(const StringToken& other) const {
+    return value == other.value;
 }
 
-void Tokenizer::Next() {
-    auto token = GetToken();
+#if defined(__SSE2__)
+// Vector loops only decide the common letters, digits and separators; every other byte is
+// looked up in the table one at a time.
+static __m128i InRange(__m128i bytes, char lo, char hi) {
+    auto shifted = _mm_add_epi8(bytes, _mm_set1_epi8(static_cast<char>(0x80 - lo)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + (hi - lo + 1))));
+}
 
-    if (SymbolToken* x = std::get_if<SymbolToken>(&token)) {
-        token_len_ = (x->name).size();
+static __m128i Equal(__m128i bytes, char c) {
+    return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(c));
+}
+#endif
+
+template <Tokenizer::CharClass kClass>
+size_t Tokenizer::SkipRun(std::string_view input, size_t pos) {
+    while (pos < input.size() && kCharClasses[static_cast<unsigned char>(input[pos])] & kClass) {
+        ++pos;
+#if defined(__SSE2__)
+        for (; pos + 16 <= input.size(); pos += 16) {
+            auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + pos));
+            auto spaces = _mm_or_si128(_mm_or_si128(Equal(bytes, ' '), Equal(bytes, '\n')),
+                                       _mm_or_si128(Equal(bytes, '\t'), Equal(bytes, '\r')));
+            auto digits = InRange(bytes, '0', '9');
+            auto symbol = _mm_or_si128(InRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z'),
+                                       _mm_or_si128(digits, Equal(bytes, '-')));
+            __m128i accepted;
+            if constexpr (kClass == kSpace) {
+                accepted = spaces;
+            } else if constexpr (kClass == kDigit) {
+                accepted = digits;
+            } else {
+                static_assert(kClass == kInSymbol);
+                accepted = symbol;
+            }
+            auto rejected = ~static_cast<unsigned>(_mm_movemask_epi8(accepted)) & 0xFFFF;
+            if (rejected) {
+                pos += std::countr_zero(rejected);
+                break;
+            }
+        }
+#endif
     }
+    return pos;
+}
 
-    while (token_len_ > 0) {
-        in_->get();
-        token_len_ -= 1;
+Tokenizer::Tokenizer(std::istream* in) {
+    constexpr size_t kReadChunk = 1 << 16;
+    while (*in) {
+        size_t size = owned_.size();
+        owned_.resize(size + kReadChunk);
+        in->read(owned_.data() + size, kReadChunk);
+        owned_.resize(size + in->gcount());
     }
-    SkipSpaces();
+    input_ = owned_;
+    pos_ = SkipSpaces(input_, 0);
 }
 
-Token Tokenizer::GetToken() {
-    token_len_ = 0;
-    char curr = in_->get();
+Tokenizer::Tokenizer(std::string_view input) : input_(input) {
+    pos_ = SkipSpaces(input_, 0);
+}
 
-    if (curr == '\'') {
-        token_len_ = 1;
-        in_->unget();
-        return Token{QuoteToken{}};
-    }
-    if (curr == '.') {
-        token_len_ = 1;
-        in_->unget();
-        return Token{DotToken{}};
+size_t Tokenizer::SkipSpaces(std::string_view input, size_t pos) {
+    return SkipRun<kSpace>(input, pos);
+}
+
+void Tokenizer::Next() {
+    GetToken();
+    consumed_end_ = token_end_;
+    lexed_ = false;
+    pos_ = SkipSpaces(input_, consumed_end_);
+}
+
+const Token& Tokenizer::GetToken() {
+    if (!lexed_) {
+        if (IsEnd()) {
+            throw SyntaxError{"unexpected end of input"};
+        }
+        token_end_ = Lex(input_, pos_, false, &token_);
+        lexed_ = true;
     }
-    if (curr == '#') {
-        if (!IsEnd() && (in_->peek() == 't' || in_->peek() == 'f')) {
-            char val = in_->peek();
-            in_->unget();
-            token_len_ = 2;
+    return token_;
+}
 
-            if (val == 't') {
-                return Token{BooleanToken{true}};
+// Appends the character of the escape starting at pos, just after a backslash, and returns the
+// offset past it, or kNeedMore if the input ends before a \x escape does.
+static size_t ReadEscape(std::string_view input, size_t pos, std::string* value) {
+    static constexpr std::string_view kEscapes = "n\nt\tr\ra\ab\b\"\"\\\\||";
+    char c = input[pos];
+    if (c != 'x') {
+        for (size_t i = 0; i < kEscapes.size(); i += 2) {
+            if (kEscapes[i] == c) {
+                value->push_back(kEscapes[i + 1]);
+                return pos + 1;
             }
-            return Token{BooleanToken{false}};
         }
+        throw SyntaxError{"unknown escape in string literal: \\" + std::string(1, c)};
     }
-    if (curr == '(' || curr == ')') {
-        token_len_ = 1;
-        in_->unget();
-        if (curr == '(') {
-            return Token{BracketToken::OPEN};
+
+    size_t end = pos + 1;
+    int code = 0;
+    for (; end < input.size() && end < pos + 3 && input[end] != ';'; ++end) {
+        char digit = input[end];
+        char lower = digit | 0x20;
+        if (!Tokenizer::IsDigit(digit) && !(lower >= 'a' && lower <= 'f')) {
+            throw SyntaxError{"\\x escape should be one or two hex digits and a semicolon"};
         }
-        return Token{BracketToken::CLOSE};
+        code = code * 16 + (Tokenizer::IsDigit(digit) ? digit - '0' : lower - 'a' + 10);
     }
+    if (end == input.size()) {
+        return Tokenizer::kNeedMore;
+    }
+    if (end == pos + 1 || input[end] != ';') {
+        throw SyntaxError{"\\x escape should be one or two hex digits and a semicolon"};
+    }
+    value->push_back(static_cast<char>(code));
+    return end + 1;
+}
 
-    size_t len = 1;
+size_t Tokenizer::Lex(std::string_view input, size_t pos, bool partial, Token* token) {
+    char curr = input[pos];
+    if (curr != '"' && !AvailableChars(curr)) {
+        throw SyntaxError{"unavailable symbol: " + std::string(1, curr) +
+                          std::to_string(int(curr))};
+    }
 
-    bool is_digit = std::isdigit(curr);
-    if ((curr == '+' || curr == '-') && !IsEnd() && std::isdigit(in_->peek())) {
-        is_digit = true;
+    if (curr == '\'') {
+        *token = QuoteToken{};
+        return pos + 1;
+    }
+    if (curr == '.') {
+        auto dots = input.substr(pos, 3);
+        if (dots == "...") {
+            *token = SymbolToken{"..."};
+            return pos + 3;
+        }
+        if (partial && dots.find_first_not_of('.') == std::string_view::npos &&
+            pos + dots.size() == input.size()) {
+            return kNeedMore;
+        }
+        *token = DotToken{};
+        return pos + 1;
     }
-    if (is_digit) {
-        char sgn = 1;
-        if (curr == '-') {
-            sgn = -1;
-        } else if (curr == '+') {
-            token_len_ = 1;
+    if (curr == '#') {
+        if (pos + 1 == input.size() && partial) {
+            return kNeedMore;
         }
-
-        int64_t curr_digit = 0;
-        if (curr != '+' && curr != '-') {
-            curr_digit = static_cast<int64_t>(curr - '0');
+        if (pos + 1 < input.size() && (input[pos + 1] == 't' || input[pos + 1] == 'f')) {
+            *token = BooleanToken{input[pos + 1] == 't'};
+            return pos + 2;
         }
-        while (!IsEnd() && std::isdigit(in_->peek())) {
-            len += 1;
-            curr = in_->get();
-            curr_digit = curr_digit * 10 + static_cast<int64_t>(curr - '0');
+    }
+    if (curr == '"') {
+        std::string value;
+        size_t end = pos + 1;
+        while (true) {
+            size_t stop = input.find_first_of("\"\\", end);
+            if (stop == std::string_view::npos ||
+                (input[stop] == '\\' && stop + 1 == input.size())) {
+                if (partial) {
+                    return kNeedMore;
+                }
+                throw SyntaxError{"unterminated string literal"};
+            }
+            value.append(input.substr(end, stop - end));
+            if (input[stop] == '"') {
+                end = stop + 1;
+                break;
+            }
+            end = ReadEscape(input, stop + 1, &value);
+            if (end == kNeedMore) {
+                if (partial) {
+                    return kNeedMore;
+                }
+                throw SyntaxError{"unterminated string literal"};
+            }
         }
-        curr_digit *= sgn;
+        *token = StringToken{std::move(value)};
+        return end;
+    }
+    if (curr == '(' || curr == ')') {
+        *token = curr == '(' ? BracketToken::OPEN : BracketToken::CLOSE;
+        return pos + 1;
+    }
 
-        while (len > 0) {
-            in_->unget();
-            len -= 1;
+    bool is_sign = curr == '+' || curr == '-';
+    if (is_sign && partial && pos + 1 == input.size()) {
+        return kNeedMore;
+    }
+    bool is_signed = is_sign && pos + 1 < input.size() && IsDigit(input[pos + 1]);
+    if (IsDigit(curr) || is_signed) {
+        size_t begin = is_signed ? pos + 1 : pos;
+        size_t end = SkipRun<kDigit>(input, begin);
+        if (partial && end == input.size()) {
+            return kNeedMore;
+        }
+        int64_t value = 0;
+        for (size_t i = begin; i < end; ++i) {
+            value = value * 10 + static_cast<int64_t>(input[i] - '0');
         }
-        token_len_ += std::to_string(curr_digit).size();
-        return Token{ConstantToken{curr_digit}};
+        *token = ConstantToken{curr == '-' ? -value : value};
+        return end;
     }
 
-    if (curr == '+' || curr == '-') {
-        in_->unget();
-        return Token{SymbolToken{std::string(1, curr)}};
+    if (is_sign) {
+        *token = SymbolToken{std::string(1, curr)};
+        return pos + 1;
     }
 
     if (!BeginsWith(curr)) {
         throw SyntaxError{"syntax error:" + std::string(1, curr) + std::to_string(int(curr))};
     }
-    std::string curr_symbol(1, curr);
-    while (!IsEnd() && AvailableCharsInSymbol(in_->peek())) {
-        len += 1;
-        curr_symbol.push_back(in_->get());
-    }
-
-    while (len > 0) {
-        in_->unget();
-        len -= 1;
+    size_t end = SkipRun<kInSymbol>(input, pos + 1);
+    if (partial && end == input.size()) {
+        return kNeedMore;
     }
-
-    return Token{SymbolToken{curr_symbol}};
-}
\ No newline at end of file
+    *token = SymbolToken{std::string(input.substr(pos, end - pos))};
+    return end;
+}
@@ -1,9 +1,11 @@
 #pragma once
 
-#include <variant>
-#include <cctype>
-#include <optional>
+#include <array>
+#include <cstdint>
 #include <istream>
+#include <string>
+#include <string_view>
+#include <variant>
 #include "error.h"
 
 struct SymbolToken {
@@ -34,56 +36,110 @@ struct BooleanToken {
     bool operator==(const BooleanToken& other) const;
 };
 
-using Token =
-    std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken, BooleanToken>;
+struct StringToken {
+    std::string value;
+
+    bool operator==(const StringToken& other) const;
+};
+
+using Token = std::variant<ConstantToken, BracketToken, SymbolToken, QuoteToken, DotToken,
+                           BooleanToken, StringToken>;
 
 class Tokenizer {
 public:
-    Tokenizer(std::istream* in) : in_(in) {
-        size_t len = 0;
-        while (!IsEnd()) {
-            char curr = in_->get();
-            if (!AvailableChars(curr)) {
-                throw SyntaxError{"unavailable symbol: " + std::string(1, curr) +
-                                  std::to_string(int(curr))};
-            }
-            len += 1;
-        }
-        while (len > 0) {
-            in_->unget();
-            len -= 1;
-        }
+    // Reads the rest of the stream.
+    explicit Tokenizer(std::istream* in);
 
-        SkipSpaces();
-    }
+    // Lexes the view in place; it has to outlive the tokenizer.
+    explicit Tokenizer(std::string_view input);
+
+    Tokenizer(const Tokenizer&) = delete;
+    Tokenizer& operator=(const Tokenizer&) = delete;
 
-    bool IsEnd();
+    bool IsEnd() const {
+        return pos_ == input_.size();
+    }
 
     void Next();
 
-    Token GetToken();
+    // The token stays valid until the next call after Next.
+    const Token& GetToken();
 
-private:
-    void SkipSpaces() {
-        while (!IsEnd() && std::isspace(in_->peek())) {
-            in_->get();
-        }
+    // Offset of the first character not consumed yet; spaces after a token count as consumed.
+    size_t GetPosition() const {
+        return pos_;
     }
 
+    // Offset just past the last token consumed by Next, before the spaces that follow it.
+    size_t GetTokenEnd() const {
+        return consumed_end_;
+    }
+
+    static constexpr size_t kNeedMore = std::string_view::npos;
+
+    // Lexes the token starting at pos, which is not a space, and returns the offset just past
+    // it. Characters are checked as they are lexed, so text after the token never fails it. A
+    // partial input may go on after its end, so a token running into the end there gives
+    // kNeedMore instead.
+    static size_t Lex(std::string_view input, size_t pos, bool partial, Token* token);
+
+    // Offset of the first character at or after pos that is not a space.
+    static size_t SkipSpaces(std::string_view input, size_t pos);
+
+    static bool IsSpace(char c) {
+        return kCharClasses[static_cast<unsigned char>(c)] & kSpace;
+    }
+    static bool IsDigit(char c) {
+        return kCharClasses[static_cast<unsigned char>(c)] & kDigit;
+    }
     static bool BeginsWith(char c) {
-        static const std::string kAvailable = "<=>*#/";
-        return std::isalpha(c) || kAvailable.find(c) != std::string::npos;
+        return kCharClasses[static_cast<unsigned char>(c)] & kBegin;
     };
     static bool AvailableCharsInSymbol(char c) {
-        static const std::string kAvailable = "?!-";
-        return BeginsWith(c) || std::isdigit(c) || kAvailable.find(c) != std::string::npos;
+        return kCharClasses[static_cast<unsigned char>(c)] & kInSymbol;
     };
     static bool AvailableChars(char c) {
-        static const std::string kAvailable = "().'+-";
-        return AvailableCharsInSymbol(c) || std::isspace(c) ||
-               kAvailable.find(c) != std::string::npos;
+        return kCharClasses[static_cast<unsigned char>(c)] & kAvailable;
     }
 
-    std::istream* in_;
-    size_t token_len_{};
-};
\ No newline at end of file
+private:
+    enum CharClass : uint8_t {
+        kSpace = 1,
+        kBegin = 2,
+        kInSymbol = 4,
+        kDigit = 8,
+        kAvailable = 16,
+    };
+
+    static constexpr std::array<uint8_t, 256> kCharClasses = [] {
+        std::array<uint8_t, 256> table{};
+        auto mark = [&table](std::string_view chars, uint8_t classes) {
+            for (unsigned char c : chars) {
+                table[c] |= classes;
+            }
+        };
+        for (char c = 'a'; c <= 'z'; ++c) {
+            mark({&c, 1}, kBegin | kInSymbol | kAvailable);
+            char upper = c - 'a' + 'A';
+            mark({&upper, 1}, kBegin | kInSymbol | kAvailable);
+        }
+        mark("<=>*#/_", kBegin | kInSymbol | kAvailable);
+        mark("0123456789", kDigit | kInSymbol | kAvailable);
+        mark("?!-", kInSymbol | kAvailable);
+        mark(" \t\n\v\f\r", kSpace | kAvailable);
+        mark("().'+", kAvailable);
+        return table;
+    }();
+
+    // Returns the end of the run of characters of the class starting at pos.
+    template <CharClass kClass>
+    static size_t SkipRun(std::string_view input, size_t pos);
+
+    std::string owned_{};
+    std::string_view input_;
+    size_t pos_ = 0;
+    Token token_{};
+    bool lexed_ = false;
+    size_t token_end_ = 0;
+    size_t consumed_end_ = 0;
+};
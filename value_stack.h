@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <vector>
+
+class Object;
+
+using Arguments = std::span<const std::shared_ptr<Object>>;
+
+class ValueStack {
+    static constexpr size_t kChunkSize = 4096;
+
+public:
+    class Frame {
+    public:
+        explicit Frame(ValueStack& stack)
+            : stack_(stack),
+              saved_chunk_(stack.chunk_),
+              saved_top_(stack.top_),
+              chunk_(stack.chunk_),
+              begin_(stack.top_) {
+        }
+        Frame(const Frame&) = delete;
+        Frame& operator=(const Frame&) = delete;
+
+        ~Frame() {
+            auto& chunk = stack_.chunks_[chunk_];
+            for (size_t i = begin_; i < stack_.top_; ++i) {
+                chunk[i].reset();
+            }
+            stack_.chunk_ = saved_chunk_;
+            stack_.top_ = saved_top_;
+        }
+
+        inline void Push(std::shared_ptr<Object> value) {
+            if (stack_.top_ == stack_.chunks_[chunk_].size()) {
+                Migrate();
+            }
+            stack_.chunks_[chunk_][stack_.top_++] = std::move(value);
+        }
+
+        inline Arguments Args() const {
+            return Arguments(stack_.chunks_[chunk_].data() + begin_, stack_.top_ - begin_);
+        }
+
+    private:
+        // Frames never straddle chunks and chunks never reallocate while they hold a live
+        // frame, so spans handed out by Args() stay valid during nested calls.
+        void Migrate() {
+            size_t count = stack_.top_ - begin_;
+            size_t next = chunk_ + 1;
+            if (next == stack_.chunks_.size()) {
+                stack_.chunks_.emplace_back();
+            }
+            auto& target = stack_.chunks_[next];
+            if (target.size() < std::max(kChunkSize, 2 * (count + 1))) {
+                target.resize(std::max(kChunkSize, 2 * (count + 1)));
+            }
+
+            auto& source = stack_.chunks_[chunk_];
+            for (size_t i = 0; i < count; ++i) {
+                target[i] = std::move(source[begin_ + i]);
+            }
+            chunk_ = next;
+            begin_ = 0;
+            stack_.chunk_ = next;
+            stack_.top_ = count;
+        }
+
+        ValueStack& stack_;
+        size_t saved_chunk_;
+        size_t saved_top_;
+        size_t chunk_;
+        size_t begin_;
+    };
+
+    class Activation {
+    public:
+        explicit Activation(ValueStack* stack) : saved_(k_current) {
+            k_current = stack;
+        }
+        Activation(const Activation&) = delete;
+        Activation& operator=(const Activation&) = delete;
+
+        ~Activation() {
+            k_current = saved_;
+        }
+
+    private:
+        ValueStack* saved_;
+    };
+
+    ValueStack() {
+        chunks_.emplace_back(kChunkSize);
+    }
+    ValueStack(const ValueStack&) = delete;
+    ValueStack& operator=(const ValueStack&) = delete;
+
+    static inline ValueStack& Current() {
+        if (!k_current) {
+            thread_local ValueStack fallback;
+            return fallback;
+        }
+        return *k_current;
+    }
+
+    // Handlers installed by with-exception-handler, innermost last; guards push nullptr.
+    std::vector<std::shared_ptr<Object>>& GetHandlers() {
+        return handlers_;
+    }
+
+    // The object of a raise that evaluation is handing back to a guard as Raising.
+    std::shared_ptr<Object>& GetRaised() {
+        return raised_;
+    }
+
+private:
+    inline static thread_local ValueStack* k_current = nullptr;
+
+    std::vector<std::vector<std::shared_ptr<Object>>> chunks_{};
+    size_t chunk_ = 0;
+    size_t top_ = 0;
+    std::vector<std::shared_ptr<Object>> handlers_{};
+    std::shared_ptr<Object> raised_{};
+};